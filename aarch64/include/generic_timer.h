@@ -0,0 +1,33 @@
+/**********************************************************
+ * 
+ *  generic_timer.h
+ * 
+ * 
+ *  DESCRIPTION:
+ *      AArch64 generic timer, the EL1 physical timer of the
+ *      calling core
+ *
+ *  NOTES:
+ *      The counter is shared by all cores and runs at
+ *      generic_timer_freq(), the compare registers and
+ *      the interrupt are per core. boot.S gives EL1 access
+ *      to them and sets the frequency if the firmware did
+ *      not. Routing the interrupt to the CPU is up to the
+ *      platform.
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+
+#define GENERIC_TIMER_CTL_ENABLE  ( 1 << 0 )
+#define GENERIC_TIMER_CTL_IMASK   ( 1 << 1 )
+#define GENERIC_TIMER_CTL_ISTATUS ( 1 << 2 )
+
+uint32_t generic_timer_freq(void);
+uint64_t generic_timer_count(void);
+void generic_timer_set_tval(uint32_t tval);
+uint64_t generic_timer_get_cval(void);
+void generic_timer_set_cval(uint64_t cval);
+void generic_timer_set_ctl(uint32_t ctl);
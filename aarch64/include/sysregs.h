@@ -49,4 +49,18 @@
 #define SPSR_VALUE_EL1			(SPSR_MASK_ALL | SPSR_EL1h) // SPSR value to boot into EL1
 #define SPSR_VALUE_EL2			(SPSR_MASK_ALL | SPSR_EL2h)
 
+// ***************************************
+// CNTHCTL_EL2, Counter-timer Hypervisor Control register (EL2) (D13.8.3)
+// ***************************************
+
+#define CNTHCTL_EL1PCTEN		(1 << 0)	// EL1 may read CNTPCT_EL0
+#define CNTHCTL_EL1PCEN			(1 << 1)	// EL1 may use the physical timer
+#define CNTHCTL_VALUE			(CNTHCTL_EL1PCTEN | CNTHCTL_EL1PCEN)
+
+// ***************************************
+// CNTFRQ_EL0, Counter-timer Frequency register (D13.8.1)
+// ***************************************
+
+#define CNTFRQ_CRYSTAL			19200000	// Pi crystal, the counter's rate when nothing else set it
+
 #endif
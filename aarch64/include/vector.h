@@ -1,11 +1,36 @@
 #pragma once
 
-#define STACK_FRAME_SIZE 256
+/**********************************************************
+ *
+ *  Exception frame layout
+ *
+ *      Frame pushed by kernel_entry and popped by
+ *      kernel_exit. x0-x29 are stored in pairs from the
+ *      bottom of the frame, followed by x30/ELR and SPSR.
+ *      The frame size is rounded up to keep sp 16-byte
+ *      aligned.
+ *
+ */
+
+#define STACK_FRAME_SIZE  272
+
+#define FRAME_X30_OFFSET  ( 16 * 15 )
+#define FRAME_ELR_OFFSET  ( ( 16 * 15 ) + 8 )
+#define FRAME_SPSR_OFFSET ( 16 * 16 )
+
+/* IRQ mask bit of a DAIF value from vector_irq_save() */
+#define VECTOR_DAIF_IRQ   ( 1 << 7 )
 
 #ifndef __ASSEMBLER__
 
 void vector_init(void);
 void vector_enable_irq(void);
 void vector_disable_irq(void);
+unsigned long vector_irq_save(void);
+void vector_irq_restore(unsigned long daif);
+
+#ifdef SCHED_PREEMPTIVE
+void vector_ctx_yield(void);
+#endif
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,108 @@
+/**********************************************************
+ *
+ *  defer.c
+ *
+ *
+ *  DESCRIPTION:
+ *      Deferred work queue, see defer.h
+ *
+ */
+
+#include "generic.h"
+#include "spsc_ring.h"
+#include "defer.h"
+
+#if ( DEFER_QUEUE_LEN & ( DEFER_QUEUE_LEN - 1 ) ) != 0
+    #error DEFER_QUEUE_LEN must be a power of two
+#endif
+
+/* Statically set up so ISRs can post before anything is initialized */
+static spsc_work_t defer_items[ DEFER_QUEUE_LEN ];
+static spsc_ring_t defer_ring = SPSC_RING_INIT(defer_items);
+
+/**********************************************************
+ *
+ *  defer_work
+ *
+ *
+ *  DESCRIPTION:
+ *      Post func( ctx, arg ) to run outside of interrupt
+ *      context. Returns FALSE if the queue is full.
+ *
+ *  NOTES:
+ *      Core 0 ISRs only.
+ *
+ */
+
+boolean defer_work(spsc_work_func_t func, void * ctx, uint32_t arg)
+{
+    if(NULL == func)
+    {
+        return FALSE;
+    }
+
+    return spsc_ring_push(&defer_ring, func, ctx, arg);
+}
+
+/**********************************************************
+ *
+ *  defer_run
+ *
+ *
+ *  DESCRIPTION:
+ *      Run up to max_items of the posted work, oldest first.
+ *      Returns the number of items run.
+ *
+ *  NOTES:
+ *      Only called from sched_main() on core 0.
+ *
+ */
+
+uint32_t defer_run(uint32_t max_items)
+{
+    spsc_work_t item;
+    uint32_t ran;
+
+    for(ran = 0; ran < max_items; ran++)
+    {
+        if(FALSE == spsc_ring_pop(&defer_ring, &item))
+        {
+            break;
+        }
+
+        item.func(item.ctx, item.arg);
+    }
+
+    return ran;
+}
+
+/**********************************************************
+ *
+ *  defer_pending
+ *
+ *
+ *  DESCRIPTION:
+ *      Whether posted work is waiting to run. Lets the
+ *      scheduler skip going idle.
+ *
+ */
+
+boolean defer_pending(void)
+{
+    return !spsc_ring_is_empty(&defer_ring);
+}
+
+/**********************************************************
+ *
+ *  defer_dropped
+ *
+ *
+ *  DESCRIPTION:
+ *      Work items lost to a full queue.
+ *
+ */
+
+uint32_t defer_dropped(void)
+{
+    return defer_ring.dropped;
+}
@@ -0,0 +1,405 @@
+/**********************************************************
+ *
+ *  sched_mutex.c
+ *
+ *
+ *  DESCRIPTION:
+ *      Mutexes, see sched_mutex.h
+ *
+ *  NOTES:
+ *      The scheduler is only ever called with the mutex's
+ *      lock dropped, the same as the wait objects. A boost
+ *      and the unboost that undoes it may therefore reach
+ *      the scheduler in either order, which is fine as it
+ *      only counts them.
+ *
+ */
+
+#ifdef EMBEDDED_BUILD
+#include "printf.h"
+#else
+#include <stdio.h>
+#endif
+
+#include "generic.h"
+#include "irq.h"
+#include "spinlock.h"
+#include "sched.h"
+#include "sched_mutex.h"
+#include "peripherals/timer.h"
+
+/**********************************************************
+ *
+ *  sched_mutex_waiter_t
+ *
+ *      A task waiting on a mutex, on the waiter's stack.
+ *
+ *  task_id, task_valid
+ *
+ *      Waiting task, activated when it is handed the mutex.
+ *      Callers outside of a task are not activated.
+ *
+ *  granted
+ *
+ *      Mutex was handed to the waiter. The waiter's stack
+ *      may be gone once it is set.
+ *
+ */
+
+struct sched_mutex_waiter_t_struc
+    {
+    sched_task_id_t                     task_id;
+    boolean                             task_valid;
+    volatile boolean                    granted;
+    struct sched_mutex_waiter_t_struc * next;
+    };
+
+/* Mutexes set up with sched_mutex_init(), newest first */
+static sched_mutex_t * mutex_list;
+static spinlock_t mutex_list_lock;
+
+static boolean is_owner(sched_mutex_t * mutex, sched_task_id_t task_id, boolean task_valid);
+
+/**********************************************************
+ *
+ *  sched_mutex_init
+ *
+ *
+ *  DESCRIPTION:
+ *      Set up an unlocked mutex and list it for the stats.
+ *
+ */
+
+void sched_mutex_init(sched_mutex_t * mutex, const char * name)
+{
+    irq_flags_t flags;
+
+    clr_mem(mutex, sizeof(sched_mutex_t));
+    mutex->name = name;
+
+    flags = irq_save();
+    spin_lock(&mutex_list_lock);
+    mutex->next = mutex_list;
+    mutex_list = mutex;
+    spin_unlock(&mutex_list_lock);
+    irq_restore(flags);
+}
+
+/**********************************************************
+ *
+ *  sched_mutex_lock
+ *
+ *
+ *  DESCRIPTION:
+ *      Take the mutex, waiting for it if it is held.
+ *
+ */
+
+sched_err_t sched_mutex_lock(sched_mutex_t * mutex)
+{
+    sched_mutex_waiter_t waiter;
+    sched_task_id_t task_id;
+    sched_task_id_t owner;
+    irq_flags_t flags;
+    uint64_t start_us;
+    uint64_t wait_us;
+    boolean task_valid;
+    boolean blocking;
+    boolean boost;
+
+    task_valid = ( sched_get_current_task(&task_id) == SCHED_ERR_NO_ERR );
+
+    flags = irq_save();
+    spin_lock(&mutex->lock);
+
+    /* Uncontended, take it and go */
+    if( mutex->held == FALSE )
+    {
+        mutex->held = TRUE;
+        mutex->owner = task_id;
+        mutex->owner_valid = task_valid;
+        mutex->stats.locks++;
+
+        spin_unlock(&mutex->lock);
+        irq_restore(flags);
+        return SCHED_ERR_NO_ERR;
+    }
+
+    if( task_valid && is_owner(mutex, task_id, task_valid) )
+    {
+        spin_unlock(&mutex->lock);
+        irq_restore(flags);
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    /* Queue up behind the holder */
+    waiter.task_id = task_id;
+    waiter.task_valid = task_valid;
+    waiter.granted = FALSE;
+    waiter.next = NULL;
+
+    if( mutex->wait_tail == NULL )
+    {
+        mutex->wait_head = &waiter;
+    }
+    else
+    {
+        mutex->wait_tail->next = &waiter;
+    }
+
+    mutex->wait_tail = &waiter;
+    mutex->stats.contended++;
+
+    /* The first waiter has the holder boosted until it
+     * unlocks, later ones are already covered */
+    boost = ( mutex->boosted == FALSE && mutex->owner_valid == TRUE );
+    if( boost )
+    {
+        mutex->boosted = TRUE;
+    }
+    owner = mutex->owner;
+
+    spin_unlock(&mutex->lock);
+    irq_restore(flags);
+
+    if( boost )
+    {
+        (void)sched_boost_task(owner);
+    }
+
+    /* Block until the mutex is handed over, or spin where
+     * the caller can not block */
+    start_us = clock_now_us();
+    blocking = task_valid;
+
+    while( waiter.granted == FALSE )
+    {
+        if( blocking && sched_wait_activation() != SCHED_ERR_NO_ERR )
+        {
+            blocking = FALSE;
+        }
+    }
+
+    wait_us = clock_now_us() - start_us;
+
+    /* Also orders us after everything the last holder did */
+    flags = irq_save();
+    spin_lock(&mutex->lock);
+    mutex->stats.wait_us += wait_us;
+    if( wait_us > mutex->stats.max_wait_us )
+    {
+        mutex->stats.max_wait_us = (uint32_t)wait_us;
+    }
+    spin_unlock(&mutex->lock);
+    irq_restore(flags);
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_mutex_trylock
+ *
+ *
+ *  DESCRIPTION:
+ *      Take the mutex if it is free.
+ *
+ */
+
+boolean sched_mutex_trylock(sched_mutex_t * mutex)
+{
+    sched_task_id_t task_id;
+    irq_flags_t flags;
+    boolean task_valid;
+    boolean taken;
+
+    task_valid = ( sched_get_current_task(&task_id) == SCHED_ERR_NO_ERR );
+
+    flags = irq_save();
+    spin_lock(&mutex->lock);
+
+    taken = ( mutex->held == FALSE );
+    if( taken )
+    {
+        mutex->held = TRUE;
+        mutex->owner = task_id;
+        mutex->owner_valid = task_valid;
+        mutex->stats.locks++;
+    }
+
+    spin_unlock(&mutex->lock);
+    irq_restore(flags);
+
+    return taken;
+}
+
+/**********************************************************
+ *
+ *  sched_mutex_unlock
+ *
+ *
+ *  DESCRIPTION:
+ *      Give the mutex up, to the first waiter if there is
+ *      one.
+ *
+ */
+
+sched_err_t sched_mutex_unlock(sched_mutex_t * mutex)
+{
+    sched_mutex_waiter_t * waiter;
+    sched_task_id_t task_id;
+    sched_task_id_t next_id;
+    irq_flags_t flags;
+    boolean task_valid;
+    boolean unboost;
+    boolean boost;
+    boolean wake;
+
+    task_valid = ( sched_get_current_task(&task_id) == SCHED_ERR_NO_ERR );
+
+    flags = irq_save();
+    spin_lock(&mutex->lock);
+
+    if( mutex->held == FALSE || is_owner(mutex, task_id, task_valid) == FALSE )
+    {
+        spin_unlock(&mutex->lock);
+        irq_restore(flags);
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    unboost = mutex->boosted;
+    boost = FALSE;
+    wake = FALSE;
+    next_id = 0;
+
+    waiter = mutex->wait_head;
+    if( waiter == NULL )
+    {
+        mutex->held = FALSE;
+        mutex->boosted = FALSE;
+    }
+    else
+    {
+        mutex->wait_head = waiter->next;
+        if( mutex->wait_head == NULL )
+        {
+            mutex->wait_tail = NULL;
+        }
+
+        /* Straight to the first waiter, nobody can take it
+         * in between */
+        mutex->owner = waiter->task_id;
+        mutex->owner_valid = waiter->task_valid;
+        mutex->stats.locks++;
+
+        /* The waiters left keep the new owner boosted */
+        boost = ( mutex->wait_head != NULL && waiter->task_valid == TRUE );
+        mutex->boosted = boost;
+
+        next_id = waiter->task_id;
+        wake = waiter->task_valid;
+
+        /* Last touch of the waiter, it may return from here on */
+        waiter->granted = TRUE;
+    }
+
+    spin_unlock(&mutex->lock);
+    irq_restore(flags);
+
+    if( unboost )
+    {
+        (void)sched_unboost_task(task_id);
+    }
+
+    if( boost )
+    {
+        (void)sched_boost_task(next_id);
+    }
+
+    if( wake )
+    {
+        (void)sched_activate_task(next_id);
+    }
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_mutex_get_stats
+ *
+ *
+ *  DESCRIPTION:
+ *      Copy out the mutex's counters.
+ *
+ */
+
+void sched_mutex_get_stats(sched_mutex_t * mutex, sched_mutex_stats_t * stats)
+{
+    irq_flags_t flags;
+
+    flags = irq_save();
+    spin_lock(&mutex->lock);
+    *stats = mutex->stats;
+    spin_unlock(&mutex->lock);
+    irq_restore(flags);
+}
+
+/**********************************************************
+ *
+ *  sched_mutex_print_stats
+ *
+ *
+ *  DESCRIPTION:
+ *      Print the counters of every listed mutex.
+ *
+ *  NOTES:
+ *      The list only ever grows at its head, so it is
+ *      walked without the list lock.
+ *
+ */
+
+void sched_mutex_print_stats(void)
+{
+    sched_mutex_stats_t stats;
+    sched_mutex_t * mutex;
+
+    printf("\nmutex locks contended wait_us max_wait_us");
+
+    for(mutex = mutex_list; mutex != NULL; mutex = mutex->next)
+    {
+        sched_mutex_get_stats(mutex, &stats);
+        printf("\n%s %u %u %u %u",
+               ( mutex->name != NULL ) ? mutex->name : "?",
+               stats.locks,
+               stats.contended,
+               (uint32_t)stats.wait_us,
+               stats.max_wait_us);
+    }
+}
+
+/* helper functions */
+
+/**********************************************************
+ *
+ *  is_owner
+ *
+ *
+ *  DESCRIPTION:
+ *      The caller is the mutex's owner, or both are outside
+ *      of any task.
+ *
+ *  NOTES:
+ *      Caller holds the mutex's lock.
+ *
+ */
+
+static boolean is_owner(sched_mutex_t * mutex, sched_task_id_t task_id, boolean task_valid)
+{
+    if( mutex->owner_valid != task_valid )
+    {
+        return FALSE;
+    }
+
+    return ( task_valid == FALSE || mutex->owner == task_id );
+}
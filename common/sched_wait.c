@@ -0,0 +1,428 @@
+/**********************************************************
+ *
+ *  sched_wait.c
+ *
+ *
+ *  DESCRIPTION:
+ *      Wait objects, see sched_wait.h
+ *
+ *  NOTES:
+ *      A waiter checks its object, then parks in
+ *      sched_wait_activation() if there was nothing for it.
+ *      A signal that lands in between still activates the
+ *      task, which the scheduler keeps until the task parks
+ *      so it comes straight back and checks again. Waits
+ *      therefore always loop on the check.
+ *
+ */
+
+#include "generic.h"
+#include "irq.h"
+#include "spinlock.h"
+#include "sched.h"
+#include "sched_wait.h"
+
+static void wait_init(sched_wait_t * wait);
+static sched_err_t wait_signal(sched_wait_t * wait, irq_flags_t flags);
+static sched_err_t wait_bind_current(sched_wait_t * wait);
+
+/**********************************************************
+ *
+ *  sched_wait_bind
+ *
+ *
+ *  DESCRIPTION:
+ *      Bind the task woken by the object.
+ *
+ */
+
+void sched_wait_bind(sched_wait_t * wait, sched_task_id_t task_id)
+{
+    irq_flags_t flags;
+
+    flags = irq_save();
+    spin_lock(&wait->lock);
+    wait->task_id = task_id;
+    wait->bound = TRUE;
+    spin_unlock(&wait->lock);
+    irq_restore(flags);
+}
+
+/**********************************************************
+ *
+ *  sched_event_init
+ *
+ *
+ *  DESCRIPTION:
+ *      Set up event flags with no flag set and no task
+ *      bound.
+ *
+ */
+
+void sched_event_init(sched_event_t * evt)
+{
+    wait_init(&evt->wait);
+    evt->flags = 0;
+}
+
+/**********************************************************
+ *
+ *  sched_event_set
+ *
+ *
+ *  DESCRIPTION:
+ *      Set flags and wake the bound task.
+ *
+ */
+
+sched_err_t sched_event_set(sched_event_t * evt, uint32_t flags)
+{
+    irq_flags_t irq_flags;
+
+    irq_flags = irq_save();
+    spin_lock(&evt->wait.lock);
+    evt->flags |= flags;
+
+    return wait_signal(&evt->wait, irq_flags);
+}
+
+/**********************************************************
+ *
+ *  sched_event_take
+ *
+ *
+ *  DESCRIPTION:
+ *      Clear and return the set flags in mask.
+ *
+ */
+
+uint32_t sched_event_take(sched_event_t * evt, uint32_t mask)
+{
+    irq_flags_t flags;
+    uint32_t taken;
+
+    flags = irq_save();
+    spin_lock(&evt->wait.lock);
+    taken = evt->flags & mask;
+    evt->flags &= ~taken;
+    spin_unlock(&evt->wait.lock);
+    irq_restore(flags);
+
+    return taken;
+}
+
+/**********************************************************
+ *
+ *  sched_event_wait
+ *
+ *
+ *  DESCRIPTION:
+ *      Block until a flag in mask is set, then take the
+ *      set flags in mask. flags may be NULL.
+ *
+ */
+
+sched_err_t sched_event_wait(sched_event_t * evt, uint32_t mask, uint32_t * flags)
+{
+    sched_err_t err;
+    uint32_t taken;
+
+    if( mask == 0 )
+    {
+        return SCHED_ERR_PARAM;
+    }
+
+    err = wait_bind_current(&evt->wait);
+
+    while( err == SCHED_ERR_NO_ERR )
+    {
+        taken = sched_event_take(evt, mask);
+        if( taken != 0 )
+        {
+            if( flags != NULL )
+            {
+                *flags = taken;
+            }
+            break;
+        }
+
+        err = sched_wait_activation();
+    }
+
+    return err;
+}
+
+/**********************************************************
+ *
+ *  sched_sem_init
+ *
+ *
+ *  DESCRIPTION:
+ *      Set up a semaphore at count with no task bound.
+ *
+ */
+
+void sched_sem_init(sched_sem_t * sem, uint32_t count)
+{
+    wait_init(&sem->wait);
+    sem->count = count;
+}
+
+/**********************************************************
+ *
+ *  sched_sem_post
+ *
+ *
+ *  DESCRIPTION:
+ *      Count up and wake the bound task.
+ *
+ */
+
+sched_err_t sched_sem_post(sched_sem_t * sem)
+{
+    irq_flags_t flags;
+
+    flags = irq_save();
+    spin_lock(&sem->wait.lock);
+    sem->count++;
+
+    return wait_signal(&sem->wait, flags);
+}
+
+/**********************************************************
+ *
+ *  sched_sem_take
+ *
+ *
+ *  DESCRIPTION:
+ *      Count down, returns FALSE if the count is zero.
+ *
+ */
+
+boolean sched_sem_take(sched_sem_t * sem)
+{
+    irq_flags_t flags;
+    boolean taken;
+
+    flags = irq_save();
+    spin_lock(&sem->wait.lock);
+    taken = ( sem->count > 0 );
+    if( taken )
+    {
+        sem->count--;
+    }
+    spin_unlock(&sem->wait.lock);
+    irq_restore(flags);
+
+    return taken;
+}
+
+/**********************************************************
+ *
+ *  sched_sem_wait
+ *
+ *
+ *  DESCRIPTION:
+ *      Block until the semaphore can be counted down.
+ *
+ */
+
+sched_err_t sched_sem_wait(sched_sem_t * sem)
+{
+    sched_err_t err;
+
+    err = wait_bind_current(&sem->wait);
+
+    while( err == SCHED_ERR_NO_ERR && sched_sem_take(sem) == FALSE )
+    {
+        err = sched_wait_activation();
+    }
+
+    return err;
+}
+
+/**********************************************************
+ *
+ *  sched_msg_init
+ *
+ *
+ *  DESCRIPTION:
+ *      Set up an empty message box over count slots. count
+ *      must be a power of two.
+ *
+ */
+
+boolean sched_msg_init(sched_msg_t * msg, void ** slots, uint32_t count)
+{
+    if(NULL == msg || NULL == slots || count == 0 || ( count & ( count - 1 ) ) != 0)
+    {
+        return FALSE;
+    }
+
+    wait_init(&msg->wait);
+    msg->slots = slots;
+    msg->mask = count - 1;
+    msg->head = 0;
+    msg->tail = 0;
+    msg->dropped = 0;
+
+    return TRUE;
+}
+
+/**********************************************************
+ *
+ *  sched_msg_send
+ *
+ *
+ *  DESCRIPTION:
+ *      Queue a message and wake the bound task.
+ *
+ */
+
+sched_err_t sched_msg_send(sched_msg_t * msg, void * data)
+{
+    irq_flags_t flags;
+
+    flags = irq_save();
+    spin_lock(&msg->wait.lock);
+
+    if( msg->head - msg->tail > msg->mask )
+    {
+        msg->dropped++;
+        spin_unlock(&msg->wait.lock);
+        irq_restore(flags);
+        return SCHED_ERR_FAILED_UPDATE;
+    }
+
+    msg->slots[msg->head & msg->mask] = data;
+    msg->head++;
+
+    return wait_signal(&msg->wait, flags);
+}
+
+/**********************************************************
+ *
+ *  sched_msg_take
+ *
+ *
+ *  DESCRIPTION:
+ *      Take the oldest message, returns FALSE if there is
+ *      none.
+ *
+ */
+
+boolean sched_msg_take(sched_msg_t * msg, void ** data)
+{
+    irq_flags_t flags;
+    boolean taken;
+
+    flags = irq_save();
+    spin_lock(&msg->wait.lock);
+    taken = ( msg->head != msg->tail );
+    if( taken )
+    {
+        *data = msg->slots[msg->tail & msg->mask];
+        msg->tail++;
+    }
+    spin_unlock(&msg->wait.lock);
+    irq_restore(flags);
+
+    return taken;
+}
+
+/**********************************************************
+ *
+ *  sched_msg_wait
+ *
+ *
+ *  DESCRIPTION:
+ *      Block until a message arrives, then take it.
+ *
+ */
+
+sched_err_t sched_msg_wait(sched_msg_t * msg, void ** data)
+{
+    sched_err_t err;
+
+    err = wait_bind_current(&msg->wait);
+
+    while( err == SCHED_ERR_NO_ERR && sched_msg_take(msg, data) == FALSE )
+    {
+        err = sched_wait_activation();
+    }
+
+    return err;
+}
+
+/* helper functions */
+
+static void wait_init(sched_wait_t * wait)
+{
+    spin_lock_init(&wait->lock);
+    wait->task_id = 0;
+    wait->bound = FALSE;
+}
+
+/**********************************************************
+ *
+ *  wait_signal
+ *
+ *
+ *  DESCRIPTION:
+ *      Drop the object's lock and activate the bound task.
+ *      Returns the scheduler's error if the activation
+ *      failed, e.g., the bound task was killed.
+ *
+ *  NOTES:
+ *      Called with the lock held and IRQs masked with
+ *      flags. Both are given back before the scheduler is
+ *      called, the same as sched_mutex_unlock(), so its
+ *      locks are never taken inside ours and a preemption
+ *      it asks for is not held off.
+ *
+ */
+
+static sched_err_t wait_signal(sched_wait_t * wait, irq_flags_t flags)
+{
+    sched_task_id_t task_id;
+    boolean bound;
+    sched_err_t err;
+
+    task_id = wait->task_id;
+    bound = wait->bound;
+    spin_unlock(&wait->lock);
+    irq_restore(flags);
+
+    err = SCHED_ERR_NO_ERR;
+    if( bound )
+    {
+        err = sched_activate_task(task_id);
+    }
+
+    return err;
+}
+
+/**********************************************************
+ *
+ *  wait_bind_current
+ *
+ *
+ *  DESCRIPTION:
+ *      Bind the calling task to the object it is about to
+ *      wait on.
+ *
+ */
+
+static sched_err_t wait_bind_current(sched_wait_t * wait)
+{
+    sched_task_id_t task_id;
+    sched_err_t err;
+
+    err = sched_get_current_task(&task_id);
+    if( err == SCHED_ERR_NO_ERR )
+    {
+        sched_wait_bind(wait, task_id);
+    }
+
+    return err;
+}
@@ -0,0 +1,397 @@
+/**********************************************************
+ *
+ *  soft_timer.c
+ *
+ *
+ *  DESCRIPTION:
+ *      Software timers, see soft_timer.h
+ *
+ *  NOTES:
+ *      The wheel has WHEEL_LVL_CNT levels of WHEEL_SLOTS
+ *      slots. Level 0 holds the timers due within
+ *      WHEEL_SLOTS steps, one slot per step. Every level
+ *      above covers WHEEL_SLOTS times the span of the one
+ *      below with slots as wide as all of the lower level.
+ *      Whenever level 0 wraps, the next slot of level 1 is
+ *      handed down, and so on up, so each timer moves down
+ *      at most once per level before it fires. Timers past
+ *      the top level's span wait in its furthest slot and
+ *      are put back when that comes around.
+ *
+ *      Each slot is a list linked through the timers
+ *      themselves, pprev lets one unlink itself without
+ *      walking the slot.
+ *
+ */
+
+#include "generic.h"
+#include "irq.h"
+#include "spinlock.h"
+#include "soft_timer.h"
+#include "peripherals/timer.h"
+
+#define WHEEL_LVL_BITS  6
+#define WHEEL_SLOTS     ( 1 << WHEEL_LVL_BITS )
+#define WHEEL_SLOT_MASK ( WHEEL_SLOTS - 1 )
+#define WHEEL_LVL_CNT   4
+
+/* Steps the wheel covers, and the span of each level */
+#define WHEEL_SPAN          ( 1ULL << ( WHEEL_LVL_CNT * WHEEL_LVL_BITS ) )
+#define WHEEL_LVL_SPAN(lvl) ( 1ULL << ( ( (lvl) + 1 ) * WHEEL_LVL_BITS ) )
+
+/* Slot of the step at a level */
+#define WHEEL_IDX(step, lvl) ( (uint32_t)( (step) >> ( (lvl) * WHEEL_LVL_BITS ) ) & WHEEL_SLOT_MASK )
+
+static soft_timer_t * wheel[ WHEEL_LVL_CNT ][ WHEEL_SLOTS ];
+
+/* Next step to run, behind the counter between IRQs */
+static uint64_t wheel_step;
+
+/* Running timers, the IRQ skips the empty wheel */
+static uint32_t wheel_cnt;
+
+static boolean wheel_running;
+static timer_id_t8 wheel_timer_id;
+static spinlock_t wheel_lock;
+
+static void soft_timer_isr(void);
+static void wheel_add(soft_timer_t * timer);
+static void wheel_remove(soft_timer_t * timer);
+static void wheel_cascade(uint32_t lvl);
+
+/**********************************************************
+ *
+ *  soft_timer_init
+ *
+ *
+ *  DESCRIPTION:
+ *      Start the wheel on its own hardware timer.
+ *
+ *  NOTES:
+ *      Runs on core 0, the callbacks with it.
+ *
+ */
+
+timer_err_t8 soft_timer_init(void)
+{
+    timer_err_t8 err;
+
+    wheel_step = clock_now_us() / SOFT_TIMER_TICK_US;
+
+    /* Prefer the core's own timer, and leave the shared
+     * ones to the scheduler */
+    err = timer_alloc_local(&wheel_timer_id, soft_timer_isr, SOFT_TIMER_TICK_US);
+    if( err == TIMER_ERR_RESOURCE_UNAVAILABLE )
+    {
+        err = timer_alloc(&wheel_timer_id, soft_timer_isr, SOFT_TIMER_TICK_US);
+    }
+
+    if( err == TIMER_ERR_NONE )
+    {
+        wheel_running = TRUE;
+    }
+
+    return err;
+}
+
+/**********************************************************
+ *
+ *  soft_timer_start
+ *
+ *
+ *  DESCRIPTION:
+ *      (Re)start a timer.
+ *
+ *  NOTES:
+ *      A step runs once the counter has reached its start,
+ *      so rounding the expiry up to a whole step is never
+ *      early.
+ *
+ */
+
+timer_err_t8 soft_timer_start(soft_timer_t * timer, soft_timer_func_t func, void * ctx, uint32_t delay_us, uint32_t period_us)
+{
+    irq_flags_t flags;
+    uint64_t expires;
+
+    if( timer == NULL || func == NULL )
+    {
+        return TIMER_ERR_INVALID_PRMTRS;
+    }
+
+    if( wheel_running == FALSE )
+    {
+        return TIMER_ERR_RESOURCE_UNAVAILABLE;
+    }
+
+    expires = ( clock_now_us() + delay_us + SOFT_TIMER_TICK_US - 1 ) / SOFT_TIMER_TICK_US;
+
+    flags = irq_save();
+    spin_lock(&wheel_lock);
+
+    if( timer->pprev != NULL )
+    {
+        wheel_remove(timer);
+    }
+
+    timer->expires = expires;
+    timer->period = ( period_us + SOFT_TIMER_TICK_US - 1 ) / SOFT_TIMER_TICK_US;
+    timer->func = func;
+    timer->ctx = ctx;
+    wheel_add(timer);
+
+    spin_unlock(&wheel_lock);
+    irq_restore(flags);
+
+    return TIMER_ERR_NONE;
+}
+
+/**********************************************************
+ *
+ *  soft_timer_cancel
+ *
+ *
+ *  DESCRIPTION:
+ *      Stop a timer.
+ *
+ */
+
+boolean soft_timer_cancel(soft_timer_t * timer)
+{
+    irq_flags_t flags;
+    boolean pending;
+
+    if( timer == NULL )
+    {
+        return FALSE;
+    }
+
+    flags = irq_save();
+    spin_lock(&wheel_lock);
+
+    pending = ( timer->pprev != NULL );
+    if( pending )
+    {
+        wheel_remove(timer);
+    }
+
+    spin_unlock(&wheel_lock);
+    irq_restore(flags);
+
+    return pending;
+}
+
+/**********************************************************
+ *
+ *  soft_timer_pending
+ *
+ *
+ *  DESCRIPTION:
+ *      The timer is running.
+ *
+ */
+
+boolean soft_timer_pending(soft_timer_t * timer)
+{
+    return ( timer != NULL && timer->pprev != NULL );
+}
+
+/* helper functions */
+
+/**********************************************************
+ *
+ *  soft_timer_isr
+ *
+ *
+ *  DESCRIPTION:
+ *      Hardware timer callback, run every step up to the
+ *      counter.
+ *
+ *  NOTES:
+ *      A late IRQ catches up on all of the steps it missed.
+ *      The lock is dropped around each callback, which is
+ *      why the expired slot is popped one timer at a time
+ *      rather than taken as a whole: a callback may cancel
+ *      the timers behind it.
+ *
+ */
+
+static void soft_timer_isr(void)
+{
+    soft_timer_func_t func;
+    soft_timer_t * timer;
+    irq_flags_t flags;
+    uint64_t now;
+    uint32_t idx;
+    uint32_t lvl;
+    void * ctx;
+
+    now = clock_now_us() / SOFT_TIMER_TICK_US;
+
+    flags = irq_save();
+    spin_lock(&wheel_lock);
+
+    /* Nothing to cascade or fire on an empty wheel */
+    if( wheel_cnt == 0 && (sint64_t)( now - wheel_step ) >= 0 )
+    {
+        wheel_step = now + 1;
+    }
+
+    while( (sint64_t)( now - wheel_step ) >= 0 )
+    {
+        idx = WHEEL_IDX(wheel_step, 0);
+
+        /* Level 0 wrapped, hand the next slots down */
+        for(lvl = 1; idx == 0 && lvl < WHEEL_LVL_CNT; lvl++)
+        {
+            wheel_cascade(lvl);
+            if( WHEEL_IDX(wheel_step, lvl) != 0 )
+            {
+                break;
+            }
+        }
+
+        /* Timers added from here on land in a later slot */
+        wheel_step++;
+
+        while( ( timer = wheel[0][idx] ) != NULL )
+        {
+            wheel_remove(timer);
+
+            /* Rearmed before the callback, which may cancel
+             * or restart it */
+            if( timer->period != 0 )
+            {
+                timer->expires += timer->period;
+                wheel_add(timer);
+            }
+
+            func = timer->func;
+            ctx = timer->ctx;
+
+            spin_unlock(&wheel_lock);
+            irq_restore(flags);
+
+            func(ctx);
+
+            flags = irq_save();
+            spin_lock(&wheel_lock);
+        }
+    }
+
+    spin_unlock(&wheel_lock);
+    irq_restore(flags);
+}
+
+/**********************************************************
+ *
+ *  wheel_add
+ *
+ *
+ *  DESCRIPTION:
+ *      Put a timer in the slot for its expiry.
+ *
+ *  NOTES:
+ *      Caller holds wheel_lock. A timer that is already due
+ *      goes in the next step's slot.
+ *
+ */
+
+static void wheel_add(soft_timer_t * timer)
+{
+    soft_timer_t ** slot;
+    uint64_t expires;
+    uint64_t delta;
+    uint32_t lvl;
+
+    expires = timer->expires;
+    delta = expires - wheel_step;
+
+    if( (sint64_t)delta < 0 )
+    {
+        slot = &wheel[0][ WHEEL_IDX(wheel_step, 0) ];
+    }
+    else
+    {
+        /* Park it in the top level's furthest slot */
+        if( delta >= WHEEL_SPAN )
+        {
+            delta = WHEEL_SPAN - 1;
+            expires = wheel_step + delta;
+        }
+
+        for(lvl = 0; delta >= WHEEL_LVL_SPAN(lvl); lvl++)
+            ;
+
+        slot = &wheel[lvl][ WHEEL_IDX(expires, lvl) ];
+    }
+
+    timer->next = *slot;
+    if( *slot != NULL )
+    {
+        (*slot)->pprev = &timer->next;
+    }
+
+    *slot = timer;
+    timer->pprev = slot;
+    wheel_cnt++;
+}
+
+/**********************************************************
+ *
+ *  wheel_remove
+ *
+ *
+ *  DESCRIPTION:
+ *      Unlink a timer from its slot.
+ *
+ *  NOTES:
+ *      Caller holds wheel_lock.
+ *
+ */
+
+static void wheel_remove(soft_timer_t * timer)
+{
+    *timer->pprev = timer->next;
+    if( timer->next != NULL )
+    {
+        timer->next->pprev = timer->pprev;
+    }
+
+    timer->next = NULL;
+    timer->pprev = NULL;
+    wheel_cnt--;
+}
+
+/**********************************************************
+ *
+ *  wheel_cascade
+ *
+ *
+ *  DESCRIPTION:
+ *      Hand the current slot of a level down to the levels
+ *      below.
+ *
+ *  NOTES:
+ *      Caller holds wheel_lock.
+ *
+ */
+
+static void wheel_cascade(uint32_t lvl)
+{
+    soft_timer_t * timer;
+    soft_timer_t * next;
+    uint32_t idx;
+
+    idx = WHEEL_IDX(wheel_step, lvl);
+    timer = wheel[lvl][idx];
+    wheel[lvl][idx] = NULL;
+
+    for(; timer != NULL; timer = next)
+    {
+        next = timer->next;
+        timer->pprev = NULL;
+        wheel_cnt--;
+        wheel_add(timer);
+    }
+}
@@ -0,0 +1,122 @@
+/**********************************************************
+ *
+ *  spsc_ring.c
+ *
+ *
+ *  DESCRIPTION:
+ *      Lock-free single producer, single consumer ring of
+ *      work items, see spsc_ring.h
+ *
+ */
+
+#include "generic.h"
+#include "spsc_ring.h"
+
+/**********************************************************
+ *
+ *  spsc_ring_init
+ *
+ *
+ *  DESCRIPTION:
+ *      Set up an empty ring over count items. count must be
+ *      a power of two.
+ *
+ */
+
+boolean spsc_ring_init(spsc_ring_t * ring, spsc_work_t * items, uint32_t count)
+{
+    if(NULL == ring || NULL == items || count == 0 || ( count & ( count - 1 ) ) != 0)
+    {
+        return FALSE;
+    }
+
+    ring->head = 0;
+    ring->tail = 0;
+    ring->mask = count - 1;
+    ring->items = items;
+    ring->dropped = 0;
+
+    return TRUE;
+}
+
+/**********************************************************
+ *
+ *  spsc_ring_push
+ *
+ *
+ *  DESCRIPTION:
+ *      Producer side. Queue a work item, returns FALSE and
+ *      counts it as dropped if the ring is full.
+ *
+ */
+
+boolean spsc_ring_push(spsc_ring_t * ring, spsc_work_func_t func, void * ctx, uint32_t arg)
+{
+    uint32_t head;
+    spsc_work_t * item;
+
+    head = ring->head;
+
+    /* The acquire pairs with the consumer's release of the
+     * slot, so we never write an item still being read */
+    if(( head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) ) > ring->mask)
+    {
+        ring->dropped++;
+        return FALSE;
+    }
+
+    item = &ring->items[head & ring->mask];
+    item->func = func;
+    item->ctx = ctx;
+    item->arg = arg;
+
+    /* Publish the item */
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    return TRUE;
+}
+
+/**********************************************************
+ *
+ *  spsc_ring_pop
+ *
+ *
+ *  DESCRIPTION:
+ *      Consumer side. Take the oldest work item, returns
+ *      FALSE if the ring is empty.
+ *
+ */
+
+boolean spsc_ring_pop(spsc_ring_t * ring, spsc_work_t * item)
+{
+    uint32_t tail;
+
+    tail = ring->tail;
+
+    if(tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+    {
+        return FALSE;
+    }
+
+    *item = ring->items[tail & ring->mask];
+
+    /* Hand the slot back to the producer */
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return TRUE;
+}
+
+/**********************************************************
+ *
+ *  spsc_ring_is_empty
+ *
+ *
+ *  DESCRIPTION:
+ *      Consumer side. Whether there is nothing to pop.
+ *
+ */
+
+boolean spsc_ring_is_empty(spsc_ring_t * ring)
+{
+    return ( ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) );
+}
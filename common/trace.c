@@ -0,0 +1,170 @@
+/**********************************************************
+ *
+ *  trace.c
+ *
+ *
+ *  DESCRIPTION:
+ *      Binary scheduler trace recorder, see trace.h
+ *
+ */
+
+#ifdef EMBEDDED_BUILD
+#include "printf.h"
+#else
+#include <stdio.h>
+#endif
+
+#include "generic.h"
+#include "cpu.h"
+#include "irq.h"
+#include "spinlock.h"
+#include "trace.h"
+#include "peripherals/timer.h"
+
+#ifdef TRACE_EVENTS
+
+#if ( TRACE_RING_LEN & ( TRACE_RING_LEN - 1 ) ) != 0
+    #error TRACE_RING_LEN must be a power of two
+#endif
+
+/**********************************************************
+ *
+ *  trace_ring_t
+ *
+ *      lock
+ *
+ *          Guards the ring. The simulator's ISRs share core
+ *          0's id, so the ring is not single producer.
+ *
+ *      head
+ *
+ *          Events recorded since the last dump, free
+ *          running.
+ *
+ *      recs
+ *
+ *          Event storage.
+ *
+ */
+
+typedef struct
+    {
+    spinlock_t  lock;
+    uint32_t    head;
+    trace_rec_t recs[ TRACE_RING_LEN ];
+    } trace_ring_t;
+
+/* Zeroed rings are ready to record, so events can be
+ * recorded before anything is initialized */
+static trace_ring_t trace_rings[ CPU_CORE_COUNT ];
+static volatile boolean trace_paused;
+
+/**********************************************************
+ *
+ *  trace_event
+ *
+ *
+ *  DESCRIPTION:
+ *      Record an event on the calling core.
+ *
+ */
+
+void trace_event(trace_evt_t evt, uint32_t id)
+{
+    trace_ring_t * ring;
+    trace_rec_t * rec;
+    irq_flags_t flags;
+    uint32_t core;
+
+    core = get_core_id();
+    if( core >= CPU_CORE_COUNT )
+    {
+        return;
+    }
+
+    ring = &trace_rings[core];
+
+    flags = irq_save();
+    spin_lock(&ring->lock);
+
+    /* Checked under the lock, so a dump never sees an
+     * event half written */
+    if( trace_paused == FALSE )
+    {
+        rec = &ring->recs[ring->head & ( TRACE_RING_LEN - 1 )];
+        rec->ts_us = clock_now_us();
+        rec->id = id;
+        rec->evt = evt;
+        rec->core = (uint8_t)core;
+        ring->head++;
+    }
+
+    spin_unlock(&ring->lock);
+    irq_restore(flags);
+}
+
+/**********************************************************
+ *
+ *  trace_dump
+ *
+ *
+ *  DESCRIPTION:
+ *      Print every core's events, oldest first, then start
+ *      the rings over.
+ *
+ *  NOTES:
+ *      Printing is slow, so the rings are not locked while
+ *      it runs. Recording is paused instead, taking each
+ *      lock once waits out an event being recorded.
+ *
+ */
+
+void trace_dump(void)
+{
+    trace_ring_t * ring;
+    trace_rec_t * rec;
+    irq_flags_t flags;
+    uint32_t core;
+    uint32_t count;
+    uint32_t i;
+
+    trace_paused = TRUE;
+
+    printf("\nTRACE BEGIN %x %x\n", TRACE_FORMAT_VERSION, CPU_CORE_COUNT);
+
+    for(core = 0; core < CPU_CORE_COUNT; core++)
+    {
+        ring = &trace_rings[core];
+
+        flags = irq_save();
+        spin_lock(&ring->lock);
+        spin_unlock(&ring->lock);
+        irq_restore(flags);
+
+        count = ring->head;
+        if( count > TRACE_RING_LEN )
+        {
+            count = TRACE_RING_LEN;
+        }
+
+        printf("TRACE CORE %x %x %x\n", core, count, ring->head - count);
+
+        for(i = ring->head - count; i != ring->head; i++)
+        {
+            rec = &ring->recs[i & ( TRACE_RING_LEN - 1 )];
+            printf("%08x %08x %08x %08x\n",
+                   (uint32_t)( rec->ts_us >> 32 ),
+                   (uint32_t)rec->ts_us,
+                   rec->id,
+                   ( (uint32_t)rec->core << 8 ) | rec->evt);
+        }
+
+        ring->head = 0;
+    }
+
+    printf("TRACE END\n");
+
+    trace_paused = FALSE;
+}
+
+#endif
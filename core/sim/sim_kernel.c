@@ -17,6 +17,7 @@
 #include "irq.h"
 #include "kernel.h"
 #include "peripherals/timer.h"
+#include "soft_timer.h"
 #include "peripherals/snsr/snsr.h"
 #include "peripherals/drivers/hc_sr04.h"
 #include "debug.h"
@@ -26,11 +27,12 @@
 static void init(void);
 static void tty_task(void);
 static void setup_drivers(void);
+static void start_cores(void);
+static void secondary_main(void);
 
 static sched_usr_tsk_t task_list[] =
     {
-    { 2000 /* ms */, tty_task },
-    { 1000 /*  ms */, net_proc }
+    { 2000 /* ms */, tty_task }
     };
 
 /**********************************************************
@@ -49,13 +51,16 @@ void /*kernel_*/main()
     printf("\nKernel initialized\n\rExecuting in EL%d\n", get_el());
     printf("Version %s", STRATOS_VERSION);
 
+    /* Bring up the other cores, then join them in the scheduler */
+    start_cores();
+
     /* Call the main scheduler function */
     sched_main();
 
     /* If for whatever reason the scheduler gives control
-     * back to us, just loop forever. */
-    while(1)//TODO CPU optimizations, e.g., wait for interrupt?
-        ;
+     * back to us, just sleep forever. */
+    while(1)
+        cpu_idle();
 }
 
 static void tty_task(void)
@@ -84,6 +89,16 @@ static void init(void)
     /* Initialize modules that rely on timers */
     sched_init(task_list, list_cnt(task_list));
 
+    /* Driver timeouts share one hardware timer, the
+     * scheduler keeps its own */
+    if(TIMER_ERR_NONE != soft_timer_init())
+    {
+        printf("\nFailed to start the software timers\n");
+    }
+
+    /* Packets are handled as they arrive from here on */
+    net_proc_start();
+
     /* Enable system IRQs */
     irq_sys_enable();
 
@@ -103,3 +118,46 @@ static void setup_drivers(void)
 {
 
 }
+
+/**********************************************************
+ * 
+ *  start_cores()
+ * 
+ *  DESCRIPTION:
+ *     Release the secondary cores into secondary_main()
+ * 
+ */
+
+static void start_cores(void)
+{
+    uint32_t core;
+
+    for(core = 1; core < CPU_CORE_COUNT; core++)
+    {
+        if(FALSE == cpu_start_core(core, secondary_main))
+        {
+            printf("\nFailed to start core %d\n", core);
+        }
+    }
+}
+
+/**********************************************************
+ * 
+ *  secondary_main()
+ * 
+ *  DESCRIPTION:
+ *     Entry point of every core other than core 0. Only
+ *     core local set up happens here, the kernel has
+ *     already been initialized by core 0.
+ * 
+ */
+
+static void secondary_main(void)
+{
+    irq_init();
+
+    sched_main();
+
+    while(1)
+        cpu_idle();
+}
@@ -16,6 +16,7 @@
 #include "debug.h"
 #include "utils.h"
 #include "printf.h"
+#include "sched.h"
 
 typedef struct
 {
@@ -124,7 +125,11 @@ void update(void)
 
             printf("\nDelay was %d microseconds.", us_delay);
 
-            delay_ms(1000);
+            /* Let the other tasks run in the meantime if we can */
+            if( sched_sleep_us(1000000) != SCHED_ERR_NO_ERR )
+            {
+                delay_ms(1000);
+            }
         }
     }
  
@@ -0,0 +1,974 @@
+/**********************************************************
+ *
+ *  edfsched.c
+ *
+ *
+ *  DESCRIPTION:
+ *      Earliest-Deadline-First task scheduler
+ *
+ *  NOTES:
+ *
+ *      Tasks are released periodically with an implicit
+ *      deadline, i.e., a job must finish before the task's
+ *      next release. Whenever the CPU is free the ready job
+ *      with the earliest absolute deadline is dispatched.
+ *
+ *      Tasks with a zero period are event driven. Their
+ *      jobs are only released by sched_activate_task() and
+ *      carry no deadline, so they run once no periodic job
+ *      is ready.
+ *
+ *      Jobs run to completion from sched_main() the same
+ *      way they do on ssched, so this scheduler runs on
+ *      both the hardware and the simulator builds.
+ *
+ *      Run with EDFSCHED_SHOW_DEBUG_DATA defined to show
+ *      debug messages.
+ *
+ *      The ISR hands a job to sched_main() by setting
+ *      task_head and then publishing scheduler_state with a
+ *      release store. sched_main() hands the CPU back the
+ *      same way once the job is done.
+ *
+ */
+#ifdef EMBEDDED_BUILD
+#include "printf.h"
+#else
+#include <stdio.h>
+#endif
+
+#include "sched.h"
+#include "generic.h"
+#include "cpu.h"
+#include "irq.h"
+#include "uart.h"
+#include "utils.h"
+#include "defer.h"
+#include "peripherals/timer.h"
+
+/**
+ * $config: EDFSCHED_TSK_MAX. Maximum number of tasks that can be
+ * registered.
+ *
+ */
+#ifndef EDFSCHED_TSK_MAX
+#define EDFSCHED_TSK_MAX  40
+    #warning Configuration EDFSCHED_TSK_MAX not set, using default value of 40
+#endif
+
+/**
+ * $config: EDFSCHED_SCHED_TICK_US. Microseconds per scheduler tick.
+ * Deadlines are tracked with tick resolution.
+ *
+ */
+#ifndef EDFSCHED_SCHED_TICK_US
+#define EDFSCHED_SCHED_TICK_US 1000
+    #warning Configuration EDFSCHED_SCHED_TICK_US not set, using default value of 1000uS.
+#endif
+
+#define US_TO_TICKS(us) ( (uint64_t)(us) / EDFSCHED_SCHED_TICK_US )
+#define SCHED_INIT_KEY 0x4EDF5C4D
+#define NO_DEADLINE ( (uint64_t)0 - 1 )
+
+/* Deadline of a job released by sched_activate_task() */
+#define ACTIVATION_DEADLINE(task) \
+    ( ( (task)->period_ticks == 0 ) ? NO_DEADLINE : ( system_tick + (task)->period_ticks ) )
+
+/* Types */
+
+/**********************************************************
+ * edf_task_cb_t_struc:
+ *
+ *      Internal task control block type
+ *
+ *      alive
+ *
+ *          Task has not been killed.
+ *
+ *      scheduled
+ *
+ *          Task is actively running.
+ *
+ *      queued
+ *
+ *          Task has a released job waiting in the ready
+ *          heap.
+ *
+ *      activated
+ *
+ *          sched_activate_task() was called while the job
+ *          was running, another job is released once it
+ *          finishes.
+ *
+ *      usr_tsk
+ *
+ *          User task definition provided durring task
+ *          registration.
+ *
+ *      release_tick
+ *
+ *          Tick of the next release.
+ *
+ *      deadline_tick
+ *
+ *          Absolute deadline of the current job, or
+ *          NO_DEADLINE for an event driven task.
+ *
+ *      period_ticks
+ *
+ *          Task period, and relative deadline, in ticks.
+ *          Zero for an event driven task.
+ *
+ *      deadline_misses
+ *
+ *          Jobs that finished after their deadline plus
+ *          releases dropped because the previous job was
+ *          still pending.
+ *
+ */
+
+typedef struct edf_task_cb_t_struc
+    {
+    boolean           alive;
+    boolean           scheduled;
+    boolean           queued;
+    boolean           activated;
+    sched_usr_tsk_t * usr_tsk;
+    uint64_t          release_tick;
+    uint64_t          deadline_tick;
+    uint64_t          period_ticks;
+    uint32_t          deadline_misses;
+    } edf_task_cb_t;
+
+/**********************************************************
+ * edf_heap_t:
+ *
+ *      Binary min-heap of task control blocks. key_offset
+ *      selects which 64-bit tick field of the control block
+ *      the heap is ordered on.
+ *
+ */
+
+typedef struct
+    {
+    edf_task_cb_t * entries[ EDFSCHED_TSK_MAX ];
+    uint32_t        cnt;
+    size_t          key_offset;
+    } edf_heap_t;
+
+#define HEAP_KEY(heap, task) ( *(uint64_t *)( (uint8_t *)(task) + (heap)->key_offset ) )
+
+typedef uint8_t scheduler_state_t;
+enum
+{
+    INIT,               /* Scheduler is initialized */
+    IDLE,               /* Scheduler is idle */
+    EXECUTE_TASK,       /* Execute the task head */
+};
+
+/**********************************************************
+ * Control variables:
+ *
+ *      system_task_list
+ *
+ *          List of all registered tasks. Task IDs index
+ *          into this list.
+ *
+ *      release_heap
+ *
+ *          Alive tasks keyed on their next release tick.
+ *
+ *      ready_heap
+ *
+ *          Released jobs keyed on their absolute deadline.
+ *
+ *      task_head
+ *
+ *          Task dispatched to sched_main().
+ *
+ *      scheduler_state
+ *
+ *          Whether task_head is running. Only accessed with
+ *          __atomic loads/stores so task_head and the task
+ *          flags are ordered around it.
+ *
+ *      system_tick
+ *
+ *          Current system tick.
+ *
+ */
+
+static int sched_init_key;
+static edf_task_cb_t system_task_list[ EDFSCHED_TSK_MAX ];
+static uint32_t registered_tasks;
+static edf_heap_t release_heap;
+static edf_heap_t ready_heap;
+static edf_task_cb_t * task_head;
+static volatile scheduler_state_t scheduler_state;
+static timer_id_t8 sched_timer_id;
+static uint64_t system_tick;
+
+/* Forward declares */
+
+static void schedule_isr(void);
+static sched_err_t register_new_task(sched_usr_tsk_t * task);
+static boolean task_set_schedulable(void);
+static void call_task_proc(edf_task_cb_t * task);
+static void release_job(edf_task_cb_t * task, uint64_t deadline_tick);
+static void heap_push(edf_heap_t * heap, edf_task_cb_t * task);
+static edf_task_cb_t * heap_pop(edf_heap_t * heap);
+
+/**********************************************************
+ *
+ *  sched_main()
+ *
+ *  DESCRIPTION:
+ *      Main scheduling function. Control is passed to this
+ *      function after kernel is fully booted.
+ *
+ *      Runs the jobs dispatched by the scheduler ISR.
+ *
+ */
+
+void sched_main(void)
+{
+    irq_flags_t flags;
+
+    /* Ensure scheduler was initialized */
+    if(sched_init_key != SCHED_INIT_KEY)
+    {
+    #ifdef EDFSCHED_SHOW_DEBUG_DATA
+        printf("\nScheduler was not initialized before control was passed to it! Scheduler will not run. Call sched_init() to fix this.");
+    #endif
+        return;
+    }
+
+    /* Single core scheduler, any other core just returns */
+    if(get_core_id() != 0)
+    {
+        return;
+    }
+
+    while(TRUE)
+    {
+        /* Bottom halves of the ISRs, a bounded amount per pass */
+        defer_run(DEFER_RUN_BUDGET);
+
+        if(__atomic_load_n(&scheduler_state, __ATOMIC_ACQUIRE) == EXECUTE_TASK)
+        {
+            call_task_proc(task_head);
+            __atomic_store_n(&scheduler_state, IDLE, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        /* Sleep until the next interrupt. IRQs are masked
+         * across the check so a dispatch can not slip in
+         * before we park */
+        flags = irq_save();
+        if(__atomic_load_n(&scheduler_state, __ATOMIC_ACQUIRE) != EXECUTE_TASK
+         && defer_pending() == FALSE)
+        {
+            cpu_idle();
+        }
+        irq_restore(flags);
+    }
+}
+
+/**********************************************************
+ *
+ *  sched_init()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contract function. Initialize the scheduler. Called
+ *      during kernel initialization.
+ *
+ */
+
+sched_err_t sched_init(sched_usr_tsk_t *tasks, uint32_t num_tasks)
+{
+    /* local vars */
+    uint32_t i;
+
+    /* initialize the control variables */
+    sched_init_key = SCHED_INIT_KEY;
+    registered_tasks = 0;
+    system_tick = 0;
+    task_head = NULL;
+    scheduler_state = INIT;
+    clr_mem(system_task_list, sizeof(system_task_list));
+    clr_mem(&release_heap, sizeof(release_heap));
+    clr_mem(&ready_heap, sizeof(ready_heap));
+    release_heap.key_offset = (size_t)&((edf_task_cb_t *)0)->release_tick;
+    ready_heap.key_offset = (size_t)&((edf_task_cb_t *)0)->deadline_tick;
+
+    /* make sure uart is initialized so we can debug print */
+    if(FALSE == uart_is_init())
+    {
+        uart_init();
+    }
+
+    /* input validation */
+    if( num_tasks > 0 && NULL == tasks )
+    {
+        return SCHED_ERR_PARAM;
+    }
+
+    /* Set up initial task list if provided one */
+    for(i = 0; i < num_tasks; i++)
+    {
+        register_new_task(&tasks[i]);
+    }
+
+    /* allocate a system timer */
+    if( TIMER_ERR_NONE != timer_alloc(&sched_timer_id, schedule_isr, EDFSCHED_SCHED_TICK_US))
+    {
+    #ifdef EDFSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to allocate a system timer. Cannot run scheduler.");
+    #endif
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_register_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted function to register a task.
+ *
+ */
+
+sched_err_t sched_register_task(sched_usr_tsk_t * task)
+{
+    return register_new_task(task);
+}
+
+/**********************************************************
+ *
+ *  register_new_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Register a new task with the system. Its first job
+ *      is released on the next tick, event driven tasks
+ *      wait for sched_activate_task().
+ *
+ */
+
+static sched_err_t register_new_task(sched_usr_tsk_t * task)
+{
+    edf_task_cb_t * cb;
+
+    if(NULL == task || NULL == task->task_func || registered_tasks >= EDFSCHED_TSK_MAX)
+    {
+    #ifdef EDFSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to register task!");
+    #endif
+        return SCHED_ERR_FAILED_REG;
+    }
+
+    cb = &system_task_list[registered_tasks];
+    cb->usr_tsk = task;
+    cb->alive = TRUE;
+    cb->scheduled = FALSE;
+    cb->queued = FALSE;
+    cb->activated = FALSE;
+    cb->deadline_misses = 0;
+
+    /* Periods under a tick still release once per tick */
+    cb->period_ticks = US_TO_TICKS(SCHED_TASK_PERIOD_US(task));
+    if(cb->period_ticks == 0 && SCHED_TASK_PERIOD_US(task) != 0)
+    {
+        cb->period_ticks = 1;
+    }
+
+    /* The new task is checked from its slot past the end of the list */
+    if(FALSE == task_set_schedulable())
+    {
+        cb->alive = FALSE;
+
+    #ifdef EDFSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to register task! budget_us=%d would make the task set miss deadlines", task->budget_us);
+    #endif
+        return SCHED_ERR_UNSCHEDULABLE;
+    }
+
+    if(cb->period_ticks != 0)
+    {
+        cb->release_tick = system_tick + 1;
+        heap_push(&release_heap, cb);
+    }
+
+    task->id = registered_tasks;
+    registered_tasks++;
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  task_set_schedulable()
+ *
+ *
+ *  DESCRIPTION:
+ *      Schedulability test of the registered tasks plus
+ *      the one being registered in the slot after them.
+ *      Only periodic tasks that declare a budget, C, are
+ *      analyzed. Jobs run to completion, so this is the test for
+ *      non-preemptive EDF of Jeffay, Stanat and Martel.
+ *      With the tasks sorted by period, T, in microseconds
+ *
+ *          sum( C / T ) <= 1
+ *
+ *      and for every task i and every L, T1 < L < Ti
+ *
+ *          L >= Ci + sum( floor( ( L - 1 ) / Tj ) * Cj )
+ *
+ *      over the tasks j with shorter periods than i, i.e.,
+ *      a job of i that blocks the shorter period tasks
+ *      still leaves room for their demand.
+ *
+ *  NOTES:
+ *      The demand only steps up at L = k * Tj + 1, so those
+ *      are the only points checked. Costs about the sum of
+ *      Ti / Tj over every pair of tasks, registration is
+ *      not a hot path.
+ *
+ */
+
+static boolean task_set_schedulable(void)
+{
+    edf_task_cb_t * sorted[EDFSCHED_TSK_MAX];
+    edf_task_cb_t * cb;
+    uint64_t period_us[EDFSCHED_TSK_MAX];
+    uint64_t budget_us[EDFSCHED_TSK_MAX];
+    uint64_t util;
+    uint64_t demand;
+    uint64_t l;
+    uint32_t cnt;
+    uint32_t i;
+    uint32_t j;
+    uint32_t m;
+
+    /* Insertion sort the analyzed tasks on period */
+    cnt = 0;
+    for(i = 0; i <= registered_tasks; i++)
+    {
+        cb = &system_task_list[i];
+        if(cb->alive == FALSE || cb->usr_tsk->budget_us == 0 || cb->period_ticks == 0)
+        {
+            continue;
+        }
+
+        j = cnt;
+        while(j > 0 && sorted[j - 1]->period_ticks > cb->period_ticks)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = cb;
+        cnt++;
+    }
+
+    util = 0;
+    for(i = 0; i < cnt; i++)
+    {
+        period_us[i] = sorted[i]->period_ticks * EDFSCHED_SCHED_TICK_US;
+        budget_us[i] = sorted[i]->usr_tsk->budget_us;
+
+        /* 16.16 fixed point, rounded up */
+        util += ( ( budget_us[i] << 16 ) + period_us[i] - 1 ) / period_us[i];
+    }
+
+    if(util > ( 1 << 16 ))
+    {
+        return FALSE;
+    }
+
+    for(i = 1; i < cnt; i++)
+    {
+        for(j = 0; j < i; j++)
+        {
+            for(l = period_us[j] + 1; l < period_us[i]; l += period_us[j])
+            {
+                if(l <= period_us[0])
+                {
+                    continue;
+                }
+
+                demand = budget_us[i];
+                for(m = 0; m < i; m++)
+                {
+                    demand += ( ( l - 1 ) / period_us[m] ) * budget_us[m];
+                }
+
+                if(demand > l)
+                {
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**********************************************************
+ *
+ *  schedule_isr()
+ *
+ *
+ *  DESCRIPTION:
+ *      Scheduler ISR. Releases due jobs and dispatches the
+ *      job with the earliest deadline once the CPU is free.
+ *
+ */
+
+static void schedule_isr(void)
+{
+    edf_task_cb_t * task;
+
+    system_tick++;
+
+    /* Release every task that is due on this tick */
+    while( release_heap.cnt > 0 && release_heap.entries[0]->release_tick <= system_tick )
+    {
+        task = heap_pop(&release_heap);
+
+        /* Killed tasks are dropped from the heap lazily */
+        if( task->alive == FALSE )
+        {
+            continue;
+        }
+
+        /* Previous job is still pending, this release is lost */
+        if( task->queued == TRUE || task->scheduled == TRUE )
+        {
+            task->deadline_misses++;
+        }
+        else
+        {
+            release_job(task, task->release_tick + task->period_ticks);
+        }
+
+        task->release_tick += task->period_ticks;
+        heap_push(&release_heap, task);
+    }
+
+    /* Dispatch the earliest deadline once the CPU is free */
+    if( __atomic_load_n(&scheduler_state, __ATOMIC_ACQUIRE) != EXECUTE_TASK )
+    {
+        while( ready_heap.cnt > 0 )
+        {
+            task = heap_pop(&ready_heap);
+            task->queued = FALSE;
+
+            if( task->alive == TRUE )
+            {
+                task->scheduled = TRUE;
+                task_head = task;
+                __atomic_store_n(&scheduler_state, EXECUTE_TASK, __ATOMIC_RELEASE);
+                break;
+            }
+        }
+    }
+}
+
+/**********************************************************
+ *
+ *  call_task_proc()
+ *
+ *
+ *  DESCRIPTION:
+ *      Call the task procedure and check the job against
+ *      its deadline. An activation that came in while it
+ *      ran releases the next job.
+ *
+ */
+
+static void call_task_proc(edf_task_cb_t * task)
+{
+    irq_flags_t flags;
+
+    if( task == NULL || task->usr_tsk->task_func == NULL )
+    {
+    #ifdef EDFSCHED_SHOW_DEBUG_DATA
+        printf("Tried to execute NULL task or task with missing task_func!");
+    #endif
+        return;
+    }
+
+    task->usr_tsk->task_func();
+
+    if( system_tick > task->deadline_tick )
+    {
+        task->deadline_misses++;
+
+    #ifdef EDFSCHED_SHOW_DEBUG_DATA
+        printf("\nDeadline miss on task with id=%d.", task->usr_tsk->id);
+    #endif
+    }
+
+    /* The ISR reads the flags and owns the ready heap */
+    flags = irq_save();
+    task->scheduled = FALSE;
+    if( task->activated == TRUE )
+    {
+        task->activated = FALSE;
+        if( task->alive == TRUE )
+        {
+            release_job(task, ACTIVATION_DEADLINE(task));
+        }
+    }
+    irq_restore(flags);
+}
+
+/**********************************************************
+ *
+ *  release_job()
+ *
+ *
+ *  DESCRIPTION:
+ *      Queue a job of the task in the ready heap. Called
+ *      from the ISR or with IRQs masked.
+ *
+ */
+
+static void release_job(edf_task_cb_t * task, uint64_t deadline_tick)
+{
+    task->deadline_tick = deadline_tick;
+    task->queued = TRUE;
+    heap_push(&ready_heap, task);
+}
+
+/**********************************************************
+ *
+ *  heap_push()
+ *
+ *
+ *  DESCRIPTION:
+ *      Insert a task into a heap.
+ *
+ */
+
+static void heap_push(edf_heap_t * heap, edf_task_cb_t * task)
+{
+    uint32_t child;
+    uint32_t parent;
+
+    if( heap->cnt >= EDFSCHED_TSK_MAX )
+    {
+        return;
+    }
+
+    child = heap->cnt++;
+    while( child > 0 )
+    {
+        parent = ( child - 1 ) / 2;
+        if( HEAP_KEY(heap, heap->entries[parent]) <= HEAP_KEY(heap, task) )
+        {
+            break;
+        }
+
+        heap->entries[child] = heap->entries[parent];
+        child = parent;
+    }
+
+    heap->entries[child] = task;
+}
+
+/**********************************************************
+ *
+ *  heap_pop()
+ *
+ *
+ *  DESCRIPTION:
+ *      Remove and return the task with the smallest key, or
+ *      NULL if the heap is empty.
+ *
+ */
+
+static edf_task_cb_t * heap_pop(edf_heap_t * heap)
+{
+    edf_task_cb_t * root;
+    edf_task_cb_t * last;
+    uint32_t parent;
+    uint32_t child;
+
+    if( heap->cnt == 0 )
+    {
+        return NULL;
+    }
+
+    root = heap->entries[0];
+    last = heap->entries[--heap->cnt];
+
+    parent = 0;
+    child = 1;
+    while( child < heap->cnt )
+    {
+        if( ( child + 1 ) < heap->cnt
+         && HEAP_KEY(heap, heap->entries[child + 1]) < HEAP_KEY(heap, heap->entries[child]) )
+        {
+            child++;
+        }
+
+        if( HEAP_KEY(heap, last) <= HEAP_KEY(heap, heap->entries[child]) )
+        {
+            break;
+        }
+
+        heap->entries[parent] = heap->entries[child];
+        parent = child;
+        child = ( 2 * parent ) + 1;
+    }
+
+    heap->entries[parent] = last;
+
+    return root;
+}
+
+/**********************************************************
+ *
+ *  sched_kill_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Killed tasks fall out
+ *      of the heaps the next time they reach the root.
+ *
+ */
+
+sched_err_t sched_kill_task(sched_task_id_t task_id)
+{
+    if( task_id >= registered_tasks || system_task_list[task_id].alive == FALSE )
+    {
+        return SCHED_ERR_FAILED_UPDATE;
+    }
+
+    system_task_list[task_id].alive = FALSE;
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_activate_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Release a job of the
+ *      task right away, with a deadline one period out. A
+ *      job that is already queued absorbs the activation,
+ *      a running one is followed by another job.
+ *
+ *  NOTES:
+ *      Safe from ISRs.
+ *
+ */
+
+sched_err_t sched_activate_task(sched_task_id_t task_id)
+{
+    irq_flags_t flags;
+    edf_task_cb_t * task;
+
+    if( task_id >= registered_tasks || system_task_list[task_id].alive == FALSE )
+    {
+        return SCHED_ERR_FAILED_UPDATE;
+    }
+
+    task = &system_task_list[task_id];
+
+    flags = irq_save();
+    if( task->scheduled == TRUE )
+    {
+        task->activated = TRUE;
+    }
+    else if( task->queued == FALSE )
+    {
+        release_job(task, ACTIVATION_DEADLINE(task));
+    }
+    irq_restore(flags);
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_register_server()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, post
+ *      aperiodic work from a periodic task instead.
+ *
+ */
+
+sched_err_t sched_register_server(sched_usr_tsk_t * task)
+{
+    (void)task;
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_server_post()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, see
+ *      sched_register_server().
+ *
+ */
+
+sched_err_t sched_server_post(sched_task_id_t server_id, spsc_work_func_t func, void * ctx, uint32_t arg)
+{
+    (void)server_id;
+    (void)func;
+    (void)ctx;
+    (void)arg;
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_yield()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Tasks here always
+ *      run to completion, so there is nothing to yield to.
+ *
+ */
+
+sched_err_t sched_yield(void)
+{
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_sleep_us()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, see
+ *      sched_yield().
+ *
+ */
+
+sched_err_t sched_sleep_us(uint32_t us)
+{
+    (void)us;
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_wait_until()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, see
+ *      sched_yield().
+ *
+ */
+
+sched_err_t sched_wait_until(uint64_t tick)
+{
+    (void)tick;
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_wait_activation()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, see
+ *      sched_yield().
+ *
+ */
+
+sched_err_t sched_wait_activation(void)
+{
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_get_current_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function.
+ *
+ */
+
+sched_err_t sched_get_current_task(sched_task_id_t * task_id)
+{
+    if(task_id == NULL || get_core_id() != 0
+     || __atomic_load_n(&scheduler_state, __ATOMIC_ACQUIRE) != EXECUTE_TASK)
+    {
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    *task_id = task_head->usr_tsk->id;
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_boost_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, jobs
+ *      run to completion so a mutex is never held across
+ *      another task.
+ *
+ */
+
+sched_err_t sched_boost_task(sched_task_id_t task_id)
+{
+    (void)task_id;
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_unboost_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, see
+ *      sched_boost_task().
+ *
+ */
+
+sched_err_t sched_unboost_task(sched_task_id_t task_id)
+{
+    (void)task_id;
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_get_tick()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function.
+ *
+ */
+
+uint64_t sched_get_tick(void)
+{
+    return system_tick;
+}
@@ -4,6 +4,8 @@
  * 
  */
 
+#pragma once
+
 #include "generic.h"
 #include "cpu_impl.h"
 
@@ -22,6 +24,17 @@
 
 #define CYCLES_PER_US ((uint32_t)SYSTEM_CLOCK_FREQUENCY / 1000000)
 
+/**********************************************************
+ * 
+ * CPU_CORE_COUNT
+ * 
+ * DESCRIPTION:
+ *      Number of cores the kernel brings up. CPU must
+ *      define this. Core 0 boots the kernel, the others
+ *      are started with cpu_start_core().
+ * 
+ */
+
 
 /**********************************************************
  * 
@@ -53,4 +66,53 @@ boolean cpu_power_on_usb(void);
  * 
  */
 
-boolean cpu_init(void);
\ No newline at end of file
+boolean cpu_init(void);
+
+
+/**********************************************************
+ * 
+ * cpu_start_core()
+ * 
+ * DESCRIPTION:
+ *      Release a secondary core into entry. entry runs on
+ *      its own stack and must not return.
+ * 
+ * NOTES:
+ *      true Core was released
+ *      false Core does not exist or is core 0
+ * 
+ */
+
+boolean cpu_start_core(uint32_t core, void_func_t entry);
+
+
+/**********************************************************
+ * 
+ * cpu_idle()
+ * 
+ * DESCRIPTION:
+ *      Park the calling core until an interrupt arrives or
+ *      another core calls cpu_wake_cores().
+ * 
+ * NOTES:
+ *      Call with IRQs masked (see irq_save()). A wake up
+ *      that lands between masking IRQs and calling this is
+ *      not lost, so the caller can check for work and go
+ *      idle without racing the ISR. IRQs are still masked
+ *      on return.
+ * 
+ */
+
+void cpu_idle(void);
+
+
+/**********************************************************
+ * 
+ * cpu_wake_cores()
+ * 
+ * DESCRIPTION:
+ *      Wake every core parked in cpu_idle().
+ * 
+ */
+
+void cpu_wake_cores(void);
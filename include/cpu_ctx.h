@@ -0,0 +1,86 @@
+/**********************************************************
+ *
+ *  cpu_ctx.h
+ *
+ *
+ *  DESCRIPTION:
+ *      Execution contexts on their own stacks, i.e.,
+ *      coroutines for the kernel
+ *
+ *  NOTES:
+ *      A context is switched to and from explicitly with
+ *      cpu_ctx_switch(), nothing here is preemptive. Only
+ *      the callee saved state is kept, the IRQ mask is not.
+ *
+ *      The simulator maps contexts onto ucontext since
+ *      jumping between stacks with longjmp() is undefined
+ *      on the host.
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+
+#ifdef EMBEDDED_BUILD
+
+#include "cpu_jmp.h"
+
+typedef struct
+    {
+    cpu_jmp_buf_t regs;
+    } cpu_ctx_t;
+
+/* Slots of x29, x30 and sp in cpu_jmp_buf_t */
+#define CPU_CTX_FP_SLOT 10
+#define CPU_CTX_LR_SLOT 11
+#define CPU_CTX_SP_SLOT 12
+
+void cpu_ctx_switch(cpu_ctx_t * from, cpu_ctx_t * to);
+
+/**********************************************************
+ *
+ *  cpu_ctx_init()
+ *
+ *  DESCRIPTION:
+ *      Set up ctx to start running entry on the given
+ *      stack the first time it is switched to. entry must
+ *      never return.
+ *
+ */
+
+static inline void cpu_ctx_init(cpu_ctx_t * ctx, void * stack, uint32_t stack_size, void_func_t entry)
+{
+    clr_mem(ctx, sizeof(cpu_ctx_t));
+
+    /* cpu_ctx_switch() "returns" into entry with a fresh,
+     * 16 byte aligned stack */
+    ctx->regs[CPU_CTX_FP_SLOT] = 0;
+    ctx->regs[CPU_CTX_LR_SLOT] = (uint64_t)entry;
+    ctx->regs[CPU_CTX_SP_SLOT] = ( (uint64_t)stack + stack_size ) & ~(uint64_t)0xF;
+}
+
+#else
+
+#include <ucontext.h>
+
+typedef struct
+    {
+    ucontext_t uc;
+    } cpu_ctx_t;
+
+static inline void cpu_ctx_switch(cpu_ctx_t * from, cpu_ctx_t * to)
+{
+    swapcontext(&from->uc, &to->uc);
+}
+
+static inline void cpu_ctx_init(cpu_ctx_t * ctx, void * stack, uint32_t stack_size, void_func_t entry)
+{
+    getcontext(&ctx->uc);
+    ctx->uc.uc_stack.ss_sp = stack;
+    ctx->uc.uc_stack.ss_size = stack_size;
+    ctx->uc.uc_link = NULL;
+    makecontext(&ctx->uc, entry, 0);
+}
+
+#endif
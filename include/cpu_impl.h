@@ -19,6 +19,12 @@
     #error "Unsupported RPI_VERSION"
 #endif
 
+/* Both the 3 and 4 have four Cortex-A cores. The simulator
+ * build overrides this with the number of cores it fakes. */
+#ifndef CPU_CORE_COUNT
+    #define CPU_CORE_COUNT 4
+#endif
+
 #define RPI_3B_PLUS 1
 
 #ifdef RPI_SUB_VERSION
@@ -0,0 +1,41 @@
+/**********************************************************
+ * 
+ *  cpu_jmp.h
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Non-local jumps, i.e., setjmp()/longjmp() for the
+ *      kernel
+ *
+ *  NOTES:
+ *      The hardware build has no C library, so the CPU
+ *      provides these. Only the callee saved registers and
+ *      the stack pointer are kept, the IRQ mask is not.
+ *
+ *      The simulator maps them onto sigsetjmp()/siglongjmp()
+ *      so they can unwind out of a signal handler.
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+
+#ifdef EMBEDDED_BUILD
+
+/* x19-x30 and sp */
+typedef uint64_t cpu_jmp_buf_t[ 13 ];
+
+int cpu_setjmp(cpu_jmp_buf_t buf) __attribute__((returns_twice));
+void cpu_longjmp(cpu_jmp_buf_t buf, int val) __attribute__((noreturn));
+
+#else
+
+#include <setjmp.h>
+
+typedef sigjmp_buf cpu_jmp_buf_t;
+
+#define cpu_setjmp(buf) sigsetjmp(buf, 1)
+#define cpu_longjmp(buf, val) siglongjmp(buf, val)
+
+#endif
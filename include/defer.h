@@ -0,0 +1,48 @@
+/**********************************************************
+ *
+ *  defer.h
+ *
+ *
+ *  DESCRIPTION:
+ *      Deferred work, i.e., ISR bottom halves
+ *
+ *  NOTES:
+ *      ISRs post anything that is too slow for interrupt
+ *      context (printing, protocol processing, ...) with
+ *      defer_work() and the scheduler runs it from
+ *      sched_main() on core 0 with defer_run().
+ *
+ *      The queue is a single producer ring, so only ISRs on
+ *      core 0 may post to it. They do not nest, so they
+ *      count as one producer.
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+#include "spsc_ring.h"
+
+/**
+ * $config: DEFER_QUEUE_LEN. Number of work items that can be waiting at once.
+ * Must be a power of two. Work posted to a full queue is dropped and counted,
+ * see defer_dropped().
+ *
+ */
+#ifndef DEFER_QUEUE_LEN
+#define DEFER_QUEUE_LEN 32
+#endif
+
+/**
+ * $config: DEFER_RUN_BUDGET. Most work items sched_main() runs per pass of
+ * its loop, so a burst of interrupts can not hold off the tasks.
+ *
+ */
+#ifndef DEFER_RUN_BUDGET
+#define DEFER_RUN_BUDGET 8
+#endif
+
+boolean defer_work(spsc_work_func_t func, void * ctx, uint32_t arg);
+uint32_t defer_run(uint32_t max_items);
+boolean defer_pending(void);
+uint32_t defer_dropped(void);
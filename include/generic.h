@@ -29,6 +29,7 @@
 #define BS_MAX(size) ( BS_ALL & ~( 1 << ((size * 8) -1) ) )
 
 typedef int sint32_t;
+typedef long long sint64_t;
 typedef unsigned int uint32_t;
 typedef unsigned char uint8_t;
 typedef unsigned short uint16_t;
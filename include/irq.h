@@ -1,6 +1,68 @@
 #pragma once
 
+#include "generic.h"
+
+/* Saved CPU interrupt mask, see irq_save() */
+typedef uint64_t irq_flags_t;
+
+/* Interrupt source, numbered by the platform */
+typedef uint32_t irq_source_t;
+
+typedef void (*irq_handler_t)(void * ctx);
+
 /* Contracted IRQ functions */
 void irq_init(void);
 void irq_sys_enable(void);
 boolean irq_enable_usb(void);
+
+/**********************************************************
+ * 
+ *  irq_save()/irq_restore()
+ * 
+ *  DESCRIPTION:
+ *      Mask IRQs on the calling core and return the previous
+ *      mask, then put the previous mask back. Pairs nest.
+ *
+ */
+
+irq_flags_t irq_save(void);
+void irq_restore(irq_flags_t flags);
+
+/**********************************************************
+ * 
+ *  irq_set_return()
+ * 
+ *  DESCRIPTION:
+ *      Called from an IRQ handler. Once the IRQ returns, the
+ *      interrupted context resumes at func instead of where
+ *      it was interrupted.
+ *
+ *  NOTES:
+ *      func runs on the interrupted context's stack and
+ *      must not return, i.e., it has to unwind with
+ *      cpu_longjmp().
+ *
+ */
+
+void irq_set_return(void_func_t func);
+
+/**********************************************************
+ * 
+ *  irq_register()
+ * 
+ *  DESCRIPTION:
+ *      Have handler( ctx ) called from the IRQ whenever
+ *      source is pending, a NULL handler takes it off
+ *      again. Returns FALSE for a source the platform does
+ *      not have.
+ *
+ *  NOTES:
+ *      Register before enabling the source. The handler
+ *      has to clear the interrupt at the device, a pending
+ *      source without one is masked so it can not storm.
+ *      Handlers run with IRQs masked and must not print or
+ *      block, see defer_work().
+ *
+ */
+
+boolean irq_register(irq_source_t source, irq_handler_t handler, void * ctx);
@@ -21,6 +21,10 @@
 
 #define LOW_MEMORY              (2 * SECTION_SIZE)
 
+/* Every core gets its own stack. Core n's stack starts at
+ * LOW_MEMORY - ( n * CORE_STACK_SIZE ) and grows down */
+#define CORE_STACK_SIZE         (0x40000)
+
 #ifndef __ASSEMBLER__
 
 void memzero(unsigned long src, unsigned long n);
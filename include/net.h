@@ -11,4 +11,7 @@ void strat_net_udp_tx( void * out, size_t size );
 void set_static_ip();
 void net_init();
 int get_packet(char *buffer, size_t buffer_size, int timeout_us);
-void net_proc();
\ No newline at end of file
+void net_rx_irq_enable(void_func_t irq_cb);
+void net_rx_irq_ack(void);
+void net_proc_start(void);
+void net_proc(void * ctx, uint32_t arg);
\ No newline at end of file
@@ -3,14 +3,20 @@
 // todo move this into rpi specific file
 /* Set the correct Peripheral base */
 
+/* LOCAL_PBASE is the ARM core-local block, the per-core
+ * timer and mailbox interrupts */
+
 #if RPI_VERSION == 3
 #define PBASE  0x3F000000UL
+#define LOCAL_PBASE  0x40000000UL
 
 #elif RPI_VERSION == 4
 #define PBASE  0xFE000000UL
+#define LOCAL_PBASE  0xFF800000UL
 
 #else
 #define PBASE  0x00000000UL
+#define LOCAL_PBASE  0x00000000UL
 #error "Unknown PI version"
 
 #endif
@@ -23,4 +23,103 @@ enum
     };
 
 void timer_init();
+
+/**********************************************************
+ * 
+ *  timer_alloc()
+ * 
+ *  DESCRIPTION:
+ *      Reserve a free hardware timer and have it call
+ *      irq_cb from its IRQ every ticks microseconds. The
+ *      timer's id is returned in timer_id. Returns
+ *      TIMER_ERR_RESOURCE_UNAVAILABLE once every timer is
+ *      taken.
+ *
+ *  NOTES:
+ *      There are only a couple of hardware timers, the
+ *      scheduler takes one. Anything that needs timeouts of
+ *      its own should use the software timers in
+ *      soft_timer.h, which all share a single one.
+ *
+ */
+
 timer_err_t8 timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks);
+
+/**********************************************************
+ * 
+ *  timer_alloc_local()
+ * 
+ *  DESCRIPTION:
+ *      timer_alloc() for the calling core's own timer,
+ *      whose IRQ comes in on that core. Returns
+ *      TIMER_ERR_RESOURCE_UNAVAILABLE if it is taken.
+ *
+ *  NOTES:
+ *      Every core has exactly one. timer_free() and
+ *      timer_set_next() on it have to be called from the
+ *      core that allocated it, and IRQs must be enabled on
+ *      that core for it to fire, see irq_sys_enable().
+ *
+ */
+
+timer_err_t8 timer_alloc_local(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks);
+
+/**********************************************************
+ * 
+ *  timer_free()
+ * 
+ *  DESCRIPTION:
+ *      Stop a timer from timer_alloc() and give it back.
+ *
+ */
+
+timer_err_t8 timer_free(timer_id_t8 timer_id);
+
+/**********************************************************
+ * 
+ *  timer_set_next()
+ * 
+ *  DESCRIPTION:
+ *      Fire the next interrupt of an allocated timer ticks
+ *      from now instead of after its regular interval. Can
+ *      be called from the timer's own IRQ callback, the
+ *      interrupts after that go back to the interval given
+ *      to timer_alloc() unless set again.
+ *
+ *  NOTES:
+ *      Used by tickless schedulers to sleep until the next
+ *      event.
+ *
+ */
+
+timer_err_t8 timer_set_next(timer_id_t8 timer_id, uint32_t ticks);
+
+/**********************************************************
+ * 
+ *  clock_now_us()
+ * 
+ *  DESCRIPTION:
+ *      Monotonic time in microseconds, from the free
+ *      running system counter. It is 64 bits wide, so it
+ *      does not wrap and timestamps can be compared and
+ *      subtracted as is.
+ *
+ *  NOTES:
+ *      Safe to call from tasks, ISRs and any core.
+ *
+ */
+
+uint64_t clock_now_us(void);
+
+/**********************************************************
+ * 
+ *  clock_now_ns()
+ * 
+ *  DESCRIPTION:
+ *      clock_now_us() in nanoseconds, with whatever finer
+ *      resolution the platform's clock has. The BCM system
+ *      counter only counts microseconds.
+ *
+ */
+
+uint64_t clock_now_ns(void);
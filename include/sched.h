@@ -10,9 +10,19 @@
 #pragma once    
 
 #include "generic.h"
+#include "spsc_ring.h"
 
 typedef uint32_t sched_task_id_t;
 
+typedef uint8_t sched_overrun_policy_t;
+enum
+{
+    SCHED_OVERRUN_NONE,         /* Let the task run on and report it */
+    SCHED_OVERRUN_SKIP,         /* Drop the release after an overrun */
+    SCHED_OVERRUN_ABORT,        /* Unwind the task once its budget is used up */
+    SCHED_OVERRUN_DEGRADE,      /* Move the task to its degraded period */
+};
+
 
 /**********************************************************
  *
@@ -26,6 +36,20 @@ typedef uint32_t sched_task_id_t;
  *      may not be able to run at this period (e.g., due to
  *      overruns, missed duty cycles, etc.)
  *
+ *      Zero makes the task event driven, it is then only
+ *      released by sched_activate_task(), e.g., from a wait
+ *      object it is bound to (see sched_wait.h). Event
+ *      driven tasks are not analyzed by the schedulability
+ *      test.
+ *
+ *  period_us
+ *
+ *      Period in microseconds, used instead of period_ms
+ *      when non-zero, e.g., for a 200us control loop. A
+ *      task is still released at most once per scheduler
+ *      tick, a period shorter than the tick misses the
+ *      releases in between.
+ *
  *  task_func
  *
  *      Task function. It is important to consider the type of
@@ -37,11 +61,71 @@ typedef uint32_t sched_task_id_t;
  *      Task ID. Set by scheduler. 
  *
  *      IMPORTANT:
- *      Early versions of this scheduler will step the task id
- *      at an incremement of 1 starting from 0. It is NOT safe
- *      to assume that this will always be the case. The user
- *      should assume that the task id value itself has no use
- *      other than to interface with the simple scheduler.
+ *      The task id is an opaque handle. The simple scheduler
+ *      reuses the slots of killed tasks and moves each slot
+ *      on a generation as it does, so the id of a killed task
+ *      stops working rather than naming whichever task got
+ *      its slot. The user should assume that the task id
+ *      value itself has no use other than to interface with
+ *      the scheduler.
+ *
+ *  core_affinity
+ *
+ *      Bitmask of the cores the task may run on, bit n for
+ *      core n. Zero means any core, so tasks that do not
+ *      set it are free to move. Schedulers that only run
+ *      on one core ignore it.
+ *
+ *  overrun_policy
+ *
+ *      What the scheduler does when the task runs past its
+ *      budget. Defaults to SCHED_OVERRUN_NONE. Schedulers
+ *      that do not support a policy treat it as NONE.
+ *
+ *      SCHED_OVERRUN_ABORT unwinds the task from an
+ *      interrupt, so the task must not hold locks or other
+ *      resources with IRQs enabled.
+ *
+ *  budget_us
+ *
+ *      Execution budget of one cycle in microseconds, i.e.,
+ *      the task's worst case execution time. Zero means the
+ *      task period.
+ *
+ *      Registration runs a schedulability test over every
+ *      task that declares a budget and turns the task away
+ *      with SCHED_ERR_UNSCHEDULABLE if the set could miss a
+ *      deadline with it. Tasks without a budget are not
+ *      analyzed and count as taking no time, so only a task
+ *      set where every task declares one is guaranteed.
+ *
+ *  degraded_period_ms
+ *
+ *      Period the task drops to under SCHED_OVERRUN_DEGRADE.
+ *      Zero means twice period_ms.
+ *
+ *  stack_size
+ *
+ *      Bytes of stack to run the task on. A task with its
+ *      own stack may give up the CPU part way through a
+ *      cycle with sched_yield(), sched_sleep_us() or
+ *      sched_wait_until(). Zero runs the task to completion
+ *      on the scheduler's stack.
+ *
+ *  phase_us
+ *
+ *      Delay of the task's first release, in microseconds
+ *      after the tick following its registration. Giving
+ *      tasks with harmonic periods different phases keeps
+ *      their releases out of the same tick. Zero releases
+ *      on that tick.
+ *
+ *      SCHED_PHASE_AUTO has the scheduler pick the phase
+ *      that puts the least work in the busiest tick the
+ *      task is released on, given the tasks already
+ *      registered. List tasks heaviest first to get the
+ *      most out of it. Schedulers that do not support
+ *      phases release the task straight away.
  *
  */
 
@@ -50,8 +134,22 @@ typedef struct
     uint32_t period_ms;
     void (*task_func)(void);
     sched_task_id_t id;
+    uint32_t core_affinity;
+    sched_overrun_policy_t overrun_policy;
+    uint32_t budget_us;
+    uint32_t degraded_period_ms;
+    uint32_t stack_size;
+    uint32_t period_us;
+    uint32_t phase_us;
     } sched_usr_tsk_t;
 
+/* phase_us value that lets the scheduler pick the phase */
+#define SCHED_PHASE_AUTO 0xFFFFFFFFUL
+
+/* Task period in microseconds, zero for an event driven task */
+#define SCHED_TASK_PERIOD_US(task) \
+    ( ( (task)->period_us != 0 ) ? (uint64_t)(task)->period_us : ( (uint64_t)(task)->period_ms * 1000 ) )
+
 typedef uint8_t sched_err_t;
 enum
 {
@@ -60,6 +158,7 @@ enum
     SCHED_ERR_FAILED_REG,       /* Failed to register task */
     SCHED_ERR_PARAM,            /* Invalid parameters */
     SCHED_ERR_INVLD_STATE,      /* Scheduler is in an invalid state */
+    SCHED_ERR_UNSCHEDULABLE,    /* Task set would miss deadlines */
 };
 
 /*
@@ -88,6 +187,10 @@ sched_err_t sched_init(sched_usr_tsk_t *tasks, uint32_t num_tasks);
  *     Called in user and kernel space to register a task.
  *     eventually, there will be a distinction between these
  *
+ *     Returns SCHED_ERR_UNSCHEDULABLE, and registers
+ *     nothing, if the task would leave the task set unable
+ *     to meet its deadlines, see budget_us.
+ *
  */
 
 sched_err_t sched_register_task(sched_usr_tsk_t * task);
@@ -111,10 +214,127 @@ sched_err_t sched_kill_task(sched_task_id_t task_id);
  *      activate a task, i.e., allow it to be ran on the
  *      scheduler.
  *
+ *      A task that is not running is released straight
+ *      away, without waiting for its period. A task blocked
+ *      in sched_wait_activation() is resumed. A task that
+ *      is running, or part way through a cycle, keeps the
+ *      activation for its next sched_wait_activation(), or
+ *      runs another cycle once it finishes, so activations
+ *      are never lost. Safe from ISRs.
+ *
  */
 
 sched_err_t sched_activate_task(sched_task_id_t task_id);
 
+/**********************************************************
+ *
+ *  sched_wait_activation()
+ *
+ *  DESCRIPTION:
+ *      Block the calling task until sched_activate_task()
+ *      is called on it. Returns straight away if it already
+ *      was since the task last waited.
+ *
+ *  NOTES:
+ *      Same restrictions as sched_yield(). Activations do
+ *      not say why they happened, callers check whatever
+ *      they are waiting on again, see sched_wait.h.
+ *
+ */
+
+sched_err_t sched_wait_activation(void);
+
+/**********************************************************
+ *
+ *  sched_get_current_task()
+ *
+ *  DESCRIPTION:
+ *      Get the id of the task running on the calling core.
+ *      Returns SCHED_ERR_INVLD_STATE outside of a task.
+ *
+ */
+
+sched_err_t sched_get_current_task(sched_task_id_t * task_id);
+
+/**********************************************************
+ *
+ *  sched_boost_task()
+ *
+ *  DESCRIPTION:
+ *      Have the task inherit the urgency of tasks waiting
+ *      on it, i.e., run it ahead of every ready task that
+ *      is not boosted until sched_unboost_task() undoes
+ *      it. Boosts nest. Used by sched_mutex.h for priority
+ *      inheritance.
+ *
+ *  NOTES:
+ *      Boosts and unboosts are counted, one may reach the
+ *      scheduler before the other that it balances.
+ *      Schedulers whose tasks run to completion on a single
+ *      core never have a mutex held across another task,
+ *      they return SCHED_ERR_INVLD_STATE.
+ *
+ */
+
+sched_err_t sched_boost_task(sched_task_id_t task_id);
+
+/**********************************************************
+ *
+ *  sched_unboost_task()
+ *
+ *  DESCRIPTION:
+ *      Undo one sched_boost_task().
+ *
+ */
+
+sched_err_t sched_unboost_task(sched_task_id_t task_id);
+
+/**********************************************************
+ *
+ *  sched_register_server()
+ *
+ *  DESCRIPTION:
+ *      Register a server, i.e., a task that runs aperiodic
+ *      jobs posted to it with sched_server_post() as soon
+ *      as they arrive, for at most budget_us of CPU time
+ *      every period. The budget is topped back up at the
+ *      start of every period. Jobs left over once it is
+ *      used up wait for the next period.
+ *
+ *  NOTES:
+ *      Both a period and budget_us are required, the
+ *      server counts as a task taking budget_us every
+ *      period in the schedulability test. task_func,
+ *      overrun_policy and stack_size are not used.
+ *
+ *      The budget is checked between jobs, a job always
+ *      runs to completion. Keep jobs short next to the
+ *      budget, the last job of a period may run past it
+ *      by up to its own length.
+ *
+ *      Schedulers without servers return
+ *      SCHED_ERR_INVLD_STATE.
+ *
+ */
+
+sched_err_t sched_register_server(sched_usr_tsk_t * task);
+
+/**********************************************************
+ *
+ *  sched_server_post()
+ *
+ *  DESCRIPTION:
+ *      Post func( ctx, arg ) to run on a server. Returns
+ *      SCHED_ERR_FAILED_UPDATE if the server's job queue is
+ *      full.
+ *
+ *  NOTES:
+ *      Safe from ISRs and from tasks on any core.
+ *
+ */
+
+sched_err_t sched_server_post(sched_task_id_t server_id, spsc_work_func_t func, void * ctx, uint32_t arg);
+
 
 /**********************************************************
  *
@@ -129,4 +349,81 @@ sched_err_t sched_activate_task(sched_task_id_t task_id);
  *
  */
 
-void sched_main();
\ No newline at end of file
+void sched_main();
+
+/**********************************************************
+ *
+ *  sched_yield()
+ *
+ *  DESCRIPTION:
+ *      Give the CPU back to the scheduler and carry on
+ *      once the other ready tasks have had a go.
+ *
+ *  NOTES:
+ *      sched_yield(), sched_sleep_us() and
+ *      sched_wait_until() only work from a task with its
+ *      own stack (see stack_size), and never from an ISR.
+ *      Anywhere else, or on a scheduler without stackful
+ *      tasks, they return SCHED_ERR_INVLD_STATE straight
+ *      away.
+ *
+ */
+
+sched_err_t sched_yield(void);
+
+/**********************************************************
+ *
+ *  sched_sleep_us()
+ *
+ *  DESCRIPTION:
+ *      Give the CPU back to the scheduler for at least us
+ *      microseconds, rounded up to scheduler ticks.
+ *
+ */
+
+sched_err_t sched_sleep_us(uint32_t us);
+
+/**********************************************************
+ *
+ *  sched_wait_until()
+ *
+ *  DESCRIPTION:
+ *      Give the CPU back to the scheduler until the given
+ *      scheduler tick, see sched_get_tick().
+ *
+ */
+
+sched_err_t sched_wait_until(uint64_t tick);
+
+/**********************************************************
+ *
+ *  sched_get_tick()
+ *
+ *  DESCRIPTION:
+ *      Current scheduler tick.
+ *
+ *  NOTES:
+ *      Use clock_now_us() for the time in microseconds.
+ *
+ */
+
+uint64_t sched_get_tick(void);
+
+#ifdef SCHED_PREEMPTIVE
+/**********************************************************
+ *
+ *  sched_ctx_switch()
+ *
+ *  DESCRIPTION:
+ *      Pick the context to run next. Called with IRQs
+ *      masked, both on IRQ exit and when a task yields,
+ *      with the exception frame of the current context.
+ *
+ *  NOTES:
+ *      Returns the frame of the context to resume. Only
+ *      needed by preemptive scheduler implementations.
+ *
+ */
+
+void * sched_ctx_switch(void * frame);
+#endif
\ No newline at end of file
@@ -0,0 +1,191 @@
+/**********************************************************
+ *
+ *  sched_mutex.h
+ *
+ *
+ *  DESCRIPTION:
+ *      Mutexes for tasks sharing a driver or other state
+ *      across tasks and cores
+ *
+ *  NOTES:
+ *      Taking a free mutex costs one spinlock round trip and
+ *      no scheduler call. spinlock.h already uses the
+ *      exclusive builtins where they work and a bakery lock
+ *      on the hardware, whose uncached memory has no
+ *      exclusive monitor.
+ *
+ *      A task that finds the mutex held queues up behind it,
+ *      and the holder inherits its urgency through
+ *      sched_boost_task() until it unlocks. Unlocking hands
+ *      the mutex straight to the first waiter, so a waiter
+ *      can not be overtaken and waits out at most the
+ *      critical sections queued in front of it.
+ *
+ *      Waiters with their own stack block in
+ *      sched_wait_activation(). Anything else spins, so a
+ *      mutex taken by tasks without a stack must not be held
+ *      across sched_yield(), sched_sleep_us() or the like.
+ *      Mutexes are never taken from ISRs. A killed task
+ *      keeps the mutexes it held.
+ *
+ *      Every mutex counts how often it was taken, how often
+ *      that meant waiting and for how long, see
+ *      sched_mutex_print_stats() to find the hot ones.
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+#include "spinlock.h"
+#include "sched.h"
+
+/**********************************************************
+ *
+ *  sched_mutex_stats_t
+ *
+ *  locks
+ *
+ *      Times the mutex was taken.
+ *
+ *  contended
+ *
+ *      Times it was held already, i.e., the caller had to
+ *      wait.
+ *
+ *  wait_us, max_wait_us
+ *
+ *      Total and longest time spent waiting, from the
+ *      system counter.
+ *
+ */
+
+typedef struct
+    {
+    uint32_t    locks;
+    uint32_t    contended;
+    uint64_t    wait_us;
+    uint32_t    max_wait_us;
+    } sched_mutex_stats_t;
+
+typedef struct sched_mutex_waiter_t_struc sched_mutex_waiter_t;
+
+/**********************************************************
+ *
+ *  sched_mutex_t
+ *
+ *      Zeroed memory is an unlocked mutex that is not
+ *      listed by sched_mutex_print_stats().
+ *
+ *  lock
+ *
+ *      Guards the mutex, held with IRQs masked.
+ *
+ *  held, owner, owner_valid
+ *
+ *      Mutex is held, and by which task. A holder outside
+ *      of any task, e.g., during kernel initialization, has
+ *      no owner.
+ *
+ *  boosted
+ *
+ *      The owner was boosted on behalf of the waiters.
+ *
+ *  wait_head, wait_tail
+ *
+ *      Waiters in arrival order, each on its own stack.
+ *
+ *  name, next
+ *
+ *      Name printed with the stats, and the next mutex in
+ *      the stats list.
+ *
+ */
+
+typedef struct sched_mutex_t_struc
+    {
+    spinlock_t                   lock;
+    boolean                      held;
+    boolean                      owner_valid;
+    boolean                      boosted;
+    sched_task_id_t              owner;
+    sched_mutex_waiter_t       * wait_head;
+    sched_mutex_waiter_t       * wait_tail;
+    sched_mutex_stats_t          stats;
+    const char                 * name;
+    struct sched_mutex_t_struc * next;
+    } sched_mutex_t;
+
+/**********************************************************
+ *
+ *  sched_mutex_init()
+ *
+ *  DESCRIPTION:
+ *      Set up an unlocked mutex and list it under name for
+ *      sched_mutex_print_stats(). A mutex is initialized
+ *      once and never goes away.
+ *
+ */
+
+void sched_mutex_init(sched_mutex_t * mutex, const char * name);
+
+/**********************************************************
+ *
+ *  sched_mutex_lock()
+ *
+ *  DESCRIPTION:
+ *      Take the mutex, waiting for it if it is held.
+ *      Returns SCHED_ERR_INVLD_STATE if the calling task
+ *      holds it already.
+ *
+ */
+
+sched_err_t sched_mutex_lock(sched_mutex_t * mutex);
+
+/**********************************************************
+ *
+ *  sched_mutex_trylock()
+ *
+ *  DESCRIPTION:
+ *      Take the mutex if it is free, returns FALSE if it is
+ *      held. Not counted as contention.
+ *
+ */
+
+boolean sched_mutex_trylock(sched_mutex_t * mutex);
+
+/**********************************************************
+ *
+ *  sched_mutex_unlock()
+ *
+ *  DESCRIPTION:
+ *      Give the mutex up, to the first waiter if there is
+ *      one. Returns SCHED_ERR_INVLD_STATE if the caller
+ *      does not hold it.
+ *
+ */
+
+sched_err_t sched_mutex_unlock(sched_mutex_t * mutex);
+
+/**********************************************************
+ *
+ *  sched_mutex_get_stats()
+ *
+ *  DESCRIPTION:
+ *      Copy out the mutex's counters.
+ *
+ */
+
+void sched_mutex_get_stats(sched_mutex_t * mutex, sched_mutex_stats_t * stats);
+
+/**********************************************************
+ *
+ *  sched_mutex_print_stats()
+ *
+ *  DESCRIPTION:
+ *      Print the counters of every mutex set up with
+ *      sched_mutex_init().
+ *
+ */
+
+void sched_mutex_print_stats(void);
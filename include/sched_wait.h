@@ -0,0 +1,153 @@
+/**********************************************************
+ *
+ *  sched_wait.h
+ *
+ *
+ *  DESCRIPTION:
+ *      Wait objects, i.e., event flags, counting semaphores
+ *      and message boxes that tasks wait on instead of
+ *      polling
+ *
+ *  NOTES:
+ *      Every object wakes one task, the task bound to it.
+ *      Signalling an object from an ISR or another task
+ *      (sched_event_set(), sched_sem_post(),
+ *      sched_msg_send()) calls sched_activate_task() on the
+ *      bound task. If the activation fails, e.g., because
+ *      the bound task was killed, the object is still
+ *      updated and the signal returns the scheduler's
+ *      error.
+ *
+ *      A task with its own stack blocks on an object with
+ *      its _wait() function, which binds the caller. A task
+ *      that runs to completion is bound once with
+ *      sched_wait_bind() instead, typically with a zero
+ *      period, and picks up what arrived with the _take()
+ *      functions each time it is released.
+ *
+ *      The objects are built on sched_activate_task() and
+ *      sched_wait_activation() only, schedulers without the
+ *      latter still support bound tasks.
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+#include "spinlock.h"
+#include "sched.h"
+
+/**********************************************************
+ *
+ *  sched_wait_t
+ *
+ *      Part every wait object starts with.
+ *
+ *  lock
+ *
+ *      Guards the object. Taken from ISRs, so it is held
+ *      with IRQs masked.
+ *
+ *  task_id, bound
+ *
+ *      Task activated when the object is signalled.
+ *
+ */
+
+typedef struct
+    {
+    spinlock_t      lock;
+    sched_task_id_t task_id;
+    boolean         bound;
+    } sched_wait_t;
+
+/* Event flags, any set flag a waiter asked for wakes it */
+typedef struct
+    {
+    sched_wait_t    wait;
+    uint32_t        flags;
+    } sched_event_t;
+
+/* Counting semaphore */
+typedef struct
+    {
+    sched_wait_t    wait;
+    uint32_t        count;
+    } sched_sem_t;
+
+/* Message box, a ring of pointers over caller owned slots
+ * whose count is a power of two */
+typedef struct
+    {
+    sched_wait_t    wait;
+    void         ** slots;
+    uint32_t        mask;
+    uint32_t        head;
+    uint32_t        tail;
+    uint32_t        dropped;
+    } sched_msg_t;
+
+/**********************************************************
+ *
+ *  sched_wait_bind()
+ *
+ *  DESCRIPTION:
+ *      Have signals on the object activate task_id. Pass
+ *      the object's wait member, e.g., &evt->wait.
+ *
+ */
+
+void sched_wait_bind(sched_wait_t * wait, sched_task_id_t task_id);
+
+/**********************************************************
+ *
+ *  sched_event_*()
+ *
+ *  DESCRIPTION:
+ *      sched_event_set() sets flags and wakes the bound
+ *      task. sched_event_take() clears and returns the set
+ *      flags in mask, zero if there are none.
+ *      sched_event_wait() blocks until one of the flags in
+ *      mask is set, then takes them.
+ *
+ */
+
+void sched_event_init(sched_event_t * evt);
+sched_err_t sched_event_set(sched_event_t * evt, uint32_t flags);
+uint32_t sched_event_take(sched_event_t * evt, uint32_t mask);
+sched_err_t sched_event_wait(sched_event_t * evt, uint32_t mask, uint32_t * flags);
+
+/**********************************************************
+ *
+ *  sched_sem_*()
+ *
+ *  DESCRIPTION:
+ *      sched_sem_post() counts up and wakes the bound task.
+ *      sched_sem_take() counts down, or returns FALSE at
+ *      zero. sched_sem_wait() blocks until it can count
+ *      down.
+ *
+ */
+
+void sched_sem_init(sched_sem_t * sem, uint32_t count);
+sched_err_t sched_sem_post(sched_sem_t * sem);
+boolean sched_sem_take(sched_sem_t * sem);
+sched_err_t sched_sem_wait(sched_sem_t * sem);
+
+/**********************************************************
+ *
+ *  sched_msg_*()
+ *
+ *  DESCRIPTION:
+ *      sched_msg_send() queues a message and wakes the
+ *      bound task, a full box drops the message and returns
+ *      SCHED_ERR_FAILED_UPDATE. sched_msg_take() takes the
+ *      oldest message, or returns FALSE if there is none.
+ *      sched_msg_wait() blocks until there is one.
+ *
+ */
+
+boolean sched_msg_init(sched_msg_t * msg, void ** slots, uint32_t count);
+sched_err_t sched_msg_send(sched_msg_t * msg, void * data);
+boolean sched_msg_take(sched_msg_t * msg, void ** data);
+sched_err_t sched_msg_wait(sched_msg_t * msg, void ** data);
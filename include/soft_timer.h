@@ -0,0 +1,133 @@
+/**********************************************************
+ *
+ *  soft_timer.h
+ *
+ *
+ *  DESCRIPTION:
+ *      Software timers, any number of one-shot and periodic
+ *      timers sharing a single hardware timer
+ *
+ *  NOTES:
+ *      Timers sit in a hierarchical timing wheel, so
+ *      starting and cancelling one is O(1) however many are
+ *      running. The wheel moves in SOFT_TIMER_TICK_US steps,
+ *      a timer fires on the first step at or after its
+ *      expiry and never early.
+ *
+ *      Callbacks run from the hardware timer's IRQ, on core
+ *      0, with no locks held. They may start and cancel
+ *      timers, their own included. Anything slow goes
+ *      through defer_work() or wakes a task.
+ *
+ *      The caller owns the soft_timer_t, which has to stay
+ *      put until the timer is cancelled or has fired.
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+#include "peripherals/timer.h"
+
+/**
+ * $config: SOFT_TIMER_TICK_US. Resolution of the software timers, also the
+ * interval of the hardware timer they share.
+ *
+ */
+#ifndef SOFT_TIMER_TICK_US
+#define SOFT_TIMER_TICK_US 1000
+#endif
+
+typedef void (*soft_timer_func_t)(void * ctx);
+
+/**********************************************************
+ *
+ *  soft_timer_t
+ *
+ *      Zeroed memory is a timer that is not running.
+ *
+ *  next, pprev
+ *
+ *      Links of the wheel slot the timer is in, pprev is
+ *      NULL while it is not running.
+ *
+ *  expires
+ *
+ *      Wheel step the timer fires on.
+ *
+ *  period
+ *
+ *      Steps between firings, 0 for a one-shot timer.
+ *
+ *  func, ctx
+ *
+ *      Callback and its argument.
+ *
+ */
+
+typedef struct soft_timer_t_struc
+    {
+    struct soft_timer_t_struc  * next;
+    struct soft_timer_t_struc ** pprev;
+    uint64_t                     expires;
+    uint32_t                     period;
+    soft_timer_func_t            func;
+    void                       * ctx;
+    } soft_timer_t;
+
+/**********************************************************
+ *
+ *  soft_timer_init()
+ *
+ *  DESCRIPTION:
+ *      Take the hardware timer the software timers run on.
+ *      Returns its timer_alloc() error if there is none
+ *      left.
+ *
+ */
+
+timer_err_t8 soft_timer_init(void);
+
+/**********************************************************
+ *
+ *  soft_timer_start()
+ *
+ *  DESCRIPTION:
+ *      Call func( ctx ) delay_us from now, and every
+ *      period_us after that unless period_us is 0. A timer
+ *      that is running already is restarted.
+ *
+ *  NOTES:
+ *      Periods are rounded up to whole SOFT_TIMER_TICK_US
+ *      steps. A periodic timer fires on a fixed grid, a
+ *      late step does not push the following ones out.
+ *
+ */
+
+timer_err_t8 soft_timer_start(soft_timer_t * timer, soft_timer_func_t func, void * ctx, uint32_t delay_us, uint32_t period_us);
+
+/**********************************************************
+ *
+ *  soft_timer_cancel()
+ *
+ *  DESCRIPTION:
+ *      Stop a timer. Returns FALSE if it was not running.
+ *
+ *  NOTES:
+ *      Does not wait for a callback that is running on the
+ *      timer IRQ already.
+ *
+ */
+
+boolean soft_timer_cancel(soft_timer_t * timer);
+
+/**********************************************************
+ *
+ *  soft_timer_pending()
+ *
+ *  DESCRIPTION:
+ *      The timer is running, i.e., it will fire again.
+ *
+ */
+
+boolean soft_timer_pending(soft_timer_t * timer);
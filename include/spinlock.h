@@ -0,0 +1,116 @@
+/**********************************************************
+ *
+ *  spinlock.h
+ *
+ *
+ *  DESCRIPTION:
+ *      Spinlocks for data shared between cores
+ *
+ *  NOTES:
+ *      The kernel runs with the MMU and data cache off, so
+ *      all memory is Device memory and there is no global
+ *      exclusive monitor behind it on the BCM SoCs. LDXR/STXR
+ *      can fail forever there, so the hardware build uses
+ *      Lamport's bakery lock, which only needs plain loads,
+ *      stores and barriers. The simulator uses the GCC
+ *      __atomic builtins instead since its ISR runs on its
+ *      own host thread that shares core 0's id.
+ *
+ *      A spinlock that is also taken from an ISR must be
+ *      held with IRQs masked (see irq_save()), otherwise
+ *      the ISR can spin forever on its own core.
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+#include "cpu.h"
+#include "utils.h"
+
+#ifdef EMBEDDED_BUILD
+
+typedef struct
+    {
+    volatile uint32_t choosing[ CPU_CORE_COUNT ];
+    volatile uint32_t number[ CPU_CORE_COUNT ];
+    } spinlock_t;
+
+#define spin_barrier() asm volatile("dmb sy" ::: "memory")
+
+static inline void spin_lock(spinlock_t * lock)
+{
+    uint32_t me;
+    uint32_t core;
+    uint32_t max;
+
+    me = get_core_id();
+
+    /* take a ticket one past the highest one out there */
+    lock->choosing[me] = 1;
+    spin_barrier();
+
+    max = 0;
+    for(core = 0; core < CPU_CORE_COUNT; core++)
+    {
+        if(lock->number[core] > max)
+        {
+            max = lock->number[core];
+        }
+    }
+
+    lock->number[me] = max + 1;
+    spin_barrier();
+    lock->choosing[me] = 0;
+    spin_barrier();
+
+    /* wait for every core holding a lower ticket, ties go
+     * to the lower core id */
+    for(core = 0; core < CPU_CORE_COUNT; core++)
+    {
+        while(lock->choosing[core])
+            ;
+
+        while(lock->number[core] != 0
+          && ( lock->number[core] < lock->number[me]
+            || ( lock->number[core] == lock->number[me] && core < me ) ))
+            ;
+    }
+
+    spin_barrier();
+}
+
+static inline void spin_unlock(spinlock_t * lock)
+{
+    spin_barrier();
+    lock->number[get_core_id()] = 0;
+}
+
+#undef spin_barrier
+
+#else
+
+typedef struct
+    {
+    volatile uint32_t locked;
+    } spinlock_t;
+
+static inline void spin_lock(spinlock_t * lock)
+{
+    while(__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE))
+    {
+        /* spin on a plain load until the lock looks free */
+        while(__atomic_load_n(&lock->locked, __ATOMIC_RELAXED))
+            ;
+    }
+}
+
+static inline void spin_unlock(spinlock_t * lock)
+{
+    __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+#endif
+
+/* Zeroed memory is an unlocked spinlock */
+#define spin_lock_init(lock) clr_mem((lock), sizeof(spinlock_t))
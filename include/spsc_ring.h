@@ -0,0 +1,81 @@
+/**********************************************************
+ *
+ *  spsc_ring.h
+ *
+ *
+ *  DESCRIPTION:
+ *      Lock-free single producer, single consumer ring of
+ *      work items
+ *
+ *  NOTES:
+ *      One context pushes and one context pops, e.g., an ISR
+ *      and the scheduler loop. Neither side ever waits on the
+ *      other, so the ring is safe to push from an ISR that
+ *      interrupts the consumer.
+ *
+ *      head and tail are free running counters, each only
+ *      written by its own side. An item is published with a
+ *      release store of head and claimed with an acquire
+ *      load of it, likewise for tail the other way around.
+ *      Both are plain loads and stores on AArch64 (LDAR/STLR)
+ *      so they also work with the MMU off.
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+
+typedef void ( *spsc_work_func_t )( void * ctx, uint32_t arg );
+
+typedef struct
+    {
+    spsc_work_func_t func;
+    void           * ctx;
+    uint32_t         arg;
+    } spsc_work_t;
+
+/**********************************************************
+ *
+ *  spsc_ring_t
+ *
+ *      head
+ *
+ *          Items pushed so far. Only the producer writes it.
+ *
+ *      tail
+ *
+ *          Items popped so far. Only the consumer writes it.
+ *
+ *      mask
+ *
+ *          Ring length minus one, the length is a power of
+ *          two.
+ *
+ *      items
+ *
+ *          Item storage.
+ *
+ *      dropped
+ *
+ *          Pushes that found the ring full. Only the producer
+ *          writes it.
+ *
+ */
+
+typedef struct
+    {
+    volatile uint32_t   head;
+    volatile uint32_t   tail;
+    uint32_t            mask;
+    spsc_work_t       * items;
+    volatile uint32_t   dropped;
+    } spsc_ring_t;
+
+/* Static initializer for a ring over items[], see spsc_ring_init() */
+#define SPSC_RING_INIT(items) { 0, 0, list_cnt(items) - 1, (items), 0 }
+
+boolean spsc_ring_init(spsc_ring_t * ring, spsc_work_t * items, uint32_t count);
+boolean spsc_ring_push(spsc_ring_t * ring, spsc_work_func_t func, void * ctx, uint32_t arg);
+boolean spsc_ring_pop(spsc_ring_t * ring, spsc_work_t * item);
+boolean spsc_ring_is_empty(spsc_ring_t * ring);
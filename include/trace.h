@@ -0,0 +1,122 @@
+/**********************************************************
+ *
+ *  trace.h
+ *
+ *
+ *  DESCRIPTION:
+ *      Binary scheduler trace recorder
+ *
+ *  NOTES:
+ *      Built with TRACE_EVENTS, otherwise TRACE() compiles
+ *      to nothing. Every core records into its own ring of
+ *      16 byte events stamped with the 1MHz system counter,
+ *      the oldest events are overwritten once it is full.
+ *
+ *      trace_dump() prints the rings on the console as hex
+ *      words between "TRACE BEGIN" and "TRACE END" lines,
+ *      tools/scripts/trace2chrome.py turns a console log
+ *      into Chrome trace / Perfetto JSON.
+ *
+ *      Recording costs a counter read and a 16 byte store
+ *      under the ring's lock, nothing is formatted until
+ *      the dump.
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+
+/**
+ * $config: TRACE_RING_LEN. Events kept per core. Must be a power of two.
+ *
+ */
+#ifndef TRACE_RING_LEN
+#define TRACE_RING_LEN 1024
+#endif
+
+/* Bumped whenever the dump format changes */
+#define TRACE_FORMAT_VERSION 1
+
+typedef uint8_t trace_evt_t;
+enum
+{
+    TRACE_TASK_RELEASE,         /* Task was made ready, id is the task id */
+    TRACE_TASK_START,           /* Task got the CPU */
+    TRACE_TASK_END,             /* Task gave the CPU back */
+    TRACE_TASK_OVERRUN,         /* Task ran past its budget */
+    TRACE_IRQ_ENTER,            /* IRQ handler entered, id is the source */
+    TRACE_IRQ_EXIT,             /* IRQ handler returned */
+    TRACE_EVT_CNT
+};
+
+/**********************************************************
+ *
+ *  trace_rec_t
+ *
+ *      One recorded event, as it sits in the ring.
+ *
+ *  ts_us
+ *
+ *      System counter when the event was recorded.
+ *
+ *  id
+ *
+ *      Task id or IRQ source, see trace_evt_t.
+ *
+ *  evt, core
+ *
+ *      Event and the core it was recorded on.
+ *
+ */
+
+typedef struct
+    {
+    uint64_t    ts_us;
+    uint32_t    id;
+    trace_evt_t evt;
+    uint8_t     core;
+    uint16_t    reserved;
+    } trace_rec_t;
+
+#ifdef TRACE_EVENTS
+
+#define TRACE(evt, id) trace_event((evt), (id))
+
+/**********************************************************
+ *
+ *  trace_event()
+ *
+ *  DESCRIPTION:
+ *      Record an event on the calling core. Safe from
+ *      ISRs and from every core.
+ *
+ */
+
+void trace_event(trace_evt_t evt, uint32_t id);
+
+/**********************************************************
+ *
+ *  trace_dump()
+ *
+ *  DESCRIPTION:
+ *      Print every core's events, oldest first, then start
+ *      the rings over. Nothing is recorded while it runs.
+ *
+ *      Output, one line each, numbers in hex:
+ *
+ *          TRACE BEGIN <version> <core count>
+ *          TRACE CORE <core> <events> <overwritten>
+ *          <ts_us hi> <ts_us lo> <id> <core << 8 | evt>
+ *          ...
+ *          TRACE END
+ *
+ */
+
+void trace_dump(void);
+
+#else
+
+#define TRACE(evt, id)
+
+#endif
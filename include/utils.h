@@ -15,6 +15,7 @@ void delay(uint64_t n);
 void put32(uint64_t addr, uint32_t val);
 uint32_t get32(uint64_t addr);
 uint32_t get_el(void);
+uint32_t get_core_id(void);
 void delay_sec(uint32_t sec);
 void delay_ms(uint32_t msec);
 void delay_us(uint32_t us);
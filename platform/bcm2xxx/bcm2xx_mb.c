@@ -12,6 +12,7 @@
 #include "peripherals/base.h"
 #include "printf.h"
 #include "utils.h"
+#include "sched_mutex.h"
 #include "../../drivers/usb/dwc2/dwc2.h"
 
 /* Coherent memory region used in mailbox communication */
@@ -140,9 +141,15 @@ enum
  *
  *          Tag buffer data
  *
+ *      mb_mutex
+ *
+ *          One request at a time, they all share the tag
+ *          buffer and the mailbox.
+ *
  */
 
 static vc_tag_buff_data_t * tag_buff_data = ( ( vc_tag_buff_data_t * ) MEM_COHERENT_REGION );
+static sched_mutex_t mb_mutex;
 
 /* Forward declares */
 static void write_to_mb(mb_channel_t chnl, uint32_t data);
@@ -280,7 +287,9 @@ static void flush_mb(void)
  */
 void bcm2xxx_power_on(bcm2xxx_power_on_t type)
 {
+    (void)sched_mutex_lock(&mb_mutex);
     process_vc_request();
+    (void)sched_mutex_unlock(&mb_mutex);
 
     //TODO
     // /* block for now. put this in a task */
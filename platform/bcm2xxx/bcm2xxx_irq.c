@@ -9,21 +9,30 @@
  */
 
 #include "generic.h"
+#include "irq.h"
 #include "bcm2xxx_irq.h"
 #include "bcm2xxx_timer.h"
 #include "vector.h"
+#include "cpu.h"
+#include "utils.h"
 #include "peripherals/base.h"
-#include "uart.h"//todo remove after testing
-#include "debug.h"//todo remove after testing
-#include "printf.h"//todo remove after testing
+#include "defer.h"
+#include "trace.h"
+#include "printf.h"
 
-/* Interrupt source defines*/
+/* Basic pending bits. Bits 8 and 9 flag the banks, bits
+ * 10-20 are shortcuts to a few of their sources, which do
+ * not always show in bits 8 and 9 */
 
-#define IRQ_SYS_TIMER_0	(1 << 0)    /* System timer 0 */
-#define IRQ_SYS_TIMER_1	(1 << 1)    /* System timer 1 */
-#define IRQ_SYS_TIMER_2	(1 << 2)    /* System timer 2 */
-#define IRQ_SYS_TIMER_3	(1 << 3)    /* System timer 3 */
-#define IRQ_USB_CTRL    (1 << 9)    /* USB contoller */
+#define BASIC_ARM_MASK   0x000000FF
+#define BASIC_BANK_1     ( (1 << 8) | 0x00007C00 )
+#define BASIC_BANK_2     ( (1 << 9) | 0x001F8000 )
+
+/* Core-local interrupt sources, the same bits enable a
+ * core's timer interrupts and show them pending */
+
+#define LOCAL_IRQ_CNTPNS (1 << 1)   /* EL1 physical timer */
+#define LOCAL_IRQ_GPU    (1 << 8)   /* Anything in irq_reg_t */
 
 typedef struct
 {
@@ -37,11 +46,35 @@ typedef struct
 
 } irq_reg_t;
 
+typedef struct
+{
+    reg32_t  timer_ctrl[4];
+    reg32_t  mbox_ctrl[4];
+    reg32_t  irq_source[4];
+
+} local_irq_reg_t;
+
 /* Constants */
 
 #define REG_IRQ_BASE ((volatile irq_reg_t *)(PBASE + 0x0000B200))
+#define REG_LOCAL_IRQ_BASE ((volatile local_irq_reg_t *)(LOCAL_PBASE + 0x40))
+
+typedef struct
+{
+    irq_handler_t handler;
+    void        * ctx;
+} irq_entry_t;
+
+static void dispatch(uint32_t pending, irq_source_t first);
+static void usb_isr(void * ctx);
+static void print_usb_irq(void * ctx, uint32_t arg);
+
+/* Handler of every source, see irq_register() */
+static irq_entry_t irq_table[ BCM2XXX_IRQ_SOURCE_COUNT ];
 
-static bcm2xxx_timer_t8 map_irq_to_timer_channel(uint8_t irq);
+/* Exception frame of the IRQ each core is handling, NULL
+ * outside of an IRQ. See irq_set_return() */
+static void * irq_frame[ CPU_CORE_COUNT ];
 
 static void en_periph(bcm2xxx_irq_periph_t8 periph)
 {
@@ -49,8 +82,14 @@ static void en_periph(bcm2xxx_irq_periph_t8 periph)
     uint32_t en_reg_idx = 0;
 
     /* prevent invalid memory writes */
+    if(periph >= BCM2XXX_IRQ_SOURCE_COUNT)
+        return;
+
     if(periph >= BCM2XXX_IRQ_PERIPH_COUNT)
+    {
+        REG_IRQ_BASE->en_basic = ( 1 << ( periph - BCM2XXX_IRQ_PERIPH_COUNT ) );
         return;
+    }
 
     /* Enable the interrupt */
     en_reg_idx = (uint32_t)periph / 32;
@@ -58,6 +97,22 @@ static void en_periph(bcm2xxx_irq_periph_t8 periph)
 
 }
 
+static void dis_periph(bcm2xxx_irq_periph_t8 periph)
+{
+    /* prevent invalid memory writes */
+    if(periph >= BCM2XXX_IRQ_SOURCE_COUNT)
+        return;
+
+    if(periph >= BCM2XXX_IRQ_PERIPH_COUNT)
+    {
+        REG_IRQ_BASE->dis_basic = ( 1 << ( periph - BCM2XXX_IRQ_PERIPH_COUNT ) );
+        return;
+    }
+
+    /* Write 1 to disable, the other bits are left alone */
+    REG_IRQ_BASE->dis[(uint32_t)periph / 32] = ( 1 << ( periph % 32 ) );
+}
+
 /* Contracted HW functions */
 
 
@@ -97,14 +152,44 @@ void irq_init(void)
 
 void irq_sys_enable(void)
 {
-    /* Enable peripherals */
-    en_periph(BCM2XXX_IRQ_PERIPH_SYS_TMR_M1);
+    /* The timer channels were enabled as they were handed
+     * out, see bcm2xxx_irq_en_timer() */
 
     /* Enable IRQs on the CPU */
     vector_enable_irq();
 
 }
 
+/**********************************************************
+ * 
+ *  irq_save
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Contracted IRQ mask save procedure.
+ * 
+ */
+
+irq_flags_t irq_save(void)
+{
+    return (irq_flags_t)vector_irq_save();
+}
+
+/**********************************************************
+ * 
+ *  irq_restore
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Contracted IRQ mask restore procedure.
+ * 
+ */
+
+void irq_restore(irq_flags_t flags)
+{
+    vector_irq_restore((unsigned long)flags);
+}
+
 /**********************************************************
  * 
  *  irq_enable_usb
@@ -116,11 +201,126 @@ void irq_sys_enable(void)
  */
 boolean irq_enable_usb(void)
 {
+    irq_register(BCM2XXX_IRQ_PERIPH_USB_CTRL, usb_isr, NULL);
     en_periph(BCM2XXX_IRQ_PERIPH_USB_CTRL);
 
     return TRUE;
 }
 
+/**********************************************************
+ * 
+ *  irq_register
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Contracted IRQ handler registration. Sources are
+ *      bcm2xxx_irq_periph_t8 values.
+ * 
+ *  NOTES:
+ *      Peripheral IRQs only come in on core 0. ctx is
+ *      written before the handler is published, so an IRQ
+ *      racing with a call from another core sees either no
+ *      handler or one with its ctx.
+ *
+ */
+
+boolean irq_register(irq_source_t source, irq_handler_t handler, void * ctx)
+{
+    if(source >= BCM2XXX_IRQ_SOURCE_COUNT)
+        return FALSE;
+
+    if(NULL == handler)
+    {
+        __atomic_store_n(&irq_table[source].handler, NULL, __ATOMIC_RELEASE);
+        irq_table[source].ctx = NULL;
+    }
+    else
+    {
+        irq_table[source].ctx = ctx;
+        __atomic_store_n(&irq_table[source].handler, handler, __ATOMIC_RELEASE);
+    }
+
+    return TRUE;
+}
+
+/**********************************************************
+ * 
+ *  bcm2xxx_irq_en_timer
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Enable a system timer channel's interrupt. The match
+ *      lines are the first peripheral interrupts, in
+ *      channel order.
+ * 
+ */
+
+void bcm2xxx_irq_en_timer(bcm2xxx_timer_t8 timer)
+{
+    if(timer >= BCMXXX_TIMER_CHNL_COUNT)
+        return;
+
+    en_periph(BCM2XXX_IRQ_PERIPH_SYS_TMR_M0 + timer);
+}
+
+/**********************************************************
+ * 
+ *  bcm2xxx_irq_dis_timer
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Disable a system timer channel's interrupt.
+ * 
+ */
+
+void bcm2xxx_irq_dis_timer(bcm2xxx_timer_t8 timer)
+{
+    if(timer >= BCMXXX_TIMER_CHNL_COUNT)
+        return;
+
+    dis_periph(BCM2XXX_IRQ_PERIPH_SYS_TMR_M0 + timer);
+}
+
+/**********************************************************
+ * 
+ *  bcm2xxx_irq_en_local_timer
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Enable a core's generic timer interrupt.
+ * 
+ *  NOTES:
+ *      Each core only sets up its own timer, so there is
+ *      no one else writing the register.
+ *
+ */
+
+void bcm2xxx_irq_en_local_timer(uint32_t core)
+{
+    if(core >= CPU_CORE_COUNT)
+        return;
+
+    REG_LOCAL_IRQ_BASE->timer_ctrl[core] |= LOCAL_IRQ_CNTPNS;
+}
+
+/**********************************************************
+ * 
+ *  bcm2xxx_irq_dis_local_timer
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Disable a core's generic timer interrupt.
+ * 
+ */
+
+void bcm2xxx_irq_dis_local_timer(uint32_t core)
+{
+    if(core >= CPU_CORE_COUNT)
+        return;
+
+    REG_LOCAL_IRQ_BASE->timer_ctrl[core] &= ~LOCAL_IRQ_CNTPNS;
+}
+
 /**********************************************************
  * 
  *  irq_handle_irqs
@@ -131,63 +331,154 @@ boolean irq_enable_usb(void)
  * 
  *  NOTES:
  *      Should only be called by AArch64 vector table mapped
- *      IRQ handler.
+ *      IRQ handler, with the exception frame it pushed.
+ *
+ *      Keep this short, anything slow goes through
+ *      defer_work().
+ *
+ *      The core-local source register says what is up on
+ *      this core. Peripheral interrupts only ever come in
+ *      on core 0, the pending registers are read only when
+ *      it flags one. Their sources are handed to the
+ *      handlers from irq_register().
  *
  */
 
-void irq_handle_irqs(void)
+void irq_handle_irqs(void * frame)
 {
-    reg32_t irq = REG_IRQ_BASE->irq_pending[0];
-    printf("\n%d\n", irq);
-    switch (irq)
+    uint32_t core = get_core_id();
+    reg32_t src = REG_LOCAL_IRQ_BASE->irq_source[core];
+    uint32_t basic;
+
+    irq_frame[core] = frame;
+    TRACE(TRACE_IRQ_ENTER, src);
+
+    /* This core's own timer, no peripheral access needed */
+    if(src & LOCAL_IRQ_CNTPNS)
     {
+        bcm2xxx_local_timer_irq_hndlr();
+    }
+
+    /* Every pending source is served in one go, only the
+     * banks with something pending are read */
+    if(src & LOCAL_IRQ_GPU)
+    {
+        basic = REG_IRQ_BASE->basic_pending;
+
+        if(basic & BASIC_BANK_1)
+        {
+            dispatch(REG_IRQ_BASE->irq_pending[0], 0);
+        }
 
-    /* Handle System timer IRQS */
-    case IRQ_SYS_TIMER_0:
-    case IRQ_SYS_TIMER_1:
-    case IRQ_SYS_TIMER_2:
-    case IRQ_SYS_TIMER_3:
-        bcm2xxx_timer_irq_hndlr(map_irq_to_timer_channel(irq));
-        break;
-
-    /* Handle USB Controller IRQs */
-    case IRQ_USB_CTRL:
-        printf("USB Controller interrupt");
-        break;
-    default:
-        break;
+        if(basic & BASIC_BANK_2)
+        {
+            dispatch(REG_IRQ_BASE->irq_pending[1], 32);
+        }
+
+        dispatch(basic & BASIC_ARM_MASK, BCM2XXX_IRQ_PERIPH_COUNT);
     }
+
+    TRACE(TRACE_IRQ_EXIT, src);
+    irq_frame[core] = NULL;
 }
 
 /**********************************************************
  * 
- *  map_irq_to_timer_channel
+ *  irq_set_return
  * 
  * 
  *  DESCRIPTION:
- *      Map the IRQ System timer channel bit to the 
- *      the timer channel index.
- *
+ *      Contracted IRQ return redirect procedure. Rewrites
+ *      the ELR saved in the exception frame so eret lands
+ *      in func.
+ * 
  */
 
-static bcm2xxx_timer_t8 map_irq_to_timer_channel(uint8_t irq)
+void irq_set_return(void_func_t func)
 {
-    switch (irq)
+    uint8_t * frame = (uint8_t *)irq_frame[get_core_id()];
+
+    if(NULL == frame)
     {
-    case IRQ_SYS_TIMER_0:
-        return BM2XXX_TIMER_CHNL_0;
+        return;
+    }
+
+    *(uint64_t *)( frame + FRAME_ELR_OFFSET ) = (uint64_t)func;
+}
 
-    case IRQ_SYS_TIMER_1:
-        return BM2XXX_TIMER_CHNL_1;
+/* helper functions */
 
-    case IRQ_SYS_TIMER_2:
-        return BM2XXX_TIMER_CHNL_2;
+/**********************************************************
+ * 
+ *  dispatch
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Call the handler of every source pending in one
+ *      register, first being the source of bit 0.
+ * 
+ *  NOTES:
+ *      Counting leading zeros finds the next set bit in a
+ *      single instruction, so the cost goes with the
+ *      number of pending sources rather than the width of
+ *      the register.
+ *
+ */
 
-    case IRQ_SYS_TIMER_3:
-        return BM2XXX_TIMER_CHNL_3;
+static void dispatch(uint32_t pending, irq_source_t first)
+{
+    irq_handler_t handler;
+    uint32_t bit;
 
-    default:
-        // Handle unknown IRQ value, or return a default value.
-        return BCMXXX_TIMER_CHNL_COUNT;
+    while(pending != 0)
+    {
+        bit = 31 - __builtin_clz(pending);
+        pending &= ~( 1U << bit );
+
+        handler = __atomic_load_n(&irq_table[first + bit].handler, __ATOMIC_ACQUIRE);
+        if(NULL != handler)
+        {
+            handler(irq_table[first + bit].ctx);
+        }
+        else
+        {
+            /* nobody to clear it, keep it from storming */
+            dis_periph((bcm2xxx_irq_periph_t8)( first + bit ));
+        }
     }
 }
+
+/**********************************************************
+ * 
+ *  usb_isr
+ * 
+ * 
+ *  DESCRIPTION:
+ *      USB controller interrupt, reported from the
+ *      scheduler loop.
+ *
+ */
+
+static void usb_isr(void * ctx)
+{
+    defer_work(print_usb_irq, ctx, 0);
+}
+
+/**********************************************************
+ * 
+ *  print_usb_irq
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Deferred from usb_isr(), report a USB controller
+ *      interrupt.
+ *
+ */
+
+static void print_usb_irq(void * ctx, uint32_t arg)
+{
+    (void)ctx;
+    (void)arg;
+
+    printf("USB Controller interrupt");
+}
@@ -0,0 +1,274 @@
+/**********************************************************
+ * 
+ *  bcm2xxx_local_timer.c
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Per-core timers on the ARM generic timer
+ *
+ *  NOTES:
+ *      Each core has one, the EL1 physical timer, with its
+ *      interrupt wired to that core alone through the
+ *      core-local interrupt controller. Its registers are
+ *      system registers rather than peripherals, so a tick
+ *      costs no trip over the peripheral bus.
+ *
+ *      A core only ever touches its own timer, masking IRQs
+ *      is all the locking it needs. Its id is
+ *      BCM2XXX_LOCAL_TIMER_ID( core ).
+ *
+ *      Intervals are handed in as microseconds like for
+ *      the system timer and converted at the counter's
+ *      CNTFRQ rate.
+ *
+ */
+
+#include "generic.h"
+#include "bcm2xxx_irq.h"
+#include "bcm2xxx_timer.h"
+#include "peripherals/base.h"
+#include "peripherals/timer.h"
+#include "generic_timer.h"
+#include "irq.h"
+#include "cpu.h"
+#include "utils.h"
+
+#define USEC_PER_SECOND 1000000
+
+#define LOCAL_CTRL_CRYSTAL_X1 0            /* Crystal clock, count by 1 */
+#define LOCAL_PRESCALER_DIV1  0x80000000   /* 2^31 / prescaler */
+
+/* Types */
+
+typedef struct
+{
+    reg32_t control;      /* Counter source and step */
+    reg32_t reserved;
+    reg32_t prescaler;    /* Counter prescaler */
+
+} local_timer_reg_t;
+
+#define REG_LOCAL_TIMER_BASE ((volatile local_timer_reg_t *)(LOCAL_PBASE))
+
+typedef struct
+{
+    boolean in_use;
+    void_func_t irq_cb;
+    uint64_t interval;    /* In counter ticks */
+} local_timer_ctrl_t;
+
+/* Functions */
+static uint64_t usec_to_counts(uint32_t us);
+
+/* Variables */
+static local_timer_ctrl_t local_timer_ctrl_block[ CPU_CORE_COUNT ];
+static uint32_t counter_freq;
+
+/**********************************************************
+ * 
+ *  bcm2xxx_local_timer_init
+ * 
+ *  DESCRIPTION:
+ *      Run the shared counter straight off the crystal
+ *
+ *  NOTES:
+ *      The firmware normally does this, a bare boot leaves
+ *      the prescaler at 0 which stops the counter.
+ *
+ */
+
+void bcm2xxx_local_timer_init(void)
+{
+    REG_LOCAL_TIMER_BASE->control = LOCAL_CTRL_CRYSTAL_X1;
+    REG_LOCAL_TIMER_BASE->prescaler = LOCAL_PRESCALER_DIV1;
+
+    counter_freq = generic_timer_freq();
+
+    clr_mem((uint8_t *)local_timer_ctrl_block, sizeof(local_timer_ctrl_block));
+}
+
+/**********************************************************
+ * 
+ *  timer_alloc_local
+ * 
+ *  DESCRIPTION:
+ *      Reserve the calling core's timer and start it
+ *
+ */
+
+timer_err_t8 timer_alloc_local(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
+{
+    /* local variables */
+    local_timer_ctrl_t * tmr;
+    irq_flags_t flags;
+    uint32_t core;
+
+    /* input validaton */
+    if(NULL == timer_id)
+        {
+        return TIMER_ERR_INVALID_PRMTRS;
+        }
+
+    flags = irq_save();
+
+    core = get_core_id();
+    tmr = &local_timer_ctrl_block[core];
+
+    if(tmr->in_use)
+        {
+        irq_restore(flags);
+        return TIMER_ERR_RESOURCE_UNAVAILABLE;
+        }
+
+    tmr->in_use = TRUE;
+    tmr->irq_cb = irq_cb;
+    tmr->interval = usec_to_counts(ticks);
+
+    generic_timer_set_cval(generic_timer_count() + tmr->interval);
+    generic_timer_set_ctl(GENERIC_TIMER_CTL_ENABLE);
+
+    irq_restore(flags);
+
+    bcm2xxx_irq_en_local_timer(core);
+
+    *timer_id = (timer_id_t8)BCM2XXX_LOCAL_TIMER_ID(core);
+
+    return TIMER_ERR_NONE;
+}
+
+/**********************************************************
+ * 
+ *  bcm2xxx_local_timer_free
+ * 
+ *  DESCRIPTION:
+ *      Stop a core's timer and give it back
+ *
+ */
+
+timer_err_t8 bcm2xxx_local_timer_free(uint32_t core)
+{
+    /* local variables */
+    irq_flags_t flags;
+
+    if(core != get_core_id() || !local_timer_ctrl_block[core].in_use)
+        {
+        return TIMER_ERR_INVALID_PRMTRS;
+        }
+
+    bcm2xxx_irq_dis_local_timer(core);
+
+    flags = irq_save();
+    generic_timer_set_ctl(0);
+    local_timer_ctrl_block[core].in_use = FALSE;
+    local_timer_ctrl_block[core].irq_cb = NULL;
+    irq_restore(flags);
+
+    return TIMER_ERR_NONE;
+}
+
+/**********************************************************
+ * 
+ *  bcm2xxx_local_timer_set_next
+ * 
+ *  DESCRIPTION:
+ *      Move the next interrupt of a core's timer
+ *
+ *  NOTES:
+ *      The timer fires whenever the counter is at or past
+ *      the compare value, so unlike the system timer a
+ *      deadline that has already gone by fires right away
+ *      instead of being missed. TVAL is a signed 32-bit
+ *      offset, i.e., about 111s at 19.2MHz, longer waits go
+ *      through the absolute compare value.
+ *
+ */
+
+timer_err_t8 bcm2xxx_local_timer_set_next(uint32_t core, uint32_t ticks)
+{
+    /* local variables */
+    uint64_t counts;
+
+    if(core != get_core_id() || !local_timer_ctrl_block[core].in_use)
+        {
+        return TIMER_ERR_INVALID_PRMTRS;
+        }
+
+    counts = usec_to_counts(ticks);
+
+    if(counts <= 0x7FFFFFFF)
+        {
+        generic_timer_set_tval((uint32_t)counts);
+        }
+    else
+        {
+        generic_timer_set_cval(generic_timer_count() + counts);
+        }
+
+    return TIMER_ERR_NONE;
+}
+
+/**********************************************************
+ * 
+ *  bcm2xxx_local_timer_irq_hndlr
+ * 
+ *  DESCRIPTION:
+ *      Handle the calling core's timer IRQ
+ *
+ *  NOTES:
+ *      The interrupt is level triggered, it stays up until
+ *      the compare value moves ahead of the counter. As
+ *      with the system timer the next compare is one
+ *      interval on from the one that fired, skipping the
+ *      ones an IRQ that came in late has missed.
+ *
+ */
+
+void bcm2xxx_local_timer_irq_hndlr(void)
+{
+    /* local variables */
+    local_timer_ctrl_t * tmr;
+    uint64_t cval;
+    uint64_t now;
+
+    tmr = &local_timer_ctrl_block[get_core_id()];
+
+    /* a freed timer stays quiet */
+    if(!tmr->in_use)
+    {
+        generic_timer_set_ctl(0);
+        return;
+    }
+
+    cval = generic_timer_get_cval() + tmr->interval;
+    now = generic_timer_count();
+
+    if( (sint64_t)( now - cval ) >= 0 )
+    {
+        cval = now + tmr->interval;
+    }
+
+    generic_timer_set_cval(cval);
+
+    if(NULL != tmr->irq_cb)
+    {
+        tmr->irq_cb();
+    }
+}
+
+/* helper functions */
+
+/**********************************************************
+ * 
+ *  usec_to_counts
+ * 
+ *  DESCRIPTION:
+ *      Microseconds in counter ticks, at least one
+ *
+ */
+
+static uint64_t usec_to_counts(uint32_t us)
+{
+    uint64_t counts = (uint64_t)us * counter_freq / USEC_PER_SECOND;
+
+    return ( counts == 0 ) ? 1 : counts;
+}
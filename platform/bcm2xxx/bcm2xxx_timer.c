@@ -16,6 +16,15 @@
  *          upwards thus constantly overflowing. The timer channels
  *          will compare agains the lower 32-bits of this 64-bit
  *          counter.
+ *
+ *          Channels 0 and 2 belong to the VideoCore, only 1
+ *          and 3 are handed out by timer_alloc(). A timer's id
+ *          is its channel.
+ *
+ *      Core-local timers:
+ *
+ *          timer_alloc_local() hands out the ARM generic
+ *          timers instead, see bcm2xxx_local_timer.c.
  * 
  */
 
@@ -24,6 +33,8 @@
 #include "peripherals/base.h"
 #include "bcm2xxx_timer.h"
 #include "peripherals/timer.h"
+#include "irq.h"
+#include "spinlock.h"
 #include "debug.h"
 #include "uart.h"
 
@@ -35,6 +46,9 @@
 #define TICKS_PER_MS ( 1000 * TICKS_PER_USEC )
 #define TICKS_PER_SECOND ( 1000 * TICKS_PER_MS ) 
 
+/* Channels the VideoCore leaves to us */
+#define ARM_TIMER_CHNLS ( BIT(BM2XXX_TIMER_CHNL_1) | BIT(BM2XXX_TIMER_CHNL_3) )
+
 /* Types */
 
 typedef struct
@@ -49,18 +63,38 @@ typedef struct
 
 typedef struct
 {
+    boolean in_use;
     void_func_t irq_cb;
     uint32_t tick_interval;
 } timer_ctrl_t;
 
+/* Functions */
+static void delay_until(uint64_t end_us);
+static void timer_isr(void * ctx);
+
 /* Variables */
 static timer_ctrl_t timer_ctrl_block[ BCMXXX_TIMER_CHNL_COUNT ];
+static spinlock_t timer_lock;
 static uint32_t cur_val = 0;
 
 void timer_init(void)
 {
+    /* local variables */
+    bcm2xxx_timer_t8 bcm_tmr;
+
     /* Initialize the reg timer list */
     clr_mem((uint8_t *)timer_ctrl_block, sizeof(timer_ctrl_t) * BCMXXX_TIMER_CHNL_COUNT);
+
+    /* The channels' IRQs stay disabled until handed out */
+    for(bcm_tmr = 0; bcm_tmr < BCMXXX_TIMER_CHNL_COUNT; bcm_tmr++)
+        {
+        if( ARM_TIMER_CHNLS & BIT(bcm_tmr) )
+            {
+            irq_register(BCM2XXX_IRQ_PERIPH_SYS_TMR_M0 + bcm_tmr, timer_isr, &timer_ctrl_block[bcm_tmr]);
+            }
+        }
+
+    bcm2xxx_local_timer_init();
 }
 
 /**********************************************************
@@ -68,14 +102,15 @@ void timer_init(void)
  *  timer_alloc
  * 
  *  DESCRIPTION:
- *      Enable a timer
+ *      Reserve the first free channel and start it
  *
  */
-// todo make this take in a hi lvl timer cb which specifies ms and not ticks
-uint8_t timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
+
+timer_err_t8 timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
 {
     /* local variables */
-    bcm2xxx_timer_t8 bcm_tmr = BM2XXX_TIMER_CHNL_1; //todo add timer resrv table
+    bcm2xxx_timer_t8 bcm_tmr;
+    irq_flags_t flags;
 
     /* input validaton */
     if(NULL == timer_id)
@@ -83,19 +118,41 @@ uint8_t timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
         return TIMER_ERR_INVALID_PRMTRS;
         }
 
+    flags = irq_save();
+    spin_lock(&timer_lock);
+
+    for(bcm_tmr = 0; bcm_tmr < BCMXXX_TIMER_CHNL_COUNT; bcm_tmr++)
+        {
+        if( ( ARM_TIMER_CHNLS & BIT(bcm_tmr) ) && !timer_ctrl_block[bcm_tmr].in_use )
+            {
+            break;
+            }
+        }
+
+    if(bcm_tmr == BCMXXX_TIMER_CHNL_COUNT)
+        {
+        spin_unlock(&timer_lock);
+        irq_restore(flags);
+        return TIMER_ERR_RESOURCE_UNAVAILABLE;
+        }
+
+    /* register the irq callback function */
+    timer_ctrl_block[bcm_tmr].in_use = TRUE;
+    timer_ctrl_block[bcm_tmr].irq_cb = irq_cb;
+    timer_ctrl_block[bcm_tmr].tick_interval = ticks;
+
     /* set the value to match with the low 32-bits
      * of the free counter for the provided timer
      */
     cur_val = REG_SYS_ADD_MAP_BASE->counter[COUNTER_LO];
-    ticks = cur_val + ticks;
-    REG_SYS_ADD_MAP_BASE->compares[bcm_tmr] = ticks;
+    REG_SYS_ADD_MAP_BASE->compares[bcm_tmr] = cur_val + ticks;
 
-    /* register the irq callback function */
-    timer_ctrl_block[bcm_tmr].irq_cb = irq_cb;
-    timer_ctrl_block[bcm_tmr].tick_interval = ticks;
+    spin_unlock(&timer_lock);
+    irq_restore(flags);
 
-    // todo give this a meaningful value
-    *timer_id = 12;
+    bcm2xxx_irq_en_timer(bcm_tmr);
+
+    *timer_id = (timer_id_t8)bcm_tmr;
 
     return TIMER_ERR_NONE;
 }
@@ -103,21 +160,151 @@ uint8_t timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
 
 /**********************************************************
  * 
- *  delay_us
+ *  timer_free
  * 
+ *  DESCRIPTION:
+ *      Stop a channel and give it back
+ *
  */
 
-void delay_us(uint32_t us)
+timer_err_t8 timer_free(timer_id_t8 timer_id)
 {
-    uint32_t end_val;
-    uint32_t current_val;
+    /* local variables */
+    irq_flags_t flags;
 
-    current_val = REG_SYS_ADD_MAP_BASE->counter[COUNTER_LO];
+    if(timer_id >= BCM2XXX_LOCAL_TIMER_ID(0))
+        {
+        return bcm2xxx_local_timer_free(timer_id - BCM2XXX_LOCAL_TIMER_ID(0));
+        }
 
-    end_val = current_val + us;
+    if(!timer_ctrl_block[timer_id].in_use)
+        {
+        return TIMER_ERR_INVALID_PRMTRS;
+        }
 
-    while( REG_SYS_ADD_MAP_BASE->counter[COUNTER_LO] < end_val )
-        ;
+    bcm2xxx_irq_dis_timer(timer_id);
+
+    flags = irq_save();
+    spin_lock(&timer_lock);
+    timer_ctrl_block[timer_id].in_use = FALSE;
+    timer_ctrl_block[timer_id].irq_cb = NULL;
+    spin_unlock(&timer_lock);
+    irq_restore(flags);
+
+    /* drop a match that came in meanwhile */
+    REG_SYS_ADD_MAP_BASE->control_sts = (1 << timer_id);
+
+    return TIMER_ERR_NONE;
+}
+
+
+/**********************************************************
+ * 
+ *  timer_set_next
+ * 
+ *  DESCRIPTION:
+ *      Move the next compare match of a timer
+ *
+ *  NOTES:
+ *      A compare only matches when the low counter word is
+ *      equal to it, so a value the counter has already run
+ *      past would not fire for another 2^32uS. Push it out
+ *      until it lands ahead of the counter.
+ *
+ */
+
+timer_err_t8 timer_set_next(timer_id_t8 timer_id, uint32_t ticks)
+{
+    /* local variables */
+    bcm2xxx_timer_t8 bcm_tmr = (bcm2xxx_timer_t8)timer_id;
+    uint32_t compare;
+
+    if(timer_id >= BCM2XXX_LOCAL_TIMER_ID(0))
+        {
+        return bcm2xxx_local_timer_set_next(timer_id - BCM2XXX_LOCAL_TIMER_ID(0), ticks);
+        }
+
+    if(!timer_ctrl_block[bcm_tmr].in_use)
+        {
+        return TIMER_ERR_INVALID_PRMTRS;
+        }
+
+    if(ticks == 0)
+        {
+        ticks = 1;
+        }
+
+    compare = REG_SYS_ADD_MAP_BASE->counter[COUNTER_LO] + ticks;
+    REG_SYS_ADD_MAP_BASE->compares[bcm_tmr] = compare;
+
+    while( (sint32_t)( REG_SYS_ADD_MAP_BASE->counter[COUNTER_LO] - compare ) >= 0 )
+        {
+        compare = REG_SYS_ADD_MAP_BASE->counter[COUNTER_LO] + 2;
+        REG_SYS_ADD_MAP_BASE->compares[bcm_tmr] = compare;
+        }
+
+    return TIMER_ERR_NONE;
+}
+
+
+/**********************************************************
+ * 
+ *  clock_now_us
+ * 
+ *  DESCRIPTION:
+ *      Read the 64-bit free counter
+ *
+ *  NOTES:
+ *      The counter is two 32-bit registers, so re-read the
+ *      high word to catch the low word rolling over between
+ *      the two reads.
+ *
+ */
+
+uint64_t clock_now_us(void)
+{
+    uint32_t hi;
+    uint32_t lo;
+
+    do
+    {
+        hi = REG_SYS_ADD_MAP_BASE->counter[COUNTER_HI];
+        lo = REG_SYS_ADD_MAP_BASE->counter[COUNTER_LO];
+    } while( hi != REG_SYS_ADD_MAP_BASE->counter[COUNTER_HI] );
+
+    return ( (uint64_t)hi << 32 ) | lo;
+}
+
+
+/**********************************************************
+ * 
+ *  clock_now_ns
+ * 
+ *  DESCRIPTION:
+ *      Free counter in nanoseconds
+ *
+ */
+
+uint64_t clock_now_ns(void)
+{
+    return clock_now_us() * 1000;
+}
+
+
+/**********************************************************
+ * 
+ *  delay_us
+ * 
+ *  NOTES:
+ *      Waits on the 64-bit clock, a 32-bit end value would
+ *      end the wait early or never whenever the low counter
+ *      word wraps in between, i.e., every ~71 minutes.
+ *
+ */
+
+void delay_us(uint32_t us)
+{
+    delay_until( clock_now_us() + us );
 }
 
 
@@ -129,7 +316,7 @@ void delay_us(uint32_t us)
 
 void delay_sec(uint32_t sec)
 {
-    delay_us( TICKS_PER_SECOND * sec );
+    delay_until( clock_now_us() + (uint64_t)TICKS_PER_SECOND * sec );
 }
 
 
@@ -141,36 +328,66 @@ void delay_sec(uint32_t sec)
 
 void delay_ms(uint32_t msec)
 {
-    delay_us( TICKS_PER_MS * msec );
+    delay_until( clock_now_us() + (uint64_t)TICKS_PER_MS * msec );
 }
 
 
 /**********************************************************
  * 
- *  bcm2xxx_timer_irq_hndlr
+ *  delay_until
  * 
  *  DESCRIPTION:
- *      Handle incoming timer IRQs
+ *      Spin until the clock reaches end_us
  *
  */
 
-void bcm2xxx_timer_irq_hndlr(bcm2xxx_timer_t8 timer)
+static void delay_until(uint64_t end_us)
+{
+    while( clock_now_us() < end_us )
+        ;
+}
+
+
+/**********************************************************
+ * 
+ *  timer_isr
+ * 
+ *  DESCRIPTION:
+ *      Handle a channel's IRQ, ctx is its control block
+ *
+ *  NOTES:
+ *      The next match is one interval on from the match
+ *      that fired, not from now, so IRQ latency does not
+ *      add up into drift. Should the IRQ come in more than
+ *      an interval late the missed matches are skipped.
+ *
+ */
+
+static void timer_isr(void * ctx)
 {
     /* local variables */
+    bcm2xxx_timer_t8 timer;
     uint32_t ticks;
 
-    /* input validation */
-    if(timer >= BCMXXX_TIMER_CHNL_COUNT)
+    timer = (bcm2xxx_timer_t8)( (timer_ctrl_t *)ctx - timer_ctrl_block );
+
+    /* prepare the next interval, a freed channel stays
+     * quiet */
+    if(timer_ctrl_block[timer].in_use)
     {
-        return;
-    }
+        ticks = REG_SYS_ADD_MAP_BASE->compares[timer] + timer_ctrl_block[timer].tick_interval;
+        cur_val = REG_SYS_ADD_MAP_BASE->counter[COUNTER_LO];
 
-    /* prepare the next interval */
-    cur_val = REG_SYS_ADD_MAP_BASE->counter[COUNTER_LO];
-    ticks = cur_val + timer_ctrl_block[timer].tick_interval;
-    REG_SYS_ADD_MAP_BASE->compares[timer] = ticks;
+        if( (sint32_t)( cur_val - ticks ) >= 0 )
+        {
+            ticks = cur_val + timer_ctrl_block[timer].tick_interval;
+        }
+
+        REG_SYS_ADD_MAP_BASE->compares[timer] = ticks;
+    }
 
-    REG_SYS_ADD_MAP_BASE->control_sts |= (1 << timer);
+    /* write 1 to clear, only this channel's match */
+    REG_SYS_ADD_MAP_BASE->control_sts = (1 << timer);
 
     /* otherwise call the registered irq handler
      * if one exists
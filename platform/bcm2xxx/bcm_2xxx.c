@@ -5,6 +5,8 @@
  */
 
 #include "generic.h"
+#include "cpu.h"
+#include "utils.h"
 #include "bcm2xxx_mb.h"
 #include "bcm2xxx_mb.h"
 
@@ -35,4 +37,62 @@ boolean cpu_init(void)
 // bcm2xxx_mb_init();
 
 return TRUE;
-}
\ No newline at end of file
+}
+
+/* Entry point table secondary cores spin on, see boot.S */
+extern volatile uint64_t spin_cpu_table[];
+
+/**
+ * cpu_start_core
+ * 
+ * @brief Contracted secondary core start function
+ * 
+ * @return true Core was released
+ * @return false Core does not exist or is core 0
+ */
+boolean cpu_start_core(uint32_t core, void_func_t entry)
+{
+if(core == 0 || core >= CPU_CORE_COUNT || entry == NULL)
+    {
+    return FALSE;
+    }
+
+spin_cpu_table[core] = (uint64_t)entry;
+
+/* Make the entry visible before waking the parked cores */
+asm volatile("dsb sy; sev" ::: "memory");
+
+return TRUE;
+}
+
+/**
+ * cpu_idle
+ * 
+ * @brief Contracted core idle function
+ * 
+ * Peripheral IRQs are only routed to core 0, which waits for
+ * one with WFI. That wakes on a pending IRQ even while it is
+ * masked. The other cores wait for an event instead, the event
+ * register latches a SEV sent before we got here.
+ */
+void cpu_idle(void)
+{
+if(get_core_id() == 0)
+    {
+    asm volatile("dsb sy; wfi" ::: "memory");
+    }
+else
+    {
+    asm volatile("wfe" ::: "memory");
+    }
+}
+
+/**
+ * cpu_wake_cores
+ * 
+ * @brief Contracted core wake function
+ */
+void cpu_wake_cores(void)
+{
+asm volatile("dsb sy; sev" ::: "memory");
+}
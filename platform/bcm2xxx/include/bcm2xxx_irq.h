@@ -11,12 +11,15 @@
 #pragma once
 
 #include "generic.h"
+#include "bcm2xxx_timer.h"
 
-typedef uint8_t bcm2xxx_irq_periph_t8;  /* ARM peripheral interrupts table type */
+typedef uint8_t bcm2xxx_irq_periph_t8;  /* ARM peripheral interrupts table type, also the irq_register() sources */
 enum
     {
+    BCM2XXX_IRQ_PERIPH_SYS_TMR_M0    = 0,  /* System timer match 0 */
     BCM2XXX_IRQ_PERIPH_SYS_TMR_M1    = 1,  /* System timer match 1 */
-    BCM2XXX_IRQ_PERIPH_SYS_TMR_M2    = 3,  /* System timer match 3 */
+    BCM2XXX_IRQ_PERIPH_SYS_TMR_M2    = 2,  /* System timer match 2 */
+    BCM2XXX_IRQ_PERIPH_SYS_TMR_M3    = 3,  /* System timer match 3 */
     BCM2XXX_IRQ_PERIPH_USB_CTRL      = 9,  /* USB Controller       */
     BCM2XXX_IRQ_PERIPH_AUX_INT       = 20, /* Auxillary peripherals*/
     BCM2XXX_IRQ_PERIPH_I2C_SPI_SLAVE = 43, /* i2c/spi slave        */
@@ -31,5 +34,61 @@ enum
     BCM2XXX_IRQ_PERIPH_SPI           = 54,
     BCM2XXX_IRQ_PERIPH_PCM           = 55,
     BCM2XXX_IRQ_PERIPH_UART          = 57,
-    BCM2XXX_IRQ_PERIPH_COUNT
+    BCM2XXX_IRQ_PERIPH_COUNT         = 64,
+
+    /* ARM side sources of the basic pending register,
+     * numbered after both banks */
+    BCM2XXX_IRQ_BASIC_ARM_TIMER      = 64,
+    BCM2XXX_IRQ_BASIC_MAILBOX        = 65,
+    BCM2XXX_IRQ_BASIC_DOORBELL_0     = 66,
+    BCM2XXX_IRQ_BASIC_DOORBELL_1     = 67,
+    BCM2XXX_IRQ_BASIC_GPU_0_HALTED   = 68,
+    BCM2XXX_IRQ_BASIC_GPU_1_HALTED   = 69,
+    BCM2XXX_IRQ_BASIC_ILLEGAL_1      = 70,
+    BCM2XXX_IRQ_BASIC_ILLEGAL_0      = 71,
+    BCM2XXX_IRQ_SOURCE_COUNT
     };
+
+/**********************************************************
+ * 
+ *  bcm2xxx_irq_en_timer()
+ * 
+ *  DESCRIPTION:
+ *      Route a system timer channel's matches to the CPU.
+ *
+ */
+
+void bcm2xxx_irq_en_timer(bcm2xxx_timer_t8 timer);
+
+/**********************************************************
+ * 
+ *  bcm2xxx_irq_dis_timer()
+ * 
+ *  DESCRIPTION:
+ *      Stop routing a system timer channel's matches.
+ *
+ */
+
+void bcm2xxx_irq_dis_timer(bcm2xxx_timer_t8 timer);
+
+/**********************************************************
+ * 
+ *  bcm2xxx_irq_en_local_timer()
+ * 
+ *  DESCRIPTION:
+ *      Route a core's generic timer interrupt to that core.
+ *
+ */
+
+void bcm2xxx_irq_en_local_timer(uint32_t core);
+
+/**********************************************************
+ * 
+ *  bcm2xxx_irq_dis_local_timer()
+ * 
+ *  DESCRIPTION:
+ *      Stop routing a core's generic timer interrupt.
+ *
+ */
+
+void bcm2xxx_irq_dis_local_timer(uint32_t core);
@@ -12,6 +12,7 @@
 #pragma once
 
 #include "generic.h"
+#include "peripherals/timer.h"
 
 typedef uint8_t bcm2xxx_timer_t8;
 enum
@@ -23,4 +24,23 @@ enum
     BCMXXX_TIMER_CHNL_COUNT,
     };
 
-void bcm2xxx_timer_irq_hndlr(bcm2xxx_timer_t8 timer);
\ No newline at end of file
+/* Core-local timers are numbered after the system timer
+ * channels, one per core */
+#define BCM2XXX_LOCAL_TIMER_ID(core) ( BCMXXX_TIMER_CHNL_COUNT + (core) )
+
+/**********************************************************
+ * 
+ *  bcm2xxx_local_timer_*()
+ * 
+ *  DESCRIPTION:
+ *      Per-core generic timers, see bcm2xxx_local_timer.c.
+ *      timer_free() and timer_set_next() hand their ids
+ *      over to these, which only act on the calling core's
+ *      timer.
+ *
+ */
+
+void bcm2xxx_local_timer_init(void);
+timer_err_t8 bcm2xxx_local_timer_free(uint32_t core);
+timer_err_t8 bcm2xxx_local_timer_set_next(uint32_t core, uint32_t ticks);
+void bcm2xxx_local_timer_irq_hndlr(void);
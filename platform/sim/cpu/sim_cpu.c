@@ -7,7 +7,11 @@
  *
  */
 
+#include <pthread.h>
+
 #include "generic.h"
+#include "cpu.h"
+#include "sim_cpu.h"
 
 /**********************************************************
  * 
@@ -37,3 +41,195 @@ uint32_t get_el(void)
 {
     return 0;
 }
+
+/* Core the calling thread is simulating. The main thread is core 0 */
+static __thread uint32_t sim_core_id;
+
+/* IRQ mask depth of the calling thread and the event count when
+ * it first masked */
+static __thread uint32_t sim_mask_depth;
+static __thread uint64_t sim_mask_event_cnt;
+
+/* Events raised so far, guarded by sim_event_lock */
+static uint64_t sim_event_cnt;
+static pthread_mutex_t sim_event_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sim_event_cond = PTHREAD_COND_INITIALIZER;
+
+/* Cores started so far and the ones parked in cpu_idle() since
+ * the last event, also guarded by sim_event_lock */
+static uint32_t sim_cores_running = 1;
+static uint32_t sim_cores_idle;
+static pthread_cond_t sim_idle_cond = PTHREAD_COND_INITIALIZER;
+
+typedef struct
+    {
+    uint32_t    core;
+    void_func_t entry;
+    } sim_core_start_t;
+
+static sim_core_start_t sim_core_start[ CPU_CORE_COUNT ];
+
+static void * sim_core_thread(void * arg)
+{
+    sim_core_start_t * start = (sim_core_start_t *)arg;
+
+    sim_core_id = start->core;
+    start->entry();
+
+    /* entry must not return, but a thread can just park */
+    while(1)
+        ;
+
+    return NULL;
+}
+
+/**********************************************************
+ * 
+ * get_core_id()
+ * 
+ * DESCRIPTION:
+ *      Simulated procedure to get the current core
+ * 
+ */
+
+uint32_t get_core_id(void)
+{
+    return sim_core_id;
+}
+
+/**********************************************************
+ * 
+ * cpu_start_core()
+ * 
+ * DESCRIPTION:
+ *      Simulated secondary core start. Each core is a
+ *      host thread.
+ * 
+ */
+
+boolean cpu_start_core(uint32_t core, void_func_t entry)
+{
+    pthread_t thread;
+
+    if(core == 0 || core >= CPU_CORE_COUNT || entry == NULL)
+    {
+        return FALSE;
+    }
+
+    sim_core_start[core].core = core;
+    sim_core_start[core].entry = entry;
+
+    /* Counts as busy until it first idles */
+    pthread_mutex_lock(&sim_event_lock);
+    sim_cores_running++;
+    pthread_mutex_unlock(&sim_event_lock);
+
+    if(pthread_create(&thread, NULL, sim_core_thread, &sim_core_start[core]) != 0)
+    {
+        pthread_mutex_lock(&sim_event_lock);
+        sim_cores_running--;
+        pthread_mutex_unlock(&sim_event_lock);
+        return FALSE;
+    }
+
+    pthread_detach(thread);
+
+    return TRUE;
+}
+
+/**********************************************************
+ * 
+ * cpu_idle()
+ * 
+ * DESCRIPTION:
+ *      Simulated core idle. Sleeps until an event is raised
+ *      after the calling thread masked IRQs.
+ * 
+ */
+
+void cpu_idle(void)
+{
+    uint64_t since;
+
+    pthread_mutex_lock(&sim_event_lock);
+
+    since = ( sim_mask_depth > 0 ) ? sim_mask_event_cnt : sim_event_cnt;
+
+    if(sim_event_cnt == since)
+    {
+        /* Only counts until the next event, which resets it */
+        if(++sim_cores_idle >= sim_cores_running)
+        {
+            pthread_cond_broadcast(&sim_idle_cond);
+        }
+
+        while(sim_event_cnt == since)
+        {
+            pthread_cond_wait(&sim_event_cond, &sim_event_lock);
+        }
+    }
+
+    /* Later idles only wait for newer events */
+    sim_mask_event_cnt = sim_event_cnt;
+
+    pthread_mutex_unlock(&sim_event_lock);
+}
+
+/**********************************************************
+ * 
+ * cpu_wake_cores()
+ * 
+ * DESCRIPTION:
+ *      Wake every simulated core parked in cpu_idle()
+ * 
+ */
+
+void cpu_wake_cores(void)
+{
+    sim_cpu_raise_event();
+}
+
+void sim_cpu_raise_event(void)
+{
+    pthread_mutex_lock(&sim_event_lock);
+    sim_event_cnt++;
+    sim_cores_idle = 0;
+    pthread_cond_broadcast(&sim_event_cond);
+    pthread_mutex_unlock(&sim_event_lock);
+}
+
+void sim_cpu_wait_all_idle(void)
+{
+    pthread_mutex_lock(&sim_event_lock);
+
+    while(sim_cores_idle < sim_cores_running)
+    {
+        pthread_cond_wait(&sim_idle_cond, &sim_event_lock);
+    }
+
+    pthread_mutex_unlock(&sim_event_lock);
+}
+
+boolean sim_cpu_mask_events(void)
+{
+    if(sim_mask_depth++ != 0)
+    {
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&sim_event_lock);
+    sim_mask_event_cnt = sim_event_cnt;
+    pthread_mutex_unlock(&sim_event_lock);
+
+    return TRUE;
+}
+
+boolean sim_cpu_unmask_events(void)
+{
+    if(sim_mask_depth == 0)
+    {
+        return FALSE;
+    }
+
+    return ( --sim_mask_depth == 0 );
+}
@@ -0,0 +1,58 @@
+/**********************************************************
+ * 
+ *  sim_cpu.h
+ * 
+ *  DESCRIPTION:
+ *     Simulated CPU internals shared with the other
+ *     simulated peripherals
+ *
+ */
+
+#pragma once
+
+#include "generic.h"
+
+/* Simulated IRQ sources, as recorded in traces */
+#define SIM_IRQ_TIMER   0
+#define SIM_IRQ_NET_RX  1
+
+/**********************************************************
+ * 
+ * sim_cpu_raise_event()
+ * 
+ * DESCRIPTION:
+ *      Wake every simulated core parked in cpu_idle().
+ *      Called after a simulated ISR has run.
+ * 
+ */
+
+void sim_cpu_raise_event(void);
+
+/**********************************************************
+ * 
+ * sim_cpu_mask_events()/sim_cpu_unmask_events()
+ * 
+ * DESCRIPTION:
+ *      Track IRQ masking on the calling thread. Events
+ *      raised after the outermost mask wake the next
+ *      cpu_idle() straight away, the same way a pending
+ *      IRQ ends WFI on hardware. Both return TRUE for the
+ *      outermost mask/unmask.
+ * 
+ */
+
+boolean sim_cpu_mask_events(void);
+boolean sim_cpu_unmask_events(void);
+
+/**********************************************************
+ * 
+ * sim_cpu_wait_all_idle()
+ * 
+ * DESCRIPTION:
+ *      Block until every started core is parked in
+ *      cpu_idle() with nothing new to look at. Used by the
+ *      virtual clock to know when it may jump ahead.
+ * 
+ */
+
+void sim_cpu_wait_all_idle(void);
@@ -0,0 +1,27 @@
+/**********************************************************
+ * 
+ *  sim_net.h
+ * 
+ *  DESCRIPTION:
+ *     Simulated network internals shared between the
+ *     socket and interrupt halves
+ *
+ *  NOTES:
+ *     The socket half includes host network headers that
+ *     clash with generic.h, so the two are kept apart.
+ *
+ */
+
+#pragma once
+
+/**********************************************************
+ * 
+ * sim_net_socket()
+ * 
+ * DESCRIPTION:
+ *      Socket the simulated network receives on, -1 if it
+ *      failed to come up.
+ * 
+ */
+
+int sim_net_socket(void);
@@ -7,13 +7,67 @@
  *
  */
 
+#include <pthread.h>
+#include <signal.h>
+
 #include "generic.h"
+#include "cpu.h"
+#include "irq.h"
+#include "utils.h"
+#include "sim_cpu.h"
+
+/* Simulated ISRs can not touch the interrupted thread's frame,
+ * so irq_set_return() sends it this signal instead */
+#define SIM_IRQ_RETURN_SIGNAL SIGUSR1
 
 boolean irqs_enabled;
 
+/* Thread simulating each core and where to send it on return */
+static pthread_t sim_core_thread[ CPU_CORE_COUNT ];
+static void_func_t sim_irq_return[ CPU_CORE_COUNT ];
+
+static void sim_irq_return_handler(int sig)
+{
+    void_func_t func;
+
+    (void)sig;
+
+    func = sim_irq_return[get_core_id()];
+    sim_irq_return[get_core_id()] = NULL;
+
+    if(func != NULL)
+    {
+        func();
+    }
+}
+
+/**********************************************************
+ * 
+ *  irq_init
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Initialize simulated IRQs on the calling core.
+ * 
+ */
+
 void irq_init()
 {
+    struct sigaction action;
+
+    sim_core_thread[get_core_id()] = pthread_self();
+
+    if(get_core_id() != 0)
+    {
+        return;
+    }
+
     irqs_enabled = FALSE;
+
+    clr_mem(&action, sizeof(action));
+    action.sa_handler = sim_irq_return_handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIM_IRQ_RETURN_SIGNAL, &action, NULL);
 }
 
 
@@ -32,4 +86,99 @@ void irq_init()
 void irq_sys_enable(void)
 {
     irqs_enabled = TRUE;
-}
\ No newline at end of file
+}
+
+/**********************************************************
+ * 
+ *  irq_save
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Contracted IRQ mask save procedure. Simulated ISRs
+ *      run on their own thread so there is nothing to mask.
+ *      We note the mask so cpu_idle() does not miss an IRQ
+ *      that fires while it is held, and block the signal
+ *      irq_set_return() uses.
+ * 
+ */
+
+irq_flags_t irq_save(void)
+{
+    sigset_t set;
+
+    /* Hold off irq_set_return() on the outermost mask */
+    if(sim_cpu_mask_events())
+    {
+        sigemptyset(&set);
+        sigaddset(&set, SIM_IRQ_RETURN_SIGNAL);
+        pthread_sigmask(SIG_BLOCK, &set, NULL);
+    }
+
+    return 0;
+}
+
+/**********************************************************
+ * 
+ *  irq_restore
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Contracted IRQ mask restore procedure.
+ * 
+ */
+
+void irq_restore(irq_flags_t flags)
+{
+    sigset_t set;
+
+    (void)flags;
+
+    if(sim_cpu_unmask_events())
+    {
+        sigemptyset(&set);
+        sigaddset(&set, SIM_IRQ_RETURN_SIGNAL);
+        pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+    }
+}
+
+/**********************************************************
+ * 
+ *  irq_set_return
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Contracted IRQ return redirect procedure. The
+ *      simulated ISR thread counts as core 0, so signal the
+ *      thread running core 0 and have it call func from the
+ *      signal handler.
+ * 
+ */
+
+void irq_set_return(void_func_t func)
+{
+    uint32_t core = get_core_id();
+
+    sim_irq_return[core] = func;
+    pthread_kill(sim_core_thread[core], SIM_IRQ_RETURN_SIGNAL);
+}
+
+/**********************************************************
+ * 
+ *  irq_register
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Contracted IRQ handler registration. The simulator
+ *      has no interrupt controller, its devices call their
+ *      handlers from their own threads.
+ * 
+ */
+
+boolean irq_register(irq_source_t source, irq_handler_t handler, void * ctx)
+{
+    (void)source;
+    (void)handler;
+    (void)ctx;
+
+    return FALSE;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
@@ -152,24 +153,45 @@ void net_init()
 
 int get_packet(char *buffer, size_t buffer_size, int timeout_us) {
     struct timeval tv;
+    int flags = 0;
 
     if (sock < 0) {
         perror("Socket is not initialized");
         return -1;
     }
 
-    tv.tv_sec = 2;  // 0 seconds
-    tv.tv_usec = timeout_us;
-
-    if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
-        perror("Failed to set socket timeout");
-        return -1;
+    /* A zero timeout only takes what has already arrived */
+    if (timeout_us == 0) {
+        flags = MSG_DONTWAIT;
+    } else {
+        tv.tv_sec = timeout_us / 1000000;
+        tv.tv_usec = timeout_us % 1000000;
+
+        if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
+            perror("Failed to set socket timeout");
+            return -1;
+        }
     }
 
-    int bytes_received = recvfrom(sock, buffer, buffer_size, 0, NULL, NULL);
-    if (bytes_received < 0) {
+    int bytes_received = recvfrom(sock, buffer, buffer_size, flags, NULL, NULL);
+    if (bytes_received < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
         perror("Packet receive failed");
     }
 
     return bytes_received;
+}
+
+/**********************************************************
+ * 
+ *  sim_net_socket()
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Socket the simulated network receives on, -1 if it
+ *      failed to come up.
+ *
+ */
+
+int sim_net_socket(void) {
+    return sock;
 }
\ No newline at end of file
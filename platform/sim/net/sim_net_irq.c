@@ -0,0 +1,116 @@
+/**********************************************************
+ * 
+ *  sim_net_irq.c
+ * 
+ *  DESCRIPTION:
+ *      Simulated network receive interrupt.
+ *
+ *  NOTES:
+ *      A host thread waits for packets on the simulated
+ *      network's socket and calls the handler, like the
+ *      NIC's interrupt would. The interrupt is masked from
+ *      then until the driver acks it, i.e., until it has
+ *      read the packets, so it does not keep firing on the
+ *      same ones.
+ *
+ */
+
+#include <poll.h>
+#include <pthread.h>
+
+#include "generic.h"
+#include "net.h"
+#include "sim_cpu.h"
+#include "sim_net.h"
+#include "trace.h"
+
+static void_func_t rx_irq_cb;
+static boolean rx_masked;
+static pthread_mutex_t rx_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rx_cond = PTHREAD_COND_INITIALIZER;
+
+static void * simulate_net_rx_isr(void * arg);
+
+/**********************************************************
+ * 
+ *  net_rx_irq_enable()
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Start taking receive interrupts. irq_cb is called
+ *      from the simulated ISR thread whenever packets are
+ *      waiting and the interrupt is not masked.
+ *
+ */
+
+void net_rx_irq_enable(void_func_t irq_cb)
+{
+    pthread_t thread;
+
+    if(sim_net_socket() < 0 || irq_cb == NULL)
+    {
+        return;
+    }
+
+    rx_irq_cb = irq_cb;
+    rx_masked = FALSE;
+
+    if(pthread_create(&thread, NULL, simulate_net_rx_isr, NULL) != 0)
+    {
+        printf("Failed to create thread");
+    }
+}
+
+/**********************************************************
+ * 
+ *  net_rx_irq_ack()
+ * 
+ * 
+ *  DESCRIPTION:
+ *      Unmask the receive interrupt once the waiting
+ *      packets have been read.
+ *
+ */
+
+void net_rx_irq_ack(void)
+{
+    pthread_mutex_lock(&rx_lock);
+    rx_masked = FALSE;
+    pthread_cond_signal(&rx_cond);
+    pthread_mutex_unlock(&rx_lock);
+}
+
+static void * simulate_net_rx_isr(void * arg)
+{
+    struct pollfd pfd;
+
+    (void)arg;
+
+    pfd.fd = sim_net_socket();
+    pfd.events = POLLIN;
+
+    while(TRUE)
+    {
+        pthread_mutex_lock(&rx_lock);
+        while(rx_masked)
+        {
+            pthread_cond_wait(&rx_cond, &rx_lock);
+        }
+        pthread_mutex_unlock(&rx_lock);
+
+        if(poll(&pfd, 1, -1) <= 0)
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&rx_lock);
+        rx_masked = TRUE;
+        pthread_mutex_unlock(&rx_lock);
+
+        TRACE(TRACE_IRQ_ENTER, SIM_IRQ_NET_RX);
+        rx_irq_cb();
+        TRACE(TRACE_IRQ_EXIT, SIM_IRQ_NET_RX);
+    }
+
+    return NULL;
+}
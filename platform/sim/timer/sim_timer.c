@@ -5,14 +5,49 @@
  *  DESCRIPTION:
  *      Simluated timer module.
  *
+ *  NOTES:
+ *      By default the system counter follows the host's
+ *      monotonic clock. Each timer is a timerfd armed with
+ *      absolute deadlines on a fixed grid, the way a
+ *      compare register is reloaded on hardware, so the
+ *      time the ISRs take never adds up into drift. The
+ *      timer thread waits on all of them at once.
+ *
+ *      Built with SIM_TIMER_FIFO the timer thread runs at
+ *      SCHED_FIFO priority, which needs CAP_SYS_NICE (or
+ *      root). Without it the thread falls back to normal
+ *      priority and says so.
+ *
+ *      Built with SIM_VIRTUAL_TIME the counter is virtual
+ *      instead. It starts at 0 and only moves when every
+ *      core is idle, at which point it jumps straight to
+ *      the next timer interrupt. Task code takes no time at
+ *      all, so hours of workload run in seconds, and with a
+ *      single core every run replays the same way.
+ *
+ *      Built with SIM_RUN_SECONDS the simulator exits once
+ *      that many seconds of counter went by, dumping the
+ *      scheduler trace first if there is one, and prints
+ *      how late each timer's interrupts came in.
+ *
  */
 
 #include <stdlib.h>
-#include <pthread.h>
 #include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+
+/* The kernel's sched.h shadows the host's, so take what
+ * SCHED_FIFO needs from below it */
+#include <bits/types/struct_sched_param.h>
+#include <linux/sched.h>
+#include <pthread.h>
 
 #include "generic.h"
 #include "peripherals/timer.h"
+#include "sim_cpu.h"
+#include "trace.h"
 
 #define TICKS_PER_USEC 1 /* System timer runs at 1Mhz */
 #define TICKS_PER_MS ( 1000 * TICKS_PER_USEC )
@@ -21,10 +56,52 @@
 #define MS_TO_USEC (1000)
 #define US_TO_MSEC (1/US_TO_MSEC)
 
-static uint32_t scheduler_proc_rate;
+/* Number of simulated timers */
+#define SIM_TIMER_CHNL_COUNT 4
+
+/**
+ * $config: SIM_TIMER_FIFO_PRIO. SCHED_FIFO priority of the timer thread
+ * when built with SIM_TIMER_FIFO.
+ *
+ */
+#ifndef SIM_TIMER_FIFO_PRIO
+#define SIM_TIMER_FIFO_PRIO 80
+#endif
+
+typedef struct
+{
+    boolean in_use;
+    void_func_t irq_cb;
+    uint32_t tick_interval;
+    uint64_t next_fire_us;      /* counter value the next interrupt is due at */
+    int fd;                     /* timerfd, not used on the virtual clock */
+    uint64_t fires;             /* interrupts delivered */
+    uint64_t missed;            /* deadlines passed before the last one was served */
+    uint64_t late_sum_us;       /* lateness past the deadline, summed and worst */
+    uint32_t late_max_us;
+} sim_timer_chnl_t;
+
+#ifdef SIM_VIRTUAL_TIME
+/* Virtual system counter, only the timer thread moves it */
+static volatile uint64_t sim_virtual_us;
+#endif
+
+/* All timers are served by one thread, like the single
+ * timer interrupt line they would share on hardware */
+static sim_timer_chnl_t timer_chnls[ SIM_TIMER_CHNL_COUNT ];
+static boolean timer_thread_started;
+static uint64_t timer_start_us;         /* counter at timer_init(), runs are timed from it */
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
 
-void_func_t scheduler_proc;
 void* simulate_shed_timer_isr(void* arg);
+static boolean start_timer_thread(void);
+static boolean next_fire(uint64_t * fire_us);
+static uint64_t wait_for_fire(void);
+static void arm_chnl(sim_timer_chnl_t * chnl);
+#ifdef SIM_RUN_SECONDS
+static void print_report(void);
+#endif
 
 /**********************************************************
  * 
@@ -37,7 +114,26 @@ void* simulate_shed_timer_isr(void* arg);
 
 void timer_init()
 {
+    pthread_condattr_t attr;
+    timer_id_t8 i;
 
+    /* deadlines are on the simulated system counter */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    timer_start_us = clock_now_us();
+
+    for (i = 0; i < SIM_TIMER_CHNL_COUNT; i++) {
+        timer_chnls[i].fd = -1;
+#ifndef SIM_VIRTUAL_TIME
+        timer_chnls[i].fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_chnls[i].fd < 0) {
+            printf("Failed to create timerfd");
+        }
+#endif
+    }
 }
 
 /**********************************************************
@@ -45,31 +141,424 @@ void timer_init()
  *  timer_alloc()
  * 
  *  DESCRIPTION:
- *      Allocate a timer. NOT IMPLEMENTED.
+ *      Allocate a simulated timer, the timer thread is
+ *      started with the first one.
  *
  */
 
 timer_err_t8 timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
 {
-    pthread_t thread;
+    sim_timer_chnl_t * chnl;
+    timer_id_t8 i;
+
+    if (timer_id == NULL) {
+        return TIMER_ERR_INVALID_PRMTRS;
+    }
 
-    scheduler_proc = irq_cb;
-    scheduler_proc_rate = ticks;
+    pthread_mutex_lock(&timer_lock);
+
+    for (i = 0; i < SIM_TIMER_CHNL_COUNT; i++) {
+        if (!timer_chnls[i].in_use) {
+            break;
+        }
+    }
 
-    if (pthread_create(&thread, NULL, simulate_shed_timer_isr, NULL) != 0) {
-        printf("Failed to create thread");
+    if (i == SIM_TIMER_CHNL_COUNT) {
+        pthread_mutex_unlock(&timer_lock);
         return TIMER_ERR_RESOURCE_UNAVAILABLE;
     }
 
+    chnl = &timer_chnls[i];
+    chnl->in_use = TRUE;
+    chnl->irq_cb = irq_cb;
+    chnl->tick_interval = ticks;
+    chnl->next_fire_us = clock_now_us() + ( TICKS_PER_USEC * ticks );
+    arm_chnl(chnl);
+
+    if (!timer_thread_started) {
+        if (!start_timer_thread()) {
+            chnl->in_use = FALSE;
+            pthread_mutex_unlock(&timer_lock);
+            printf("Failed to create thread");
+            return TIMER_ERR_RESOURCE_UNAVAILABLE;
+        }
+        timer_thread_started = TRUE;
+    }
+
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_lock);
+
+    *timer_id = i;
+
     return TIMER_ERR_NONE;
 }
 
+/**********************************************************
+ * 
+ *  timer_alloc_local()
+ * 
+ *  DESCRIPTION:
+ *      The simulated cores share the timer thread, a local
+ *      timer is any free channel.
+ *
+ */
+
+timer_err_t8 timer_alloc_local(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
+{
+    return timer_alloc(timer_id, irq_cb, ticks);
+}
+
+/**********************************************************
+ * 
+ *  timer_free()
+ * 
+ *  DESCRIPTION:
+ *      Stop a simulated timer and give it back.
+ *
+ */
+
+timer_err_t8 timer_free(timer_id_t8 timer_id)
+{
+    timer_err_t8 err = TIMER_ERR_NONE;
+
+    pthread_mutex_lock(&timer_lock);
+
+    if (timer_id >= SIM_TIMER_CHNL_COUNT || !timer_chnls[timer_id].in_use) {
+        err = TIMER_ERR_INVALID_PRMTRS;
+    } else {
+        timer_chnls[timer_id].in_use = FALSE;
+        timer_chnls[timer_id].irq_cb = NULL;
+        arm_chnl(&timer_chnls[timer_id]);
+    }
+
+    pthread_mutex_unlock(&timer_lock);
+
+    return err;
+}
+
+/**********************************************************
+ * 
+ *  timer_set_next()
+ * 
+ *  DESCRIPTION:
+ *      Move the next simulated timer interrupt. The ones
+ *      after it follow on the regular interval from there.
+ *
+ */
+
+timer_err_t8 timer_set_next(timer_id_t8 timer_id, uint32_t ticks)
+{
+    timer_err_t8 err = TIMER_ERR_NONE;
+
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    pthread_mutex_lock(&timer_lock);
+
+    if (timer_id >= SIM_TIMER_CHNL_COUNT || !timer_chnls[timer_id].in_use) {
+        err = TIMER_ERR_INVALID_PRMTRS;
+    } else {
+        timer_chnls[timer_id].next_fire_us = clock_now_us() + ( TICKS_PER_USEC * ticks );
+        arm_chnl(&timer_chnls[timer_id]);
+        pthread_cond_signal(&timer_cond);
+    }
+
+    pthread_mutex_unlock(&timer_lock);
+
+    return err;
+}
+
 void* simulate_shed_timer_isr(void* arg) {
 
+    sim_timer_chnl_t * chnl;
+    void_func_t irq_cb;
+    uint64_t expirations;
+    uint64_t now_us;
+    uint64_t late_us;
+    timer_id_t8 i;
+
+    (void)arg;
+
+    pthread_mutex_lock(&timer_lock);
+
     while (1) {
-        scheduler_proc();
+        now_us = wait_for_fire();
+
+#ifdef SIM_RUN_SECONDS
+        if (now_us - timer_start_us >= ( (uint64_t)SIM_RUN_SECONDS * TICKS_PER_SECOND )) {
+            printf("\nSimulated %d seconds, exiting\n", SIM_RUN_SECONDS);
+        #ifdef TRACE_EVENTS
+            trace_dump();
+        #endif
+            print_report();
+            fflush(stdout);
+            exit(0);
+        }
+#endif
+
+        for (i = 0; i < SIM_TIMER_CHNL_COUNT; i++) {
+            chnl = &timer_chnls[i];
+            if (!chnl->in_use || now_us < chnl->next_fire_us) {
+                continue;
+            }
+
+#ifndef SIM_VIRTUAL_TIME
+            /* the timerfd counts the deadlines that went by,
+             * none if it was rearmed in the meantime */
+            if (read(chnl->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+                continue;
+            }
+#else
+            expirations = 1;
+            if (chnl->tick_interval != 0) {
+                expirations += ( now_us - chnl->next_fire_us ) / chnl->tick_interval;
+            }
+#endif
+
+            late_us = now_us - chnl->next_fire_us;
+            chnl->fires++;
+            chnl->missed += expirations - 1;
+            chnl->late_sum_us += late_us;
+            if (late_us > chnl->late_max_us) {
+                chnl->late_max_us = (uint32_t)late_us;
+            }
+
+            /* next deadline on the grid, the ISR may move it */
+            chnl->next_fire_us += expirations * ( TICKS_PER_USEC * chnl->tick_interval );
+            irq_cb = chnl->irq_cb;
 
-        usleep(TICKS_PER_USEC * scheduler_proc_rate);
+            pthread_mutex_unlock(&timer_lock);
+            TRACE(TRACE_IRQ_ENTER, SIM_IRQ_TIMER);
+            irq_cb();
+            TRACE(TRACE_IRQ_EXIT, SIM_IRQ_TIMER);
+            sim_cpu_raise_event();
+            pthread_mutex_lock(&timer_lock);
+        }
     }
     return NULL;
 }
+
+/**********************************************************
+ * 
+ *  clock_now_us()
+ * 
+ *  DESCRIPTION:
+ *      Simulated 1MHz free counter, backed by the host's
+ *      monotonic clock or the virtual clock.
+ *
+ */
+
+uint64_t clock_now_us(void)
+{
+    return clock_now_ns() / 1000;
+}
+
+/**********************************************************
+ * 
+ *  clock_now_ns()
+ * 
+ *  DESCRIPTION:
+ *      The host's monotonic clock at full resolution, or
+ *      the virtual clock.
+ *
+ */
+
+uint64_t clock_now_ns(void)
+{
+#ifdef SIM_VIRTUAL_TIME
+    return __atomic_load_n(&sim_virtual_us, __ATOMIC_ACQUIRE) * 1000;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ( (uint64_t)ts.tv_sec * 1000000000ULL ) + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**********************************************************
+ * 
+ *  start_timer_thread()
+ * 
+ *  DESCRIPTION:
+ *      Start the timer thread, at SCHED_FIFO priority if
+ *      built with SIM_TIMER_FIFO and the host lets us.
+ *
+ */
+
+static boolean start_timer_thread(void)
+{
+    pthread_t thread;
+#ifdef SIM_TIMER_FIFO
+    pthread_attr_t attr;
+    struct sched_param param;
+    int err;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = SIM_TIMER_FIFO_PRIO;
+    pthread_attr_setschedparam(&attr, &param);
+
+    err = pthread_create(&thread, &attr, simulate_shed_timer_isr, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (err == 0) {
+        return TRUE;
+    }
+
+    printf("\nNo SCHED_FIFO for the timer thread (error %d), running it at normal priority\n", err);
+#endif
+
+    return ( pthread_create(&thread, NULL, simulate_shed_timer_isr, NULL) == 0 );
+}
+
+/**********************************************************
+ * 
+ *  wait_for_fire()
+ * 
+ *  DESCRIPTION:
+ *      Wait for the next timer interrupt and return the
+ *      counter at that point. Called with timer_lock held,
+ *      which is dropped while waiting.
+ *
+ */
+
+static uint64_t wait_for_fire(void)
+{
+    uint64_t fire_us;
+#ifndef SIM_VIRTUAL_TIME
+    struct pollfd fds[ SIM_TIMER_CHNL_COUNT ];
+    timer_id_t8 i;
+#endif
+
+    /* every timer may have been freed */
+    while (!next_fire(&fire_us)) {
+        pthread_cond_wait(&timer_cond, &timer_lock);
+    }
+
+#ifdef SIM_VIRTUAL_TIME
+    /* nothing can happen before the next interrupt once
+     * every core is idle, so skip straight to it. Tasks
+     * may move the deadline until then */
+    pthread_mutex_unlock(&timer_lock);
+    sim_cpu_wait_all_idle();
+    pthread_mutex_lock(&timer_lock);
+
+    if (next_fire(&fire_us) && fire_us > sim_virtual_us) {
+        __atomic_store_n(&sim_virtual_us, fire_us, __ATOMIC_RELEASE);
+    }
+#else
+    /* the timerfds hold the deadlines, so they can be
+     * moved while we wait */
+    for (i = 0; i < SIM_TIMER_CHNL_COUNT; i++) {
+        fds[i].fd = timer_chnls[i].fd;
+        fds[i].events = POLLIN;
+    }
+
+    pthread_mutex_unlock(&timer_lock);
+    poll(fds, SIM_TIMER_CHNL_COUNT, -1);
+    pthread_mutex_lock(&timer_lock);
+#endif
+
+    return clock_now_us();
+}
+
+/**********************************************************
+ * 
+ *  arm_chnl()
+ * 
+ *  DESCRIPTION:
+ *      Point a timer's timerfd at its next deadline, with
+ *      its interval after that, or disarm it once freed.
+ *      Called with timer_lock held.
+ *
+ */
+
+static void arm_chnl(sim_timer_chnl_t * chnl)
+{
+#ifndef SIM_VIRTUAL_TIME
+    struct itimerspec spec;
+    uint64_t interval_ns;
+
+    clr_mem(&spec, sizeof(spec));
+
+    if (chnl->in_use) {
+        interval_ns = (uint64_t)chnl->tick_interval * 1000;
+        spec.it_value.tv_sec = chnl->next_fire_us / 1000000;
+        spec.it_value.tv_nsec = ( chnl->next_fire_us % 1000000 ) * 1000;
+        spec.it_interval.tv_sec = interval_ns / 1000000000ULL;
+        spec.it_interval.tv_nsec = interval_ns % 1000000000ULL;
+    }
+
+    timerfd_settime(chnl->fd, TFD_TIMER_ABSTIME, &spec, NULL);
+#else
+    (void)chnl;
+#endif
+}
+
+/**********************************************************
+ * 
+ *  next_fire()
+ * 
+ *  DESCRIPTION:
+ *      Earliest interrupt of all timers, FALSE if none is
+ *      allocated. Called with timer_lock held.
+ *
+ */
+
+static boolean next_fire(uint64_t * fire_us)
+{
+    boolean found = FALSE;
+    timer_id_t8 i;
+
+    for (i = 0; i < SIM_TIMER_CHNL_COUNT; i++) {
+        if (timer_chnls[i].in_use && ( !found || timer_chnls[i].next_fire_us < *fire_us )) {
+            *fire_us = timer_chnls[i].next_fire_us;
+            found = TRUE;
+        }
+    }
+
+    return found;
+}
+
+#ifdef SIM_RUN_SECONDS
+/**********************************************************
+ * 
+ *  print_report()
+ * 
+ *  DESCRIPTION:
+ *      Print how late each timer's interrupts were served.
+ *      Deadlines stay on their grid, so lateness does not
+ *      add up into drift, missed deadlines are the ones
+ *      that came and went while the last was still being
+ *      served. Called with timer_lock held.
+ *
+ */
+
+static void print_report(void)
+{
+    sim_timer_chnl_t * chnl;
+    timer_id_t8 i;
+
+    printf("\ntimer interval_us fires missed avg_late_us max_late_us");
+
+    for (i = 0; i < SIM_TIMER_CHNL_COUNT; i++) {
+        chnl = &timer_chnls[i];
+        if (chnl->fires == 0) {
+            continue;
+        }
+
+        printf("\n%u %u %llu %llu %llu %u",
+               i,
+               chnl->tick_interval,
+               (unsigned long long)chnl->fires,
+               (unsigned long long)chnl->missed,
+               (unsigned long long)( chnl->late_sum_us / chnl->fires ),
+               chnl->late_max_us);
+    }
+
+    printf("\n");
+}
+#endif
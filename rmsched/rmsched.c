@@ -0,0 +1,1065 @@
+/**********************************************************
+ *
+ *  rmsched.c
+ *
+ *
+ *  DESCRIPTION:
+ *      Preemptive rate-monotonic task scheduler
+ *
+ *  NOTES:
+ *
+ *      Every task gets its own stack and is released
+ *      periodically. The ready task with the shortest
+ *      period always runs, preempting longer period tasks
+ *      on the IRQ exit path. A task that never returns only
+ *      starves tasks with a longer period than its own.
+ *
+ *      Tasks with a zero period are event driven. They are
+ *      only released by sched_activate_task() and rank
+ *      below every periodic task.
+ *
+ *      A boosted task, see sched_boost_task(), outranks
+ *      every task that is not. A task that finds a mutex
+ *      held can not block here, so it boosts the holder and
+ *      the holder runs out its critical section before the
+ *      waiter gets the CPU back.
+ *
+ *      Saved contexts use the kernel_entry/kernel_exit
+ *      frame layout from aarch64/vector.S, so a context
+ *      switch is just handing kernel_exit a different
+ *      stack pointer.
+ *
+ *      Run with RMSCHED_SHOW_DEBUG_DATA defined to show
+ *      debug messages.
+ *
+ */
+
+#include "printf.h"
+#include "sched.h"
+#include "generic.h"
+#include "uart.h"
+#include "utils.h"
+#include "vector.h"
+#include "irq.h"
+#include "sysregs.h"
+#include "defer.h"
+#include "peripherals/timer.h"
+
+/**
+ * $config: RMSCHED_TSK_MAX. Maximum number of tasks that can be
+ * registered. Priorities are tracked in a 32-bit ready mask so
+ * this can be no larger than 32.
+ *
+ */
+#ifndef RMSCHED_TSK_MAX
+#define RMSCHED_TSK_MAX  16
+    #warning Configuration RMSCHED_TSK_MAX not set, using default value of 16
+#endif
+
+#if RMSCHED_TSK_MAX > 32
+    #error RMSCHED_TSK_MAX must be 32 or less
+#endif
+
+/**
+ * $config: RMSCHED_STACK_SIZE. Size of each task stack in bytes.
+ * Must be a multiple of 16.
+ *
+ */
+#ifndef RMSCHED_STACK_SIZE
+#define RMSCHED_STACK_SIZE  4096
+    #warning Configuration RMSCHED_STACK_SIZE not set, using default value of 4096
+#endif
+
+/**
+ * $config: RMSCHED_SCHED_TICK_US. Microseconds per scheduler tick.
+ * Task periods are rounded down to a whole number of ticks.
+ *
+ */
+#ifndef RMSCHED_SCHED_TICK_US
+#define RMSCHED_SCHED_TICK_US 1000
+    #warning Configuration RMSCHED_SCHED_TICK_US not set, using default value of 1000uS.
+#endif
+
+#define US_TO_TICKS(us) ( (uint64_t)(us) / RMSCHED_SCHED_TICK_US )
+#define SCHED_INIT_KEY 0x52D3C0DE
+#define STACK_CANARY 0xDEADC0DEDEADC0DEULL
+#define NO_TASK RMSCHED_TSK_MAX
+
+/* Period a task is ranked on, event driven tasks rank last */
+#define RANK_PERIOD(cb) ( ( (cb)->period_ticks == 0 ) ? (uint64_t)0 - 1 : (cb)->period_ticks )
+
+/* Types */
+
+/**********************************************************
+ * rm_task_cb_t_struc:
+ *
+ *      Internal task control block type
+ *
+ *      alive
+ *
+ *          Task has not been killed.
+ *
+ *      usr_tsk
+ *
+ *          User task definition provided durring task
+ *          registration.
+ *
+ *      sp
+ *
+ *          Saved stack pointer, pointing at the exception
+ *          frame the task will be resumed from.
+ *
+ *      release_tick
+ *
+ *          Tick of the next release.
+ *
+ *      period_ticks
+ *
+ *          Task period converted to scheduler ticks. Zero
+ *          for an event driven task.
+ *
+ *      overrun_count
+ *
+ *          Number of releases that happened while the
+ *          previous job was still unfinished.
+ *
+ *      prio
+ *
+ *          Priority, 0 being the highest. Also the task's
+ *          bit in the ready mask.
+ *
+ *      boost
+ *
+ *          Boosts less unboosts, the task is boosted while
+ *          it is above zero.
+ *
+ */
+
+typedef struct rm_task_cb_t_struc
+    {
+    boolean           alive;
+    sched_usr_tsk_t * usr_tsk;
+    void            * sp;
+    uint64_t          release_tick;
+    uint64_t          period_ticks;
+    uint32_t          overrun_count;
+    sint32_t          boost;
+    uint8_t           prio;
+    } rm_task_cb_t;
+
+/**********************************************************
+ * Control variables:
+ *
+ *      task_list
+ *
+ *          Registered tasks, in registration order. Task
+ *          IDs index into this list.
+ *
+ *      prio_list
+ *
+ *          Registered tasks sorted by priority, i.e., by
+ *          ascending period. Built when the scheduler starts.
+ *
+ *      task_stacks
+ *
+ *          One stack per task slot.
+ *
+ *      ready_mask
+ *
+ *          Bit n is set when prio_list[n] has a released job
+ *          that has not finished yet. The running task keeps
+ *          its bit set until its job returns.
+ *
+ *      boost_mask
+ *
+ *          Bit n is set while prio_list[n] is boosted.
+ *
+ *      cur_task
+ *
+ *          Index into task_list of the running task, or
+ *          NO_TASK when sched_main() is idling.
+ *
+ *      idle_sp
+ *
+ *          Saved context of sched_main() while a task runs.
+ *
+ *      is_sched_running
+ *
+ *          Context switching is enabled. Stays FALSE until
+ *          sched_main() takes over so IRQs during kernel
+ *          initialization always return where they came from.
+ *
+ */
+
+static int sched_init_key;
+static rm_task_cb_t task_list[ RMSCHED_TSK_MAX ];
+static rm_task_cb_t * prio_list[ RMSCHED_TSK_MAX ];
+static uint8_t task_stacks[ RMSCHED_TSK_MAX ][ RMSCHED_STACK_SIZE ] __attribute__((aligned(16)));
+static uint32_t registered_tasks;
+static volatile uint32_t ready_mask;
+static volatile uint32_t boost_mask;
+static uint32_t cur_task;
+static void * idle_sp;
+static boolean is_sched_running;
+static timer_id_t8 sched_timer_id;
+static uint64_t system_tick;
+
+/* Forward declares */
+
+static void schedule_isr(void);
+static sched_err_t register_new_task(sched_usr_tsk_t * task);
+static boolean task_set_schedulable(void);
+static void task_trampoline(rm_task_cb_t * task);
+static void build_prio_list(void);
+static sched_err_t boost_task(sched_task_id_t task_id, sint32_t delta);
+static boolean should_preempt(void);
+#ifdef RMSCHED_SHOW_DEBUG_DATA
+static void print_task_overrun(void * ctx, uint32_t arg);
+#endif
+
+/**********************************************************
+ *
+ *  sched_main()
+ *
+ *  DESCRIPTION:
+ *      Main scheduling function. Control is passed to this
+ *      function after kernel is fully booted.
+ *
+ *      The calling context becomes the idle context and
+ *      only runs when no task has a pending job.
+ *
+ */
+
+void sched_main(void)
+{
+    /* Ensure scheduler was initialized */
+    if(sched_init_key != SCHED_INIT_KEY)
+    {
+    #ifdef RMSCHED_SHOW_DEBUG_DATA
+        printf("\nScheduler was not initialized before control was passed to it! Scheduler will not run. Call sched_init() to fix this.");
+    #endif
+        return;
+    }
+
+    /* Single core scheduler, any other core just returns */
+    if(get_core_id() != 0)
+    {
+        return;
+    }
+
+    vector_disable_irq();
+
+    build_prio_list();
+    cur_task = NO_TASK;
+    is_sched_running = TRUE;
+
+    /* Hand the CPU to the highest priority ready task. We
+     * come back here whenever nothing is ready */
+    vector_ctx_yield();
+
+    /* Idle context, run the ISR bottom halves */
+    while(TRUE)
+    {
+        defer_run(DEFER_RUN_BUDGET);
+    }
+}
+
+/**********************************************************
+ *
+ *  sched_init()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contract function. Initialize the scheduler. Called
+ *      during kernel initialization.
+ *
+ */
+
+sched_err_t sched_init(sched_usr_tsk_t *tasks, uint32_t num_tasks)
+{
+    /* local vars */
+    uint32_t i;
+
+    /* initialize the control variables */
+    sched_init_key = SCHED_INIT_KEY;
+    is_sched_running = FALSE;
+    registered_tasks = 0;
+    ready_mask = 0;
+    boost_mask = 0;
+    cur_task = NO_TASK;
+    idle_sp = NULL;
+    system_tick = 0;
+    clr_mem(task_list, sizeof(task_list));
+
+    /* make sure uart is initialized so we can debug print */
+    if(FALSE == uart_is_init())
+    {
+        uart_init();
+    }
+
+    /* input validation */
+    if( num_tasks > 0 && NULL == tasks )
+    {
+        return SCHED_ERR_PARAM;
+    }
+
+    /* Set up initial task list if provided one */
+    for(i = 0; i < num_tasks; i++)
+    {
+        register_new_task(&tasks[i]);
+    }
+
+    /* allocate a system timer */
+    if( TIMER_ERR_NONE != timer_alloc(&sched_timer_id, schedule_isr, RMSCHED_SCHED_TICK_US))
+    {
+    #ifdef RMSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to allocate a system timer. Cannot run scheduler.");
+    #endif
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_register_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted function to register a task.
+ *
+ *  NOTES:
+ *      Priorities are fixed once the scheduler is running,
+ *      so tasks can only be registered before sched_main().
+ *
+ */
+
+sched_err_t sched_register_task(sched_usr_tsk_t * task)
+{
+    if(is_sched_running)
+    {
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    return register_new_task(task);
+}
+
+/**********************************************************
+ *
+ *  register_new_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Register a new task and build the initial frame on
+ *      its stack.
+ *
+ *  NOTES:
+ *      The initial frame makes kernel_exit "return" into
+ *      task_trampoline() with x0 pointing at the task
+ *      control block, in EL1h with IRQs unmasked.
+ *
+ */
+
+static sched_err_t register_new_task(sched_usr_tsk_t * task)
+{
+    rm_task_cb_t * cb;
+    uint8_t * frame;
+
+    if(NULL == task || NULL == task->task_func || registered_tasks >= RMSCHED_TSK_MAX)
+    {
+    #ifdef RMSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to register task!");
+    #endif
+        return SCHED_ERR_FAILED_REG;
+    }
+
+    cb = &task_list[registered_tasks];
+    cb->usr_tsk = task;
+    cb->alive = TRUE;
+    cb->overrun_count = 0;
+    cb->boost = 0;
+
+    /* Periods under a tick still release once per tick */
+    cb->period_ticks = US_TO_TICKS(SCHED_TASK_PERIOD_US(task));
+    if(cb->period_ticks == 0 && SCHED_TASK_PERIOD_US(task) != 0)
+    {
+        cb->period_ticks = 1;
+    }
+
+    /* The new task is checked from its slot past the end of the list */
+    if(FALSE == task_set_schedulable())
+    {
+        cb->alive = FALSE;
+
+    #ifdef RMSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to register task! budget_us=%d would make the task set miss deadlines", task->budget_us);
+    #endif
+        return SCHED_ERR_UNSCHEDULABLE;
+    }
+
+    /* Canary at the bottom of the stack to catch overflows */
+    *(uint64_t *)task_stacks[registered_tasks] = STACK_CANARY;
+
+    /* Initial frame at the top of the stack */
+    frame = &task_stacks[registered_tasks][RMSCHED_STACK_SIZE - STACK_FRAME_SIZE];
+    clr_mem(frame, STACK_FRAME_SIZE);
+    *(uint64_t *)&frame[0] = (uint64_t)cb;
+    *(uint64_t *)&frame[FRAME_ELR_OFFSET] = (uint64_t)task_trampoline;
+    *(uint64_t *)&frame[FRAME_SPSR_OFFSET] = SPSR_EL1h;
+    cb->sp = frame;
+
+    task->id = registered_tasks;
+    registered_tasks++;
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  task_set_schedulable()
+ *
+ *
+ *  DESCRIPTION:
+ *      Schedulability test of the registered tasks plus
+ *      the one being registered in the slot after them.
+ *      Only periodic tasks that declare a budget, C, are
+ *      analyzed, with periods, T, in microseconds. Event
+ *      driven tasks rank below all of them, so they do not
+ *      change the result.
+ *
+ *      Utilization bound
+ *          sum( C / T ) <= 1, necessary for any task set.
+ *
+ *      Response time
+ *          The worst case response of task i is the fixed
+ *          point of
+ *
+ *              R = Ci + sum( ceil( R / Tj ) * Cj )
+ *
+ *          over the tasks j that outrank i, i.e., that
+ *          have shorter periods or the same period and
+ *          were registered first, see build_prio_list().
+ *          Every task needs R <= Ti.
+ *
+ *  NOTES:
+ *      Tasks are fully preemptive and share nothing, so
+ *      there is no blocking term.
+ *
+ */
+
+static boolean task_set_schedulable(void)
+{
+    rm_task_cb_t * task;
+    rm_task_cb_t * hp;
+    uint64_t period_us;
+    uint64_t response_us;
+    uint64_t next_us;
+    uint64_t util;
+    uint32_t i;
+    uint32_t j;
+
+    util = 0;
+    for(i = 0; i <= registered_tasks; i++)
+    {
+        task = &task_list[i];
+        if(task->alive == TRUE && task->usr_tsk->budget_us != 0 && task->period_ticks != 0)
+        {
+            period_us = task->period_ticks * RMSCHED_SCHED_TICK_US;
+
+            /* 16.16 fixed point, rounded up */
+            util += ( ( (uint64_t)task->usr_tsk->budget_us << 16 ) + period_us - 1 ) / period_us;
+        }
+    }
+
+    if(util > ( 1 << 16 ))
+    {
+        return FALSE;
+    }
+
+    for(i = 0; i <= registered_tasks; i++)
+    {
+        task = &task_list[i];
+        if(task->alive == FALSE || task->usr_tsk->budget_us == 0 || task->period_ticks == 0)
+        {
+            continue;
+        }
+
+        period_us = task->period_ticks * RMSCHED_SCHED_TICK_US;
+        next_us = task->usr_tsk->budget_us;
+
+        /* Iterate until R settles or passes the deadline */
+        do
+        {
+            response_us = next_us;
+            next_us = task->usr_tsk->budget_us;
+
+            for(j = 0; j <= registered_tasks; j++)
+            {
+                hp = &task_list[j];
+                if(hp == task || hp->alive == FALSE || hp->usr_tsk->budget_us == 0 || hp->period_ticks == 0)
+                {
+                    continue;
+                }
+
+                if(hp->period_ticks < task->period_ticks
+                 || ( hp->period_ticks == task->period_ticks && j < i ))
+                {
+                    period_us = hp->period_ticks * RMSCHED_SCHED_TICK_US;
+                    next_us += ( ( response_us + period_us - 1 ) / period_us ) * hp->usr_tsk->budget_us;
+                }
+            }
+
+            if(next_us > task->period_ticks * RMSCHED_SCHED_TICK_US)
+            {
+                return FALSE;
+            }
+        } while(next_us != response_us);
+    }
+
+    return TRUE;
+}
+
+/**********************************************************
+ *
+ *  build_prio_list()
+ *
+ *
+ *  DESCRIPTION:
+ *      Assign rate-monotonic priorities. Shorter periods get
+ *      higher priorities, ties go to the task registered
+ *      first, event driven tasks come last. Called with
+ *      IRQs masked.
+ *
+ */
+
+static void build_prio_list(void)
+{
+    uint32_t i;
+    uint32_t j;
+    rm_task_cb_t * cb;
+
+    /* Insertion sort, the task list is small */
+    for(i = 0; i < registered_tasks; i++)
+    {
+        cb = &task_list[i];
+        j = i;
+        while(j > 0 && RANK_PERIOD(prio_list[j - 1]) > RANK_PERIOD(cb))
+        {
+            prio_list[j] = prio_list[j - 1];
+            j--;
+        }
+        prio_list[j] = cb;
+    }
+
+    /* First release of every task is on the next tick */
+    for(i = 0; i < registered_tasks; i++)
+    {
+        prio_list[i]->prio = i;
+        prio_list[i]->release_tick = system_tick + 1;
+    }
+}
+
+/**********************************************************
+ *
+ *  schedule_isr()
+ *
+ *
+ *  DESCRIPTION:
+ *      Scheduler ISR. Releases due jobs.
+ *
+ *  NOTES:
+ *      The switch to a newly released, higher priority task
+ *      happens in sched_ctx_switch() on the way out of the
+ *      IRQ.
+ *
+ */
+
+static void schedule_isr(void)
+{
+    uint32_t i;
+    rm_task_cb_t * cb;
+
+    system_tick++;
+
+    /* Priorities are not assigned until sched_main() */
+    if(is_sched_running == FALSE)
+    {
+        return;
+    }
+
+    for(i = 0; i < registered_tasks; i++)
+    {
+        cb = &task_list[i];
+        if(cb->alive == FALSE || cb->period_ticks == 0 || system_tick < cb->release_tick)
+        {
+            continue;
+        }
+
+        /* Previous job has not finished yet */
+        if(ready_mask & BIT(cb->prio))
+        {
+            cb->overrun_count++;
+
+        #ifdef RMSCHED_SHOW_DEBUG_DATA
+            if(cb->overrun_count == 1)
+            {
+                defer_work(print_task_overrun, NULL, cb->usr_tsk->id);
+            }
+        #endif
+        }
+
+        ready_mask |= BIT(cb->prio);
+        cb->release_tick += cb->period_ticks;
+    }
+}
+
+#ifdef RMSCHED_SHOW_DEBUG_DATA
+/**********************************************************
+ *
+ *  print_task_overrun()
+ *
+ *
+ *  DESCRIPTION:
+ *      Deferred from the ISR, report an overrun of the task
+ *      with id arg.
+ *
+ */
+
+static void print_task_overrun(void * ctx, uint32_t arg)
+{
+    (void)ctx;
+
+    printf("\nTask overrun has occured on task with id=%d. Consider lengthening period_ms on task registration.", arg);
+}
+#endif
+
+/**********************************************************
+ *
+ *  sched_ctx_switch()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted preemptive scheduler function. Save the
+ *      frame of the current context and return the frame
+ *      of the highest priority ready task, or of the idle
+ *      context if nothing is ready. Boosted tasks go first.
+ *
+ */
+
+void * sched_ctx_switch(void * frame)
+{
+    uint32_t ready;
+    uint32_t next;
+
+    if(is_sched_running == FALSE)
+    {
+        return frame;
+    }
+
+    /* Save the current context */
+    if(cur_task == NO_TASK)
+    {
+        idle_sp = frame;
+    }
+    else
+    {
+        task_list[cur_task].sp = frame;
+
+    #ifdef RMSCHED_SHOW_DEBUG_DATA
+        if(*(uint64_t *)task_stacks[cur_task] != STACK_CANARY)
+        {
+            printf("\nStack overflow on task with id=%d", task_list[cur_task].usr_tsk->id);
+        }
+    #endif
+    }
+
+    /* Lowest set bit is the highest priority ready task */
+    if(ready_mask == 0)
+    {
+        cur_task = NO_TASK;
+        return idle_sp;
+    }
+
+    ready = ready_mask & boost_mask;
+    if(ready == 0)
+    {
+        ready = ready_mask;
+    }
+
+    next = prio_list[__builtin_ctz(ready)]->usr_tsk->id;
+    cur_task = next;
+
+    return task_list[next].sp;
+}
+
+/**********************************************************
+ *
+ *  task_trampoline()
+ *
+ *
+ *  DESCRIPTION:
+ *      Entry point of every task context. Runs one job per
+ *      release and yields in between.
+ *
+ */
+
+static void task_trampoline(rm_task_cb_t * task)
+{
+    while(TRUE)
+    {
+        task->usr_tsk->task_func();
+
+        /* Job done, wait for the next release */
+        vector_disable_irq();
+        ready_mask &= ~BIT(task->prio);
+        vector_ctx_yield();
+    }
+}
+
+/**********************************************************
+ *
+ *  sched_kill_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function.
+ *
+ *      Kill a task. A task that kills itself does not
+ *      return from this call.
+ *
+ *  NOTES:
+ *      Called with IRQs masked, e.g., from an ISR, the
+ *      switch away is left to the next IRQ exit, see
+ *      sched_ctx_switch().
+ *
+ */
+
+sched_err_t sched_kill_task(sched_task_id_t task_id)
+{
+    irq_flags_t flags;
+
+    if(task_id >= registered_tasks || task_list[task_id].alive == FALSE)
+    {
+        return SCHED_ERR_FAILED_UPDATE;
+    }
+
+    if(is_sched_running == FALSE)
+    {
+        task_list[task_id].alive = FALSE;
+        return SCHED_ERR_NO_ERR;
+    }
+
+    flags = irq_save();
+
+    task_list[task_id].alive = FALSE;
+    ready_mask &= ~BIT(task_list[task_id].prio);
+
+    if(cur_task == task_id && !( flags & VECTOR_DAIF_IRQ ))
+    {
+        vector_ctx_yield();
+    }
+
+    irq_restore(flags);
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_activate_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Release a job of the
+ *      task right away, outside of its period.
+ *
+ *  NOTES:
+ *      Safe from ISRs. With IRQs masked the activation only
+ *      marks the task ready, a preemption is left to the
+ *      next IRQ exit, see sched_ctx_switch().
+ *
+ */
+
+sched_err_t sched_activate_task(sched_task_id_t task_id)
+{
+    irq_flags_t flags;
+
+    if(task_id >= registered_tasks || task_list[task_id].alive == FALSE || is_sched_running == FALSE)
+    {
+        return SCHED_ERR_FAILED_UPDATE;
+    }
+
+    flags = irq_save();
+
+    ready_mask |= BIT(task_list[task_id].prio);
+
+    /* Preempt ourselves if the activated task outranks us */
+    if(!( flags & VECTOR_DAIF_IRQ ) && should_preempt())
+    {
+        vector_ctx_yield();
+    }
+
+    irq_restore(flags);
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_boost_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. The task outranks
+ *      every task that is not boosted, and is switched to
+ *      straight away if it is ready.
+ *
+ */
+
+sched_err_t sched_boost_task(sched_task_id_t task_id)
+{
+    return boost_task(task_id, 1);
+}
+
+/**********************************************************
+ *
+ *  sched_unboost_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. A task that drops its
+ *      last boost gives the CPU up to any higher priority
+ *      task that was held off by it.
+ *
+ */
+
+sched_err_t sched_unboost_task(sched_task_id_t task_id)
+{
+    return boost_task(task_id, -1);
+}
+
+/**********************************************************
+ *
+ *  boost_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Add delta to the task's boost and switch to whatever
+ *      should run now.
+ *
+ *  NOTES:
+ *      Only yields if the boost changed who runs, and never
+ *      with IRQs masked by the caller, see
+ *      sched_activate_task().
+ *
+ */
+
+static sched_err_t boost_task(sched_task_id_t task_id, sint32_t delta)
+{
+    rm_task_cb_t * cb;
+    irq_flags_t flags;
+
+    if(task_id >= registered_tasks || task_list[task_id].alive == FALSE || is_sched_running == FALSE)
+    {
+        return SCHED_ERR_FAILED_UPDATE;
+    }
+
+    cb = &task_list[task_id];
+
+    flags = irq_save();
+
+    cb->boost += delta;
+    if(cb->boost > 0)
+    {
+        boost_mask |= BIT(cb->prio);
+    }
+    else
+    {
+        boost_mask &= ~BIT(cb->prio);
+    }
+
+    if(!( flags & VECTOR_DAIF_IRQ ) && should_preempt())
+    {
+        vector_ctx_yield();
+    }
+
+    irq_restore(flags);
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  should_preempt()
+ *
+ *
+ *  DESCRIPTION:
+ *      sched_ctx_switch() would pick another context than
+ *      the running one. Called with IRQs masked.
+ *
+ */
+
+static boolean should_preempt(void)
+{
+    uint32_t ready;
+
+    if(ready_mask == 0)
+    {
+        return ( cur_task != NO_TASK );
+    }
+
+    if(cur_task == NO_TASK)
+    {
+        return TRUE;
+    }
+
+    ready = ready_mask & boost_mask;
+    if(ready == 0)
+    {
+        ready = ready_mask;
+    }
+
+    return ( prio_list[__builtin_ctz(ready)] != &task_list[cur_task] );
+}
+
+/**********************************************************
+ *
+ *  sched_register_server()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, post
+ *      aperiodic work from a periodic task instead.
+ *
+ */
+
+sched_err_t sched_register_server(sched_usr_tsk_t * task)
+{
+    (void)task;
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_server_post()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, see
+ *      sched_register_server().
+ *
+ */
+
+sched_err_t sched_server_post(sched_task_id_t server_id, spsc_work_func_t func, void * ctx, uint32_t arg)
+{
+    (void)server_id;
+    (void)func;
+    (void)ctx;
+    (void)arg;
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_yield()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Tasks only ever give
+ *      up the CPU to a higher priority release, not on
+ *      request.
+ *
+ */
+
+sched_err_t sched_yield(void)
+{
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_sleep_us()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, see
+ *      sched_yield().
+ *
+ */
+
+sched_err_t sched_sleep_us(uint32_t us)
+{
+    (void)us;
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_wait_until()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, see
+ *      sched_yield().
+ *
+ */
+
+sched_err_t sched_wait_until(uint64_t tick)
+{
+    (void)tick;
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_wait_activation()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Not supported, see
+ *      sched_yield().
+ *
+ */
+
+sched_err_t sched_wait_activation(void)
+{
+    return SCHED_ERR_INVLD_STATE;
+}
+
+/**********************************************************
+ *
+ *  sched_get_current_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function.
+ *
+ */
+
+sched_err_t sched_get_current_task(sched_task_id_t * task_id)
+{
+    if(task_id == NULL || cur_task == NO_TASK)
+    {
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    *task_id = cur_task;
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_get_tick()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function.
+ *
+ */
+
+uint64_t sched_get_tick(void)
+{
+    return system_tick;
+}
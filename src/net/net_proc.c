@@ -1,30 +1,169 @@
 /**********************************************************
- * 
+ *
  *  net_proc.c
- * 
+ *
  *      Network processing task and friends
  *
+ *  NOTES:
+ *      Packets are processed on a scheduler server, posted
+ *      from the receive interrupt, so they are picked up as
+ *      soon as they arrive without the network taking more
+ *      than the server's budget away from the periodic
+ *      tasks. Schedulers without servers fall back to
+ *      polling.
+ *
+ *      Either the receive interrupt is unmasked or exactly
+ *      one net_proc() job is posted, never both. A job that
+ *      may have left packets behind posts the next one, the
+ *      last job acks the interrupt.
+ *
  */
 
+#ifdef EMBEDDED_BUILD
+#include "printf.h"
+#else
+#include <stdio.h>
+#endif
+
 #include "net.h"
 #include "generic.h"
+#include "sched.h"
 
 #define IN_DATA_BUFF_SIZE 1200
 
+/**
+ * $config: NET_SERVER_PERIOD_MS, NET_SERVER_BUDGET_US. CPU time the network
+ * server may use for packet processing per period.
+ *
+ */
+#ifndef NET_SERVER_PERIOD_MS
+#define NET_SERVER_PERIOD_MS 100
+#endif
+
+#ifndef NET_SERVER_BUDGET_US
+#define NET_SERVER_BUDGET_US 10000
+#endif
+
+/**
+ * $config: NET_POLL_PERIOD_MS. Polling period used when the scheduler has
+ * no servers.
+ *
+ */
+#ifndef NET_POLL_PERIOD_MS
+#define NET_POLL_PERIOD_MS 100
+#endif
+
+/**
+ * $config: NET_PROC_BATCH. Most packets read by one net_proc() job, so a
+ * flood of packets is spread over jobs the server can check its budget
+ * between.
+ *
+ */
+#ifndef NET_PROC_BATCH
+#define NET_PROC_BATCH 8
+#endif
+
 static char in_data_buffer[ IN_DATA_BUFF_SIZE ];
 
+static void net_rx_isr(void);
+static void net_poll_task(void);
+
+static sched_usr_tsk_t net_server =
+    {
+    .period_ms = NET_SERVER_PERIOD_MS,
+    .budget_us = NET_SERVER_BUDGET_US,
+    };
+
+static sched_usr_tsk_t net_poll =
+    {
+    .period_ms = NET_POLL_PERIOD_MS,
+    .task_func = net_poll_task,
+    };
+
 /**********************************************************
- * 
+ *
+ *  net_proc_start()
+ *
+ *  DESCRIPTION:
+ *      Start network processing. Called once the scheduler
+ *      is initialized.
+ *
+ */
+
+void net_proc_start(void)
+{
+    if(SCHED_ERR_NO_ERR == sched_register_server(&net_server))
+    {
+        net_rx_irq_enable(net_rx_isr);
+        return;
+    }
+
+    /* No server to post to, poll instead */
+    sched_register_task(&net_poll);
+}
+
+/**********************************************************
+ *
  *  net_proc()
- * 
+ *
+ *  DESCRIPTION:
+ *      Network processing job. Reads up to NET_PROC_BATCH
+ *      waiting packets. A full batch may have left more
+ *      behind, so a job posted to the server, ctx being the
+ *      server's task, posts another. Otherwise the receive
+ *      interrupt is let back in.
+ *
+ */
+
+void net_proc(void * ctx, uint32_t arg)
+{
+    uint32_t cnt;
+
+    (void)arg;
+
+    for(cnt = 0; cnt < NET_PROC_BATCH; cnt++)
+    {
+        if(get_packet(in_data_buffer, IN_DATA_BUFF_SIZE - 1, 0) <= 0)
+        {
+            break;
+        }
+
+        printf("packet_data=%s", in_data_buffer);
+        clr_mem(in_data_buffer, sizeof(in_data_buffer));
+    }
+
+    if(cnt == NET_PROC_BATCH && ctx != NULL
+     && SCHED_ERR_NO_ERR == sched_server_post(net_server.id, net_proc, ctx, 0))
+    {
+        return;
+    }
+
+    /* If the post failed the interrupt fires again on what is left */
+    net_rx_irq_ack();
+}
+
+/**********************************************************
+ *
+ *  net_rx_isr()
+ *
  *  DESCRIPTION:
- *      Network processing task
+ *      Packet receive interrupt, hands the packets to the
+ *      network server.
  *
  */
 
-void net_proc()
+static void net_rx_isr(void)
 {
-    get_packet(&in_data_buffer, IN_DATA_BUFF_SIZE, 1);
+    /* The interrupt stays masked until the last net_proc()
+     * job acks it. If the job can not be posted, ack it
+     * here so the post is retried when it fires again */
+    if(SCHED_ERR_NO_ERR != sched_server_post(net_server.id, net_proc, &net_server, 0))
+    {
+        net_rx_irq_ack();
+    }
+}
 
-    printf("packet_data=%s", in_data_buffer);
-}
\ No newline at end of file
+static void net_poll_task(void)
+{
+    net_proc(NULL, 0);
+}
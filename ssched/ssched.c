@@ -11,6 +11,30 @@
  *      Run with SSCHED_SHOW_DEBUG_DATA defined to show debug
  *      messages.
  *
+ *      Run with SSCHED_LOG_TASK_STATS defined to collect per
+ *      task execution time and release statistics, see
+ *      ssched_get_task_stats().
+ *
+ *      Run with SSCHED_TICKLESS defined to only take a timer
+ *      interrupt when something is due, see schedule_isr().
+ *      Idle cores sleep in cpu_idle() either way.
+ *
+ *      Every core runs sched_main(). Released tasks are queued
+ *      on their home core and a core with nothing to run steals
+ *      from the other cores' queues, as long as the task's
+ *      affinity allows it. The scheduler ISR only runs on
+ *      core 0, so core 0 also runs the work it defers, see
+ *      defer.h.
+ *
+ *      A task that runs past its budget is handled according
+ *      to its overrun_policy, see handle_overrun(). Tasks using
+ *      SCHED_OVERRUN_ABORT are kept on core 0 since the abort
+ *      is taken on the return from the scheduler ISR.
+ *
+ *      Run with SSCHED_CYCLIC defined to release the periodic
+ *      tasks given to sched_init() from a schedule table
+ *      generated offline, see SSCHED_CYCLIC_TABLE.
+ *
  */
 #ifdef EMBEDDED_BUILD
 #include "printf.h"
@@ -20,9 +44,17 @@
 
 #include "sched.h"
 #include "generic.h"
+#include "cpu.h"
+#include "cpu_jmp.h"
+#include "cpu_ctx.h"
+#include "irq.h"
+#include "utils.h"
+#include "spinlock.h"
 #include "uart.h"
 #include "peripherals/timer.h"
 #include "debug.h"
+#include "defer.h"
+#include "trace.h"
 #include "ssched.h"
 
 /**
@@ -55,7 +87,9 @@
  * Also note, the tick percision could vary depending on the CPU
  * and underlying timer hardware. It is important to understand
  * the limitations of your system before choosing a tick value,
- * but generally, a value of 1ms or larger is recommended.
+ * but generally, a value of 1ms or larger is recommended. Task
+ * times are held in microseconds whatever the tick, the tick
+ * only has to be as short as the shortest period.
  *
  */
 #ifndef SSCHED_SCHED_TICK_US
@@ -63,12 +97,184 @@
     #warning Configuration SSCHED_SCHED_TICK_US not set, using default value of 1000uS.
 #endif
 
+/**
+ * $config: SSCHED_CORE_COUNT. Number of cores that run tasks. Cores with
+ * an id at or above this return from sched_main() straight away. Must not
+ * be larger than CPU_CORE_COUNT.
+ *
+ */
+#ifndef SSCHED_CORE_COUNT
+#define SSCHED_CORE_COUNT CPU_CORE_COUNT
+#endif
+
+#if ( SSCHED_CORE_COUNT > CPU_CORE_COUNT ) || ( SSCHED_CORE_COUNT > 32 )
+    #error SSCHED_CORE_COUNT must not be larger than CPU_CORE_COUNT or 32
+#endif
+
+#define SSCHED_CORE_MASK ( (uint32_t)( ( 1ULL << SSCHED_CORE_COUNT ) - 1 ) )
+
+/**
+ * $config: SSCHED_TICKLESS_MAX_SLEEP_US. Longest the scheduler timer is
+ * left without an interrupt in tickless mode. Must fit the 32-bit timer
+ * compare, keeping it short also bounds how stale the tick gets.
+ *
+ */
+#ifndef SSCHED_TICKLESS_MAX_SLEEP_US
+#define SSCHED_TICKLESS_MAX_SLEEP_US 1000000
+#endif
+
+/**
+ * $config: SSCHED_STACK_POOL_SIZE. Bytes set aside for the stacks of tasks
+ * registered with a non-zero stack_size. Registration fails once the pool
+ * is used up. Stacks are never given back, killing a task does not free
+ * its stack.
+ *
+ */
+#ifndef SSCHED_STACK_POOL_SIZE
+#define SSCHED_STACK_POOL_SIZE 65536
+#endif
+
+/**
+ * $config: SSCHED_SERVER_MAX. Number of servers that can be registered at
+ * once, see sched_register_server().
+ *
+ */
+#ifndef SSCHED_SERVER_MAX
+#define SSCHED_SERVER_MAX 4
+#endif
+
+/**
+ * $config: SSCHED_SERVER_QUEUE_LEN. Jobs that can be waiting on a server
+ * at once. Must be a power of two. Posting to a full queue fails and is
+ * counted in the queue's dropped count.
+ *
+ */
+#ifndef SSCHED_SERVER_QUEUE_LEN
+#define SSCHED_SERVER_QUEUE_LEN 16
+#endif
+
+#if ( SSCHED_SERVER_QUEUE_LEN & ( SSCHED_SERVER_QUEUE_LEN - 1 ) ) != 0
+    #error SSCHED_SERVER_QUEUE_LEN must be a power of two
+#endif
+
+/**
+ * $config: SSCHED_PHASE_WINDOW. Ticks looked ahead when picking a task's
+ * phase for SCHED_PHASE_AUTO. The hyperperiod of the periodic tasks is used
+ * when it is shorter, otherwise releases past the window are not accounted
+ * for. Costs 4 bytes per tick.
+ *
+ */
+#ifndef SSCHED_PHASE_WINDOW
+#define SSCHED_PHASE_WINDOW 512
+#endif
+
+/**
+ * $config: SSCHED_CYCLIC_TABLE. Schedule table used by SSCHED_CYCLIC, a header
+ * generated by tools/scripts/gen_cyclic_table.py from the periods and budgets
+ * of the task list given to sched_init(), in that order. The scheduler ISR
+ * releases each minor frame's tasks straight out of the table on core 0,
+ * periods are not looked at. Periodic tasks can not be registered later on,
+ * servers and event driven tasks can, they run in the table's slack.
+ *
+ */
+#ifdef SSCHED_CYCLIC
+#ifndef SSCHED_CYCLIC_TABLE
+#define SSCHED_CYCLIC_TABLE "ssched_cyclic_table.h"
+#endif
+
+#include SSCHED_CYCLIC_TABLE
+
+#if ( SSCHED_CYCLIC_MINOR_US % SSCHED_SCHED_TICK_US ) != 0
+    #error SSCHED_CYCLIC_MINOR_US must be a whole number of scheduler ticks
+#endif
+#endif
+
+/* How often an event driven task comes off the release
+ * heap, only to hand back its slot once it is killed */
+#define EVENT_TASK_SWEEP_US 1000000
+
+/* Written to the lowest word of each task stack, checked
+ * every time the task gives the CPU back */
+#define STACK_CANARY 0x5AC4ED5EUL
+
+/* Task ids are handles, the slot in system_task_list in the
+ * low bits and the slot's generation above it. A killed
+ * task's slot moves on a generation, so its old handle no
+ * longer matches anything */
+#define HANDLE_SLOT_BITS 8
+#define HANDLE_SLOT_MASK ( ( 1UL << HANDLE_SLOT_BITS ) - 1 )
+#define HANDLE_GEN_MASK ( 0xFFFFFFFFUL >> HANDLE_SLOT_BITS )
+#define TASK_HANDLE(tcb) ( (sched_task_id_t)( ( (tcb)->generation << HANDLE_SLOT_BITS ) | (uint32_t)( (tcb) - system_task_list ) ) )
+
+#if SSCHED_TSK_MAX_REGISTERED > ( 1 << HANDLE_SLOT_BITS )
+    #error SSCHED_TSK_MAX is too large for the task handle slot bits
+#endif
+
 #define US_PER_MS 1000
-#define MS_PER_TICKS ( SSCHED_SCHED_TICK_US / US_PER_MS )
+#define US_TO_TICKS_CEIL(us) ( ( (uint64_t)(us) + SSCHED_SCHED_TICK_US - 1 ) / SSCHED_SCHED_TICK_US )
 #define SCHED_INIT_KEY 0x78DEF087
 
+/* Scheduler time right now, microseconds since tick 0. It only
+ * moves on an interrupt unless tickless */
+#ifdef SSCHED_TICKLESS
+#define current_us() ( clock_now_us() - tick_base_us )
+#else
+#define current_us() ( system_tick * SSCHED_SCHED_TICK_US )
+#endif
+
+#define current_tick() ( current_us() / SSCHED_SCHED_TICK_US )
+
+/* Scheduler time wraps, times are only ever compared through
+ * their difference so a compare stays right across the wrap as
+ * long as the two are less than 2^63us apart */
+#define TIME_BEFORE_EQ(a, b) ( (sint64_t)( (a) - (b) ) <= 0 )
+#define TIME_BEFORE(a, b) ( (sint64_t)( (a) - (b) ) < 0 )
+
 /* Types */
 
+typedef uint8_t coop_state_t;
+enum
+{
+    COOP_RUNNING,       /* Task is running or has not run yet */
+    COOP_YIELD,         /* Task yielded, requeue it */
+    COOP_SLEEP,         /* Task is sleeping until wake_us */
+    COOP_WAIT,          /* Task is waiting for sched_activate_task() */
+    COOP_DONE,          /* Task procedure returned */
+};
+
+/**********************************************************
+ * server_cb_t:
+ *
+ *      Server control block, see sched_register_server()
+ *
+ *      jobs, queue
+ *
+ *          Jobs posted to the server, oldest first. The ring
+ *          is single producer, so posts are serialized on the
+ *          server's home core lock.
+ *
+ *      capacity_us
+ *
+ *          Budget left in the current period. Topped back up
+ *          by the scheduler ISR on every release of the
+ *          server.
+ *
+ *      in_use
+ *
+ *          The block belongs to a registered server.
+ *
+ *      All but jobs are guarded by the home core lock.
+ *
+ */
+
+typedef struct
+    {
+    spsc_work_t        jobs[ SSCHED_SERVER_QUEUE_LEN ];
+    spsc_ring_t        queue;
+    uint64_t           capacity_us;
+    boolean            in_use;
+    } server_cb_t;
+
 /**********************************************************
  * task_cb_t_struc:
  *
@@ -86,6 +292,22 @@
  *          for scheduling. Some examples of when a task is
  *          not active would be if it is waiting on a lock
  *          or some other condition before it can be ran.
+ *          Cleared while the task waits for an activation,
+ *          i.e., an idle event driven task or one blocked in
+ *          sched_wait_activation().
+ *
+ *      periodic
+ *
+ *          Task is released every period_us. Event driven
+ *          tasks are only released by sched_activate_task().
+ *
+ *      activate_pending
+ *
+ *          sched_activate_task() was called while the task
+ *          was running or part way through a cycle. Taken by
+ *          its next sched_wait_activation(), or else gives
+ *          it another cycle once it finishes. Guarded by the
+ *          home core's lock.
  * 
  *      scheduled
  *
@@ -96,17 +318,130 @@
  *          User task definition provided durring task
  *          registration.
  *
- *      active_tick
+ *      queued
+ *
+ *          Task has been released and is waiting in the
+ *          ready queue to be dispatched.
+ *
+ *      active_us
+ *
+ *          Scheduler time when the task was dispatched.
+ *
+ *      cycle_end_us
+ *
+ *          Scheduler time when the task finished executing.
+ *
+ *      next_release_us
+ *
+ *          Scheduler time of the next release. This is the
+ *          key the task is sorted on in the release heap.
+ *          Moved on a whole period per release, so releases
+ *          never drift from the period whatever the tick.
+ *
+ *      period_us
+ *
+ *          Task period in microseconds.
+ *
+ *      budget_us
+ *
+ *          Time the task may run for in one cycle before it
+ *          counts as overrun.
+ *
+ *      degraded_period_us
+ *
+ *          Period the task moves to under
+ *          SCHED_OVERRUN_DEGRADE.
+ *
+ *      overrun_policy
+ *
+ *          What to do once the task overruns, see
+ *          handle_overrun().
+ *
+ *      skip_release
+ *
+ *          Drop the next release, set by SCHED_OVERRUN_SKIP.
+ *
+ *      overrun_stats
+ *
+ *          Overrun counters. Guarded by the home core's lock.
+ *
+ *      affinity
+ *
+ *          Cores the task may run on, never zero.
+ *
+ *      home_core
  *
- *          Tick when the task became active.
+ *          Core whose ready queue the task is released into.
+ *          The task's alive, queued and scheduled flags are
+ *          guarded by that core's lock.
  *
- *      cycle_end_tick
+ *      release_us
  *
- *          Tick when the task finished executing.
+ *          System counter at the last release that made it
+ *          onto the ready queue.
+ *
+ *      stats
+ *
+ *          Task statistics. Cycle figures are guarded by the
+ *          home core's lock, overruns and missed_releases are
+ *          only ever written by the scheduler ISR.
+ *
+ *      stack, stack_size
+ *
+ *          The task's own stack, NULL for tasks that run to
+ *          completion on the scheduler's stack.
+ *
+ *      ctx
+ *
+ *          Where a task with its own stack left off.
+ *
+ *      started
+ *
+ *          The task has a cycle in progress, i.e., it gave
+ *          the CPU up part way through. Releases are missed
+ *          until it finishes. Guarded by the home core's
+ *          lock.
+ *
+ *      coop_state
+ *
+ *          Why the task last switched back to the scheduler.
+ *
+ *      wake_us
+ *
+ *          Scheduler time a sleeping task is woken at.
+ *
+ *      job_start_us, job_run_us
+ *
+ *          System counter when the current cycle first ran
+ *          and the time it has run for so far.
+ *
+ *      server
+ *
+ *          Server the task runs jobs for, NULL for every
+ *          other task.
+ *
+ *      generation
+ *
+ *          Generation of the slot, part of the task's
+ *          handle. Moved on when the task is killed, never
+ *          zero once the slot has been used.
  *
  *      next_task
  *
- *          Next task to run on the scheduler.
+ *          Next task to run on the scheduler, i.e., the
+ *          next entry in the ready queue. Next free slot
+ *          while the slot is on the free list.
+ *
+ *      next_sleeper
+ *
+ *          Next entry in the sleep list.
+ *
+ *      boost
+ *
+ *          Boosts less unboosts, see sched_boost_task(). A
+ *          task is queued at the head of its ready queue
+ *          while it is above zero. Guarded by the home
+ *          core's lock.
  *          
  */
 
@@ -114,11 +449,39 @@ typedef struct task_cb_t_struc
     {
     boolean                  alive;
     boolean                  active;
+    boolean                  periodic;
+    boolean                  activate_pending;
     boolean                  scheduled;
+    boolean                  queued;
     sched_usr_tsk_t        * usr_tsk;
-    uint64_t                 active_tick;
-    uint64_t                 cycle_end_tick;
+    uint64_t                 active_us;
+    uint64_t                 cycle_end_us;
+    uint64_t                 next_release_us;
+    uint64_t                 period_us;
+    uint64_t                 budget_us;
+    uint64_t                 degraded_period_us;
+    sched_overrun_policy_t   overrun_policy;
+    boolean                  skip_release;
+    ssched_overrun_stats_t   overrun_stats;
+    uint32_t                 affinity;
+    uint32_t                 home_core;
+    uint8_t                * stack;
+    uint32_t                 stack_size;
+    cpu_ctx_t                ctx;
+    boolean                  started;
+    coop_state_t             coop_state;
+    uint64_t                 wake_us;
+    server_cb_t            * server;
+    uint32_t                 generation;
+    sint32_t                 boost;
+#ifdef SSCHED_LOG_TASK_STATS
+    uint64_t                 release_us;
+    uint64_t                 job_start_us;
+    uint64_t                 job_run_us;
+    ssched_task_stats_t      stats;
+#endif
     struct task_cb_t_struc * next_task;
+    struct task_cb_t_struc * next_sleeper;
     } task_cb_t;
 
 typedef uint8_t scheduler_state_t;
@@ -131,6 +494,64 @@ enum
     SCHEDULE_TASKS,     /* Queue up tasks */
 };
 
+/**********************************************************
+ * core_cb_t:
+ *
+ *      Per core control block
+ *
+ *      task_head
+ *
+ *          Task the core is running, NULL when idle.
+ *
+ *      ready_head, ready_tail
+ *
+ *          FIFO of released tasks homed on this core that
+ *          are waiting to be dispatched.
+ *
+ *      state
+ *
+ *          State that the core's scheduler is in.
+ *
+ *      lock
+ *
+ *          Guards everything above, plus the flags of the
+ *          tasks homed on this core. Taken from the ISR, so
+ *          it is held with IRQs masked.
+ *
+ *      steal_count
+ *
+ *          Tasks this core took off other cores' queues.
+ *
+ *      abort_ctx
+ *
+ *          Where an aborted task unwinds to, set right before
+ *          the task is called.
+ *
+ *      abort_armed
+ *
+ *          abort_ctx is valid, i.e., the core is inside the
+ *          task procedure.
+ *
+ *      sched_ctx
+ *
+ *          Where a task with its own stack switches back to
+ *          when it gives up the CPU.
+ *
+ */
+
+typedef struct
+    {
+    task_cb_t        * task_head;
+    task_cb_t        * ready_head;
+    task_cb_t        * ready_tail;
+    scheduler_state_t  state;
+    spinlock_t         lock;
+    uint64_t           steal_count;
+    cpu_jmp_buf_t      abort_ctx;
+    volatile boolean   abort_armed;
+    cpu_ctx_t          sched_ctx;
+    } core_cb_t;
+
 /**********************************************************
  * Control variables:
  *
@@ -144,10 +565,6 @@ enum
  *          scheduler can be turned off if, for example, we need
  *          need to do time critical execution in the kernel.
  * 
- *      scheduler_is_booting
- *
- *          True if scheduler is booting up for the first time.
- * 
  *      sched_timer_id
  *
  *          ID for system timer instance that scheduler runs off of.
@@ -156,39 +573,147 @@ enum
  *
  *          Current system tick. Ticks are incremented every scheduler
  *          task iteration regardless of whether or not the scheduler
- *          is running.
+ *          is running. In tickless mode this is the tick of the last
+ *          scheduler interrupt, use current_us() for the time now.
  *
- *      task_id_count
+ *      tick_base_us
  *
- *          Count of task IDs for all past and present registered tasks.
- *          There is no roll over support for task IDs at this time,
- *          but this is a 32-bit integer.
+ *          System counter at tick 0. Tickless mode works scheduler
+ *          time out from the counter.
  *
- *      scheduler_state
+ *      sched_timer_ready
  *
- *          State that the scheduler is in.
+ *          The scheduler timer has been allocated.
+ *
+ *      free_head
+ *
+ *          Free slots of system_task_list, linked on next_task.
+ *          A killed task's slot goes back on once the scheduler
+ *          holds no more references to it.
  *
  *      registered_tasks
  *
- *          Count of registered tasks
+ *          Count of slots in use, including killed tasks whose
+ *          slot has not been handed back yet.
+ *
+ *      release_heap
+ *
+ *          Binary min-heap of every alive task keyed on its
+ *          next_release_us. The scheduler ISR only ever has to
+ *          look at the root to know whether anything needs
+ *          releasing on the current tick.
+ *
+ *      release_heap_cnt
+ *
+ *          Number of tasks in the release heap
+ *
+ *      release_lock
+ *
+ *          Guards the release heap, task registration and
+ *          next_home_core.
+ *
+ *      core_list
+ *
+ *          Per core run queues, indexed by core id.
+ *
+ *      next_home_core
+ *
+ *          Core the next registered task is homed on. Homes
+ *          are handed out round robin over the task's
+ *          allowed cores.
+ *
+ *      sleep_head
+ *
+ *          Sleeping tasks, sorted on wake_us. Guarded by
+ *          release_lock.
+ *
+ *      stack_pool, stack_pool_used
+ *
+ *          Memory task stacks are carved out of at
+ *          registration. Guarded by release_lock.
+ *
+ *      server_list
+ *
+ *          Server control blocks, handed out at
+ *          registration. Guarded by release_lock.
+ *
+ *      phase_demand
+ *
+ *          Scratch for pick_phase(), budget released on each
+ *          tick of the window. Guarded by release_lock.
+ *
+ *      cyclic_task_ids
+ *
+ *          Handles of the schedule table's tasks, indexed by
+ *          slot.
+ *
+ *      cyclic_frame, cyclic_frame_us
+ *
+ *          Next minor frame of the schedule table and when it
+ *          starts. Guarded by release_lock.
  */
 
 static int sched_init_key;
 static task_cb_t system_task_list[ SSCHED_TSK_MAX_REGISTERED ];
 static boolean is_sched_running;
-static boolean scheduler_is_booting;
 static timer_id_t8 sched_timer_id;
 static uint64_t system_tick;
-static uint32_t task_id_count;
-static scheduler_state_t scheduler_state;
-static task_cb_t * task_head;
+static uint64_t tick_base_us;
+static boolean sched_timer_ready;
+static task_cb_t * free_head;
 static uint32_t registered_tasks;
+static task_cb_t * release_heap[ SSCHED_TSK_MAX_REGISTERED ];
+static uint32_t release_heap_cnt;
+static spinlock_t release_lock;
+static core_cb_t core_list[ SSCHED_CORE_COUNT ];
+static uint32_t next_home_core;
+static task_cb_t * sleep_head;
+static uint8_t stack_pool[ SSCHED_STACK_POOL_SIZE ] __attribute__((aligned(16)));
+static uint32_t stack_pool_used;
+static server_cb_t server_list[ SSCHED_SERVER_MAX ];
+static uint32_t phase_demand[ SSCHED_PHASE_WINDOW ];
+#ifdef SSCHED_CYCLIC
+static sched_task_id_t cyclic_task_ids[ SSCHED_CYCLIC_TASK_CNT ];
+static uint32_t cyclic_frame;
+static uint64_t cyclic_frame_us;
+#endif
 
 /* Forward declares */
 
 static void schedule_isr(void);
-static boolean register_new_task(sched_usr_tsk_t *task);
+static sched_err_t register_new_task(sched_usr_tsk_t *task, boolean server);
+static boolean task_set_schedulable(task_cb_t * cand, uint32_t home);
+static uint64_t pick_phase(task_cb_t * cand, uint64_t first_us);
 static void call_task_proc(task_cb_t * task);
+static void run_coop_task(core_cb_t * core, task_cb_t * task);
+static void run_server(task_cb_t * task);
+static void coop_task_entry(void);
+static sched_err_t coop_suspend(coop_state_t state, uint64_t wake_us);
+static void sleep_list_insert(task_cb_t * task);
+static void sched_core_step(core_cb_t * core);
+static task_cb_t * steal_task(uint32_t thief);
+static void release_heap_push(task_cb_t * task);
+static task_cb_t * release_heap_pop(void);
+static void ready_queue_push(core_cb_t * core, task_cb_t * task);
+static task_cb_t * ready_queue_pop(core_cb_t * core, uint32_t thief);
+static boolean release_task(core_cb_t * core, task_cb_t * task);
+static void handle_overrun(core_cb_t * core, task_cb_t * task);
+static void abort_task_proc(void);
+#ifdef SSCHED_SHOW_DEBUG_DATA
+static void print_task_overrun(void * ctx, uint32_t arg);
+#endif
+static task_cb_t * find_task(sched_task_id_t task_id);
+static void free_slot(task_cb_t * task);
+static boolean take_activation(core_cb_t * home, task_cb_t * task);
+static boolean sleep_list_remove(task_cb_t * task);
+static uint32_t next_generation(uint32_t generation);
+static sched_err_t boost_task(sched_task_id_t task_id, sint32_t delta);
+#ifdef SSCHED_TICKLESS
+static void program_next_wakeup(uint64_t next_us);
+#endif
+#ifdef SSCHED_LOG_TASK_STATS
+static void log_insert_task_cycle_stat_entry(task_cb_t * task, uint64_t start_us, uint64_t end_us);
+#endif
 
 /**********************************************************
  *
@@ -206,9 +731,7 @@ static void call_task_proc(task_cb_t * task);
 
 void sched_main(void)
 {
-#ifdef SSCHED_SHOW_DEBUG_DATA
-    static boolean invalid_state_message_shown = FALSE;
-#endif
+    uint32_t core_id;
 
     /* Ensure scheduler was initialized */
     if(sched_init_key != SCHED_INIT_KEY)
@@ -219,46 +742,157 @@ void sched_main(void)
         #endif
     }
 
+    /* Cores past the configured count have nothing to run */
+    core_id = get_core_id();
+    if(core_id >= SSCHED_CORE_COUNT)
+    {
+        return;
+    }
+
     is_sched_running = FALSE;
 
     while(TRUE)
     {
-        /* Scheduler state machine */
-        switch(scheduler_state)
+        /* Bottom halves of the ISRs, a bounded amount per pass */
+        if(core_id == 0)
         {
-            case INIT:
-                break;
+            defer_run(DEFER_RUN_BUDGET);
+        }
 
-            /* Idle state */
-            case IDLE:
-                break;
+        sched_core_step(&core_list[core_id]);
+    }
+}
 
-            /* Handle task overruns (unused) */
-            case TASK_OVERRUN:
-                break;
+/**********************************************************
+ *
+ *  sched_core_step()
+ *
+ *  DESCRIPTION:
+ *      Run one pass of a core's scheduler state machine.
+ *      An idle core takes the next task off its own ready
+ *      queue, or steals one from another core, and runs it
+ *      to completion, or until it gives up the CPU if it
+ *      has its own stack.
+ *
+ */
 
-            /* Execute a queued task */
-            case EXECUTE_TASK:
-                call_task_proc(task_head);
-                scheduler_state = IDLE;
-                break;
+static void sched_core_step(core_cb_t * core)
+{
+#ifdef SSCHED_SHOW_DEBUG_DATA
+    static boolean invalid_state_message_shown = FALSE;
+#endif
+    uint32_t core_id;
+    irq_flags_t flags;
+    task_cb_t * task;
+
+    core_id = (uint32_t)( core - core_list );
 
-            /* Invalid state. Log a debug message once */
-            default:
-            #ifdef SSCHED_SHOW_DEBUG_DATA
-                if(invalid_state_message_shown == FALSE)
+    /* Scheduler state machine */
+    switch(core->state)
+    {
+        case INIT:
+            break;
+
+        /* Idle state, look for something to run */
+        case IDLE:
+            /* IRQs stay masked until we either have a task or
+             * are parked, so a release can not slip in between */
+            flags = irq_save();
+            spin_lock(&core->lock);
+            task = ready_queue_pop(core, core_id);
+            spin_unlock(&core->lock);
+
+            if( task == NULL )
+            {
+                task = steal_task(core_id);
+            }
+
+            if( task == NULL )
+            {
+                /* Core 0 still has deferred work to get through */
+                if( core_id != 0 || defer_pending() == FALSE )
                 {
-                    printf("\nInvalid scheduler state!");
-                    invalid_state_message_shown = TRUE;
+                    cpu_idle();
                 }
-            #endif
+
+                irq_restore(flags);
                 break;
-        }
-    
+            }
 
-    #ifdef SSCHED_LOG_TASK_STATS
-        ssched_log_insert_task_cycle_stat_entry();// TODO doesn't do anything yet
-    #endif
+            spin_lock(&core->lock);
+            core->task_head = task;
+            core->state = EXECUTE_TASK;
+            spin_unlock(&core->lock);
+            irq_restore(flags);
+
+            /* Run it straight away */
+            /* fall through */
+
+        /* Execute the dispatched task */
+        case EXECUTE_TASK:
+        /* Overrun tasks also get here, the policy is applied by the ISR */
+        case TASK_OVERRUN:
+            /* An aborted task comes back out of cpu_setjmp() a
+             * second time, from abort_task_proc() */
+            if( cpu_setjmp(core->abort_ctx) == 0 )
+            {
+                TRACE(TRACE_TASK_START, TASK_HANDLE(core->task_head));
+                core->abort_armed = TRUE;
+
+                if( core->task_head->server != NULL )
+                {
+                    run_server(core->task_head);
+                }
+                else if( core->task_head->stack != NULL )
+                {
+                    run_coop_task(core, core->task_head);
+                }
+                else
+                {
+                    call_task_proc(core->task_head);
+                }
+            }
+            else
+            {
+                task = core->task_head;
+
+                flags = irq_save();
+                spin_lock(&core_list[task->home_core].lock);
+                core->abort_armed = FALSE;
+
+                /* The task may have finished just as the abort came in */
+                if( task->scheduled == TRUE )
+                {
+                    task->scheduled = FALSE;
+                    task->started = FALSE;
+                    task->cycle_end_us = current_us();
+                    task->overrun_stats.aborts++;
+                }
+
+                spin_unlock(&core_list[task->home_core].lock);
+                irq_restore(flags);
+            }
+
+            TRACE(TRACE_TASK_END, TASK_HANDLE(core->task_head));
+
+            flags = irq_save();
+            spin_lock(&core->lock);
+            core->task_head = NULL;
+            core->state = IDLE;
+            spin_unlock(&core->lock);
+            irq_restore(flags);
+            break;
+
+        /* Invalid state. Log a debug message once */
+        default:
+        #ifdef SSCHED_SHOW_DEBUG_DATA
+            if(invalid_state_message_shown == FALSE)
+            {
+                printf("\nInvalid scheduler state!");
+                invalid_state_message_shown = TRUE;
+            }
+        #endif
+            break;
     }
 }
 
@@ -277,17 +911,36 @@ void sched_main(void)
 sched_err_t sched_init(sched_usr_tsk_t *tasks, uint32_t num_tasks)
 {
     /* local vars */
-    uint8_t i;
+    uint32_t i;
 
     /* initialize the control variables */
     sched_init_key = SCHED_INIT_KEY;
     is_sched_running = FALSE;
-    task_id_count = 0;
     system_tick = 0;
+    tick_base_us = clock_now_us();
+    sched_timer_ready = FALSE;
     registered_tasks = 0;
-    task_head = NULL;
-    scheduler_is_booting = TRUE;
+    release_heap_cnt = 0;
+    next_home_core = 0;
+    sleep_head = NULL;
+    stack_pool_used = 0;
+    spin_lock_init(&release_lock);
     clr_mem(system_task_list, sizeof(system_task_list));
+    clr_mem(core_list, sizeof(core_list));
+    clr_mem(server_list, sizeof(server_list));
+
+    /* Hand slots out from the start of the list */
+    free_head = NULL;
+    for(i = SSCHED_TSK_MAX_REGISTERED; i > 0; i--)
+    {
+        system_task_list[i - 1].next_task = free_head;
+        free_head = &system_task_list[i - 1];
+    }
+
+    for(i = 0; i < SSCHED_CORE_COUNT; i++)
+    {
+        core_list[i].state = IDLE;
+    }
 
     /* make sure uart is initialized so we can debug print */
     if(FALSE == uart_is_init())
@@ -305,21 +958,49 @@ sched_err_t sched_init(sched_usr_tsk_t *tasks, uint32_t num_tasks)
         return SCHED_ERR_PARAM;
     }
 
-    /* Set up initial task list if provided one */
-    for(i = 0; i < num_tasks; i++ )
-    {
-        register_new_task(&tasks[i]);
-    }
-
-    /* allocate a system timer */
-    if( TIMER_ERR_NONE != timer_alloc(&sched_timer_id, schedule_isr, SSCHED_SCHED_TICK_US))
+#ifdef SSCHED_CYCLIC
+    /* The table's slots index the task list it was generated from */
+    if( num_tasks != SSCHED_CYCLIC_TASK_CNT )
     {
         #ifdef SSCHED_SHOW_DEBUG_DATA
-            printf("\nFailed to allocate a system timer. Cannot run scheduler.");
+            printf("\nSchedule table is for %d tasks, given %d", SSCHED_CYCLIC_TASK_CNT, num_tasks);
         #endif
-        return SCHED_ERR_INVLD_STATE;
+
+        return SCHED_ERR_PARAM;
     }
 
+    /* The table starts over on the first tick */
+    cyclic_frame = 0;
+    cyclic_frame_us = SSCHED_SCHED_TICK_US;
+#endif
+
+    /* Set up initial task list if provided one */
+    for(i = 0; i < num_tasks; i++ )
+    {
+    #ifdef SSCHED_CYCLIC
+        /* Zero is never handed out, a slot that failed to
+         * register is never released */
+        cyclic_task_ids[i] = 0;
+        if( register_new_task(&tasks[i], FALSE) == SCHED_ERR_NO_ERR )
+        {
+            cyclic_task_ids[i] = tasks[i].id;
+        }
+    #else
+        register_new_task(&tasks[i], FALSE);
+    #endif
+    }
+
+    /* allocate a system timer */
+    if( TIMER_ERR_NONE != timer_alloc(&sched_timer_id, schedule_isr, SSCHED_SCHED_TICK_US))
+    {
+        #ifdef SSCHED_SHOW_DEBUG_DATA
+            printf("\nFailed to allocate a system timer. Cannot run scheduler.");
+        #endif
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    sched_timer_ready = TRUE;
+
     return SCHED_ERR_NO_ERR;
 }
 
@@ -336,250 +1017,2367 @@ sched_err_t sched_init(sched_usr_tsk_t *tasks, uint32_t num_tasks)
 
 sched_err_t sched_register_task(sched_usr_tsk_t * task)
 {
-    if(register_new_task(task))
+#ifdef SSCHED_CYCLIC
+    /* Periodic tasks only run out of the schedule table */
+    if( NULL != task && SCHED_TASK_PERIOD_US(task) != 0 )
     {
-        return SCHED_ERR_FAILED_REG;
+    #ifdef SSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to register task! Periodic tasks must be in the schedule table");
+    #endif
+        return SCHED_ERR_INVLD_STATE;
     }
-    return SCHED_ERR_NO_ERR;
+#endif
+
+    return register_new_task(task, FALSE);
 }
 
 /**********************************************************
  *
- *  register_new_task()
+ *  sched_register_server()
  *
  *
  *  DESCRIPTION:
- *      Register a new task with the system.
+ *      Contracted function to register a server. A server
+ *      is a task whose releases top up its budget rather
+ *      than run it, it is put on the ready queue whenever
+ *      it has both jobs and budget, see run_server().
  *
  *  NOTES:
- *      At the moment there is no distinction between
- *      user tasks and kernel tasks.
+ *      This is a deferrable server, budget that is not
+ *      used is kept until the end of the period so a job
+ *      arriving late in a period still starts straight
+ *      away. The response time bound of
+ *      task_set_schedulable() still holds, a job of another
+ *      task only ever has one dispatch of the server, of at
+ *      most one budget, in front of it.
  *
  */
 
-static boolean register_new_task(sched_usr_tsk_t * task)
+sched_err_t sched_register_server(sched_usr_tsk_t * task)
 {
-    if(NULL == task || task_id_count > SSCHED_TSK_MAX_REGISTERED || task->task_func == NULL)
+    if( NULL == task || SCHED_TASK_PERIOD_US(task) == 0 || task->budget_us == 0 )
     {
     #ifdef SSCHED_SHOW_DEBUG_DATA
-        printf("\nFailed to register task! task_null=%d, max_tasks=%d, task_func_null=%d", (NULL == task), (task_id_count < SSCHED_TSK_MAX_REGISTERED), (task->task_func == NULL) );
+        printf("\nFailed to register server! A server needs both a period and a budget");
     #endif
-        return FALSE;
+        return SCHED_ERR_PARAM;
     }
 
-    system_task_list[task_id_count].usr_tsk = task;
-    system_task_list[task_id_count].alive = TRUE;
-
-    /* gaurd against init failure */
-    system_task_list[task_id_count].active = FALSE;
-    system_task_list[task_id_count].active_tick = 0;
-    system_task_list[task_id_count].cycle_end_tick = 0;
-    system_task_list[task_id_count].next_task = NULL;
-    system_task_list[task_id_count].scheduled = FALSE;
-
-    /*
-     * At some point in the future the task id should be
-     * calculated using a perfect hashing function.
-     * 
-     * https://github.com/pmgates42/stratOS/issues/1
-     */
-    task->id = task_id_count;
-
-    task_id_count++;
-    registered_tasks++;
-
-    return TRUE;
+    return register_new_task(task, TRUE);
 }
 
 /**********************************************************
  *
- *  schedule_isr()
+ *  register_new_task()
  *
  *
  *  DESCRIPTION:
- *      Scheduler ISR.
+ *      Register a new task with the system.
  *
  *  NOTES:
- *      This function is called every tick of the registered
- *      scheduler timer, i.e., every SSCHED_SCHED_TICK_US
- *      microseconds.
+ *      At the moment there is no distinction between
+ *      user tasks and kernel tasks.
+ *
+ *      A server is registered like any other task, it only
+ *      has a server control block in place of a task
+ *      procedure and stack.
  *
  */
 
-static void schedule_isr(void)
+static sched_err_t register_new_task(sched_usr_tsk_t * task, boolean server)
 {
-    //TODO put this in an inline function
-    #define setup_task_to_run(task_ptr)                 \
-        {                                               \
-            task_head = task_ptr;                       \
-            task_head->active_tick = system_tick;       \
-            task_head->scheduled = TRUE;                \
-                                                        \
-            scheduler_state = EXECUTE_TASK;             \
-        }                                               \
-    
+    irq_flags_t flags;
+    task_cb_t * tcb;
+    server_cb_t * server_cb;
+    uint64_t first_us;
+    uint64_t phase_us;
+    uint32_t affinity;
+    uint32_t stack_size;
+    uint32_t generation;
+    uint32_t home;
     uint32_t i;
 
-    /* Check for system tick roll over */
-    if((system_tick + 1) == 0)
-        // TODO handle system tick roll over
-        printf("System tick roll over detected");
+    if(NULL == task || ( task->task_func == NULL && server == FALSE ))
+    {
+    #ifdef SSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to register task! task_null=%d", (NULL == task) );
+    #endif
+        return SCHED_ERR_FAILED_REG;
+    }
 
-    system_tick ++;
+    /* Zero affinity means any core */
+    affinity = task->core_affinity & SSCHED_CORE_MASK;
+    if(task->core_affinity == 0)
+    {
+        affinity = SSCHED_CORE_MASK;
+    }
 
-    /* Scheduler is booted and current task has finished running */
-    if( (!scheduler_is_booting) && task_head != NULL && task_head->scheduled == FALSE )
+    /* Aborts are taken on the return from the scheduler ISR,
+     * which only runs on core 0 */
+    if(task->overrun_policy == SCHED_OVERRUN_ABORT && server == FALSE)
     {
+        affinity &= BIT(0);
+    }
 
-        /* See if any tasks are ready to run */
-        for(i = 0; i < registered_tasks; i++)
-        {
-            if( system_task_list[i].usr_tsk != NULL
-            &&( system_tick >= ( system_task_list[i].active_tick + system_task_list[i].usr_tsk->period_ms ) ) )
-            {
-                setup_task_to_run( &system_task_list[i] );
-            }
-        }
+#ifdef SSCHED_CYCLIC
+    /* The schedule table is run by the scheduler ISR, its
+     * tasks are dispatched on the same core */
+    if(SCHED_TASK_PERIOD_US(task) != 0 && server == FALSE)
+    {
+        affinity &= BIT(0);
+    }
+#endif
+
+    if(affinity == 0)
+    {
+    #ifdef SSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to register task! core_affinity=0x%x names no scheduler core", task->core_affinity);
+    #endif
+        return SCHED_ERR_FAILED_REG;
     }
 
-    /*  Scheduler was just initialized or at least one task
-     *  is alive after a period of no tasks being alive.
-     *
-     *  This should always be the last condition checked in
-     *  the scheduling algorithm since it will likely occur
-     *  less frequently than other conditions.
-     */
-    else if( scheduler_is_booting == TRUE )
+    /* Stacks are 16 byte aligned and sized, servers run
+     * their jobs on the scheduler's stack */
+    stack_size = ( task->stack_size + 15 ) & ~(uint32_t)15;
+    if(server == TRUE)
     {
-        /* Find the first alive task and execute it */
-        for(i = 0; i < SSCHED_TSK_MAX_REGISTERED; i++)
+        stack_size = 0;
+    }
+
+    flags = irq_save();
+    spin_lock(&release_lock);
+
+    server_cb = NULL;
+    for(i = 0; server == TRUE && i < SSCHED_SERVER_MAX; i++)
+    {
+        if( server_list[i].in_use == FALSE )
         {
-            if( system_task_list[ i ].alive == TRUE )
-                {
-                    setup_task_to_run( &system_task_list[i] );
-                    scheduler_is_booting = FALSE;
-                    break;             
-                }
+            server_cb = &server_list[i];
+            break;
         }
     }
 
-    /* Handle time based events */
+    if( free_head == NULL || stack_size > SSCHED_STACK_POOL_SIZE - stack_pool_used
+     || ( server == TRUE && server_cb == NULL ) )
+    {
+        spin_unlock(&release_lock);
+        irq_restore(flags);
+
+    #ifdef SSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to register task! max_tasks=%d, max_servers=%d, stack_size=%d, only %d bytes of stack left", (free_head == NULL), ( server == TRUE && server_cb == NULL ), task->stack_size, SSCHED_STACK_POOL_SIZE - stack_pool_used);
+    #endif
+        return SCHED_ERR_FAILED_REG;
+    }
 
-    switch(scheduler_state)
+    /* Take a free slot, keeping only its generation */
+    tcb = free_head;
+    free_head = tcb->next_task;
+
+    generation = tcb->generation;
+    clr_mem(tcb, sizeof(task_cb_t));
+    tcb->generation = generation;
+    if( tcb->generation == 0 )
     {
-        /* EXECUTING A TASK */
-        case EXECUTE_TASK:
-        {
-        #define DETECT_OVERRUN(tsk) ( ( ( system_tick - tsk->active_tick ) * MS_PER_TICKS ) > tsk->usr_tsk->period_ms )
+        tcb->generation = 1;
+    }
 
-            /* check for task overrun */
-            if( DETECT_OVERRUN(task_head) )
-            {
-            scheduler_state = TASK_OVERRUN;
+    tcb->started = FALSE;
+    tcb->coop_state = COOP_RUNNING;
+    tcb->next_sleeper = NULL;
 
-            //TODO $task_stats: collect overrun data here
+    tcb->usr_tsk = task;
+    tcb->alive = TRUE;
 
-        #ifdef SSCHED_SHOW_DEBUG_DATA
-            printf("\nTask overrun has occured on task with id=%d. Consider lengthening period_ms on task registration.", task_head->usr_tsk->id);
-        #endif
-            }
-        #undef DETECT_OVERRUN
-        }
-        break;
+    /* gaurd against init failure */
+    tcb->periodic = ( SCHED_TASK_PERIOD_US(task) != 0 );
+    tcb->active = tcb->periodic;
+    tcb->activate_pending = FALSE;
+    tcb->active_us = 0;
+    tcb->cycle_end_us = 0;
+    tcb->next_task = NULL;
+    tcb->scheduled = FALSE;
+    tcb->queued = FALSE;
+    tcb->skip_release = FALSE;
+    tcb->overrun_policy = task->overrun_policy;
+    if(server == TRUE)
+    {
+        tcb->overrun_policy = SCHED_OVERRUN_NONE;
+    }
+    tcb->affinity = affinity;
+    clr_mem(&tcb->overrun_stats, sizeof(tcb->overrun_stats));
 
-        /* EXECUTING TASK HAS OVERRUN CYCLE */
-        case TASK_OVERRUN:
-        {
-            // TODO wait a little longer and see if task finishes executing
-            // TODO if crosses threshold then kill this task
+    tcb->period_us = SCHED_TASK_PERIOD_US(task);
+    if(tcb->periodic == FALSE)
+    {
+        tcb->period_us = EVENT_TASK_SWEEP_US;
+    }
+
+    /* Budget defaults to the period */
+    tcb->budget_us = task->budget_us;
+    if(task->budget_us == 0)
+    {
+        tcb->budget_us = tcb->period_us;
+    }
+
+    tcb->degraded_period_us = (uint64_t)task->degraded_period_ms * US_PER_MS;
+    if(task->degraded_period_ms == 0)
+    {
+        tcb->degraded_period_us = 2 * tcb->period_us;
+    }
+
+#ifdef SSCHED_CYCLIC
+    /* Released by the schedule table, the release heap only
+     * sweeps it. The table was checked when it was generated
+     * so the task is left out of admission */
+    if(tcb->periodic == TRUE && server == FALSE)
+    {
+        tcb->periodic = FALSE;
+        tcb->active = FALSE;
+        tcb->period_us = EVENT_TASK_SWEEP_US;
+    }
+#endif
+
+    /* Home the task on the next allowed core, round robin,
+     * skipping cores it would make miss deadlines */
+    for(i = 0; i < SSCHED_CORE_COUNT; i++)
+    {
+        home = ( next_home_core + i ) % SSCHED_CORE_COUNT;
 
+        if( ( affinity & BIT(home) ) && task_set_schedulable(tcb, home) )
+        {
+            break;
         }
-        break;
     }
+
+    if( i == SSCHED_CORE_COUNT )
+    {
+        /* Hand the slot back untouched, its handle was never given out */
+        tcb->alive = FALSE;
+        tcb->next_task = free_head;
+        free_head = tcb;
+
+        spin_unlock(&release_lock);
+        irq_restore(flags);
+
+    #ifdef SSCHED_SHOW_DEBUG_DATA
+        printf("\nFailed to register task! budget_us=%d does not fit on any core it may run on", task->budget_us);
+    #endif
+        return SCHED_ERR_UNSCHEDULABLE;
+    }
+
+    tcb->home_core = home;
+    next_home_core = ( home + 1 ) % SSCHED_CORE_COUNT;
+
+    tcb->stack = NULL;
+    tcb->stack_size = stack_size;
+    if( stack_size > 0 )
+    {
+        tcb->stack = &stack_pool[stack_pool_used];
+        stack_pool_used += stack_size;
+        *(uint32_t *)tcb->stack = STACK_CANARY;
+    }
+
+    /* Servers start out with a full budget and no jobs */
+    tcb->server = server_cb;
+    if( server_cb != NULL )
+    {
+        spsc_ring_init(&server_cb->queue, server_cb->jobs, SSCHED_SERVER_QUEUE_LEN);
+        server_cb->capacity_us = task->budget_us;
+        server_cb->in_use = TRUE;
+    }
+
+    /* First release happens on the next scheduler tick,
+     * pushed back by the task's phase */
+    first_us = ( current_tick() + 1 ) * SSCHED_SCHED_TICK_US;
+    phase_us = task->phase_us;
+    if( phase_us == SCHED_PHASE_AUTO )
+    {
+        phase_us = ( tcb->periodic == TRUE ) ? pick_phase(tcb, first_us) : 0;
+    }
+
+    tcb->next_release_us = first_us + phase_us;
+    release_heap_push(tcb);
+
+#ifdef SSCHED_TICKLESS
+    /* The timer may be asleep until long after that */
+    if(sched_timer_ready)
+    {
+        program_next_wakeup(tcb->next_release_us);
+    }
+#endif
+
+    task->id = TASK_HANDLE(tcb);
+    registered_tasks++;
+
+    spin_unlock(&release_lock);
+    irq_restore(flags);
+
+    return SCHED_ERR_NO_ERR;
 }
 
 /**********************************************************
  *
- *  call_task_proc()
+ *  task_set_schedulable()
  *
  *
  *  DESCRIPTION:
- *      Call the task procedure and update control vars.
+ *      Schedulability test of the registered tasks plus
+ *      cand homed on core home. Run per core over the
+ *      tasks that declare a budget, C, with periods, T,
+ *      in microseconds.
+ *
+ *      Utilization bound
+ *          sum( C / T ) <= 1 over the tasks homed on the
+ *          core.
+ *
+ *      Event driven tasks are left out, nothing bounds
+ *      how often they are activated.
+ *
+ *      Response time
+ *          A core runs its ready queue first in first out
+ *          without preemption, and a task has at most one
+ *          job waiting or running at a time. A job is
+ *          therefore only ever queued behind one job of
+ *          each other task homed on the core, plus one job
+ *          the core stole while it was idle. Its response
+ *          time is bounded by
+ *
+ *              R = B + sum( C )
+ *
+ *          over the tasks homed on the core, B being the
+ *          largest budget of any task homed elsewhere that
+ *          may run here. Every task needs R <= T.
+ *
+ *  NOTES:
+ *      Caller holds release_lock. Costs O(cores * tasks),
+ *      registration is not a hot path.
  *
  */
 
-static void call_task_proc(task_cb_t * task)
+static boolean task_set_schedulable(task_cb_t * cand, uint32_t home)
 {
-    if( task != NULL && task->usr_tsk->task_func )
-    { 
-    #ifdef SSCHED_SHOW_DEBUG_DATA
-        if(task->scheduled == FALSE)
-            printf("Invalid state! Only scheduled tasks should be executed!");
-    #endif
+    task_cb_t * task;
+    uint64_t budget_us;
+    uint64_t period_us;
+    uint64_t block_us;
+    uint64_t sum_us;
+    uint64_t util;
+    uint32_t task_home;
+    uint32_t core;
+    uint32_t i;
 
-        task->usr_tsk->task_func();//TODO pass in flags
-    }
-    /* Theoritially should never execute */
-    else
+    for(core = 0; core < SSCHED_CORE_COUNT; core++)
     {
-    #ifdef SSCHED_SHOW_DEBUG_DATA
-        printf("Tried to execute NULL task or task with missing task_func!");
-    #endif
+        block_us = 0;
+        sum_us = 0;
+        util = 0;
+
+        for(i = 0; i < SSCHED_TSK_MAX_REGISTERED; i++)
+        {
+            task = &system_task_list[i];
+            budget_us = ( task->alive == TRUE && task->periodic == TRUE ) ? task->usr_tsk->budget_us : 0;
+            if( budget_us == 0 )
+            {
+                continue;
+            }
+
+            task_home = ( task == cand ) ? home : task->home_core;
+            period_us = task->period_us;
+
+            if( task_home == core )
+            {
+                sum_us += budget_us;
+
+                /* 16.16 fixed point, rounded up */
+                util += ( ( budget_us << 16 ) + period_us - 1 ) / period_us;
+            }
+            else if( ( task->affinity & BIT(core) ) && budget_us > block_us )
+            {
+                block_us = budget_us;
+            }
+        }
+
+        if( util > ( 1 << 16 ) )
+        {
+            return FALSE;
+        }
+
+        for(i = 0; i < SSCHED_TSK_MAX_REGISTERED; i++)
+        {
+            task = &system_task_list[i];
+            if( task->alive == FALSE || task->periodic == FALSE || task->usr_tsk->budget_us == 0 )
+            {
+                continue;
+            }
+
+            task_home = ( task == cand ) ? home : task->home_core;
+            period_us = task->period_us;
+
+            if( task_home == core && block_us + sum_us > period_us )
+            {
+                return FALSE;
+            }
+        }
     }
 
-    /* Task has finished running */
-    task->scheduled = FALSE;
-    task->cycle_end_tick = system_tick;
+    return TRUE;
 }
 
-
 /**********************************************************
  *
- *  sched_kill_task()
+ *  pick_phase()
  *
  *
  *  DESCRIPTION:
- *      Contracted scheduler function.
+ *      Phase for a SCHED_PHASE_AUTO task first released at
+ *      first_us, in whole ticks.
  *
- *      Kill a task and update any control list it lives
- *      in. Return true if we can find the task in a list
- *      and false otherwise.
+ *      Every other periodic task's releases are laid out
+ *      over a window of ticks from first_us, each counting
+ *      its budget, or one if it has none. The phase picked
+ *      is the one whose busiest release tick has the least
+ *      work on it, the earliest on a tie.
+ *
+ *  NOTES:
+ *      Caller holds release_lock. Costs O(tasks * window),
+ *      the window being the hyperperiod in ticks capped at
+ *      SSCHED_PHASE_WINDOW.
+ *
+ *      A period that is not a whole number of ticks is
+ *      rounded up, the releases drift out of the window's
+ *      ticks but the phase is only a heuristic.
  *
  */
 
-sched_err_t sched_kill_task(sched_task_id_t task_id)
+static uint64_t pick_phase(task_cb_t * cand, uint64_t first_us)
 {
-    uint8_t index;
+    task_cb_t * task;
+    uint64_t window;
+    uint64_t period;
+    uint64_t a;
+    uint64_t b;
+    uint64_t t;
+    uint64_t phase;
+    uint64_t peak;
+    uint64_t best_phase;
+    uint64_t best_peak;
+    sint64_t delta;
+    uint32_t i;
+
+    /* Hyperperiod in ticks, as far as the window goes */
+    window = US_TO_TICKS_CEIL(cand->period_us);
+    for(i = 0; i < SSCHED_TSK_MAX_REGISTERED && window < SSCHED_PHASE_WINDOW; i++)
+    {
+        task = &system_task_list[i];
+        if( task->alive == FALSE || task->periodic == FALSE || task == cand )
+        {
+            continue;
+        }
+
+        a = window;
+        b = US_TO_TICKS_CEIL(task->period_us);
+        while( b != 0 )
+        {
+            t = a % b;
+            a = b;
+            b = t;
+        }
+
+        window = ( window / a ) * US_TO_TICKS_CEIL(task->period_us);
+    }
+
+    if( window > SSCHED_PHASE_WINDOW )
+    {
+        window = SSCHED_PHASE_WINDOW;
+    }
+
+    clr_mem(phase_demand, (uint32_t)window * sizeof(phase_demand[0]));
+
+    for(i = 0; i < SSCHED_TSK_MAX_REGISTERED; i++)
+    {
+        task = &system_task_list[i];
+        if( task->alive == FALSE || task->periodic == FALSE || task == cand )
+        {
+            continue;
+        }
+
+        /* Tick of the task's first release in the window */
+        period = US_TO_TICKS_CEIL(task->period_us);
+        delta = (sint64_t)( task->next_release_us - first_us ) / SSCHED_SCHED_TICK_US;
+        t = (uint64_t)( ( delta % (sint64_t)period ) + (sint64_t)period ) % period;
+
+        for(; t < window; t += period)
+        {
+            phase_demand[t] += ( task->usr_tsk->budget_us != 0 ) ? task->usr_tsk->budget_us : 1;
+        }
+    }
+
+    period = US_TO_TICKS_CEIL(cand->period_us);
+    best_phase = 0;
+    best_peak = (uint64_t)-1;
 
-    /* Find the task in the active system task list
-    and update it.
-    */
-   for(index = 0; index < SSCHED_TSK_MAX; index++)
-   {
-        if(system_task_list[index].usr_tsk->id == task_id)
+    for(phase = 0; phase < period && phase < window; phase++)
+    {
+        peak = 0;
+        for(t = phase; t < window; t += period)
         {
-            system_task_list[index].active = FALSE;
-            system_task_list[index].alive = FALSE;
+            if( phase_demand[t] > peak )
+            {
+                peak = phase_demand[t];
+            }
+        }
 
-            return SCHED_ERR_NO_ERR;
+        if( peak < best_peak )
+        {
+            best_peak = peak;
+            best_phase = phase;
         }
-   }
+    }
 
-    return SCHED_ERR_FAILED_UPDATE;
+    return best_phase * SSCHED_SCHED_TICK_US;
 }
 
 /**********************************************************
  *
- *  sched_activate_task()
+ *  schedule_isr()
  *
  *
  *  DESCRIPTION:
- *      Contracted scheduler function.
+ *      Scheduler ISR.
+ *
+ *  NOTES:
+ *      This function is called every tick of the registered
+ *      scheduler timer, i.e., every SSCHED_SCHED_TICK_US
+ *      microseconds.
+ *
+ *      Releases come off the root of the release heap, so a
+ *      tick where nothing is due costs a single compare no
+ *      matter how many tasks are registered. Each release
+ *      costs O(log n) to put the task back into the heap.
+ *
+ *      In tickless mode the ISR instead runs when the next
+ *      release or wake up is due, or a running task would
+ *      overrun, and catches system_tick up from the system
+ *      counter.
+ *
+ *      Every time is kept in microseconds, the tick only
+ *      sets how often they are looked at. A release that
+ *      falls between two ticks goes out on the later one.
  *
  */
 
-sched_err_t sched_activate_task(sched_task_id_t task_id)
+static void schedule_isr(void)
 {
-    (void)task_id;
-    return SCHED_ERR_FAILED_UPDATE;
-}
\ No newline at end of file
+    task_cb_t * task;
+    core_cb_t * core;
+    uint64_t now_us;
+    uint64_t missed;
+    uint32_t i;
+    boolean released;
+#ifdef SSCHED_TICKLESS
+    uint64_t next_us;
+#endif
+#ifdef SSCHED_CYCLIC
+    const ssched_cyclic_frame_t * frame;
+#endif
+
+#ifdef SSCHED_TICKLESS
+    now_us = current_us();
+    system_tick = now_us / SSCHED_SCHED_TICK_US;
+    next_us = now_us + SSCHED_TICKLESS_MAX_SLEEP_US;
+#else
+    system_tick ++;
+    now_us = current_us();
+#endif
+
+    released = FALSE;
+
+    spin_lock(&release_lock);
+
+    /* Release every task that is due by now */
+    while( release_heap_cnt > 0 && TIME_BEFORE_EQ(release_heap[0]->next_release_us, now_us) )
+    {
+        task = release_heap_pop();
+        core = &core_list[task->home_core];
+
+        spin_lock(&core->lock);
+
+        /* Killed tasks are dropped from the heap lazily. The
+         * slot is handed back once the task is off the ready
+         * queue and done running, until then it is looked at
+         * again every tick */
+        if( task->alive == FALSE )
+        {
+            if( task->queued == FALSE && task->scheduled == FALSE && task->started == FALSE )
+            {
+                spin_unlock(&core->lock);
+                free_slot(task);
+                continue;
+            }
+
+            spin_unlock(&core->lock);
+            task->next_release_us = now_us + SSCHED_SCHED_TICK_US;
+            release_heap_push(task);
+            continue;
+        }
+
+        /* Event driven tasks are only kept in the heap so a
+         * killed one still gets its slot back */
+        if( task->periodic == FALSE )
+        {
+            spin_unlock(&core->lock);
+            task->next_release_us += task->period_us;
+            release_heap_push(task);
+            continue;
+        }
+
+        /* A server's release only tops up its budget, it is
+         * queued if jobs were left waiting on it */
+        if( task->server != NULL )
+        {
+            task->server->capacity_us = task->usr_tsk->budget_us;
+
+            if( task->queued == FALSE && task->scheduled == FALSE
+             && spsc_ring_is_empty(&task->server->queue) == FALSE )
+            {
+                ready_queue_push(core, task);
+                released = TRUE;
+
+            #ifdef SSCHED_LOG_TASK_STATS
+                task->release_us = clock_now_us();
+            #endif
+            }
+        }
+        else if( release_task(core, task) )
+        {
+            released = TRUE;
+        }
+
+        task->next_release_us += task->period_us;
+
+        /* A period shorter than the tick has had more than
+         * one release come due since the last tick, only the
+         * first goes out */
+        if( TIME_BEFORE_EQ(task->next_release_us, now_us) )
+        {
+            missed = ( ( now_us - task->next_release_us ) / task->period_us ) + 1;
+            task->next_release_us += missed * task->period_us;
+
+        #ifdef SSCHED_LOG_TASK_STATS
+            task->stats.missed_releases += missed;
+        #endif
+        }
+
+        spin_unlock(&core->lock);
+
+        release_heap_push(task);
+    }
+
+    /* Wake the sleepers that are due, they pick up where
+     * they left off */
+    while( sleep_head != NULL && TIME_BEFORE_EQ(sleep_head->wake_us, now_us) )
+    {
+        task = sleep_head;
+        sleep_head = task->next_sleeper;
+        task->next_sleeper = NULL;
+        core = &core_list[task->home_core];
+
+        spin_lock(&core->lock);
+
+        if( task->alive == TRUE )
+        {
+            ready_queue_push(core, task);
+            released = TRUE;
+        }
+        else
+        {
+            task->started = FALSE;
+        }
+
+        spin_unlock(&core->lock);
+    }
+
+#ifdef SSCHED_CYCLIC
+    /* Release the minor frame that starts now, in the order
+     * the table lists it */
+    if( TIME_BEFORE_EQ(cyclic_frame_us, now_us) )
+    {
+        frame = &ssched_cyclic_frames[cyclic_frame];
+
+        for(i = frame->first; i < (uint32_t)frame->first + frame->count; i++)
+        {
+            task = find_task(cyclic_task_ids[ssched_cyclic_slots[i]]);
+            if( task == NULL )
+            {
+                continue;
+            }
+
+            core = &core_list[task->home_core];
+            spin_lock(&core->lock);
+
+            if( release_task(core, task) )
+            {
+                released = TRUE;
+            }
+
+            spin_unlock(&core->lock);
+        }
+
+        cyclic_frame = ( cyclic_frame + 1 ) % SSCHED_CYCLIC_FRAME_CNT;
+        cyclic_frame_us += SSCHED_CYCLIC_MINOR_US;
+    }
+#endif
+
+    spin_unlock(&release_lock);
+
+    /* Get idle cores looking at their queues */
+    if( released )
+    {
+        cpu_wake_cores();
+    }
+
+    /* Handle time based events */
+
+    for(i = 0; i < SSCHED_CORE_COUNT; i++)
+    {
+        core = &core_list[i];
+        spin_lock(&core->lock);
+
+        switch(core->state)
+        {
+            /* EXECUTING A TASK */
+            case EXECUTE_TASK:
+            {
+            #define DETECT_OVERRUN(tsk) ( ( now_us - tsk->active_us ) > tsk->budget_us )
+
+                /* check for task overrun */
+                if( DETECT_OVERRUN(core->task_head) )
+                {
+                    core->state = TASK_OVERRUN;
+                    handle_overrun(core, core->task_head);
+                }
+            #undef DETECT_OVERRUN
+
+            #ifdef SSCHED_TICKLESS
+                /* Wake up in time to catch this task overrunning */
+                if( core->state == EXECUTE_TASK
+                 && TIME_BEFORE(core->task_head->active_us + core->task_head->budget_us + 1, next_us) )
+                {
+                    next_us = core->task_head->active_us + core->task_head->budget_us + 1;
+                }
+            #endif
+            }
+            break;
+
+            /* EXECUTING TASK HAS OVERRUN CYCLE */
+            case TASK_OVERRUN:
+            {
+                /* handle_overrun() applied the policy once on the
+                 * way in. The job is left to finish, or to unwind
+                 * under SCHED_OVERRUN_ABORT, and sched_core_step()
+                 * takes the core back to IDLE either way */
+            }
+            break;
+        }
+
+        spin_unlock(&core->lock);
+    }
+
+#ifdef SSCHED_TICKLESS
+    spin_lock(&release_lock);
+    program_next_wakeup(next_us);
+    spin_unlock(&release_lock);
+#endif
+}
+
+/**********************************************************
+ *
+ *  release_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Put a task that is due onto its home core's ready
+ *      queue. Returns TRUE if it was queued.
+ *
+ *  NOTES:
+ *      Caller holds the home core's lock.
+ *
+ */
+
+static boolean release_task(core_cb_t * core, task_cb_t * task)
+{
+    /* An overrun under SCHED_OVERRUN_SKIP gives up the
+     * release after it */
+    if( task->skip_release == TRUE )
+    {
+        task->skip_release = FALSE;
+        task->overrun_stats.skipped_releases++;
+        return FALSE;
+    }
+
+    /* A task that is still waiting or running from its
+     * last release just misses this one */
+    if( task->queued == TRUE || task->scheduled == TRUE || task->started == TRUE )
+    {
+    #ifdef SSCHED_LOG_TASK_STATS
+        task->stats.missed_releases++;
+    #endif
+        return FALSE;
+    }
+
+    ready_queue_push(core, task);
+
+#ifdef SSCHED_LOG_TASK_STATS
+    task->release_us = clock_now_us();
+#endif
+
+    return TRUE;
+}
+
+/**********************************************************
+ *
+ *  handle_overrun()
+ *
+ *
+ *  DESCRIPTION:
+ *      Apply a task's overrun policy once it has run past
+ *      its budget. Called once per overrun, from the ISR.
+ *
+ *      SCHED_OVERRUN_NONE
+ *          The task runs on.
+ *
+ *      SCHED_OVERRUN_SKIP
+ *          The task runs on and its next release is dropped
+ *          so it can not back up behind itself.
+ *
+ *      SCHED_OVERRUN_ABORT
+ *          The task is unwound back into sched_core_step()
+ *          on the return from this interrupt.
+ *
+ *      SCHED_OVERRUN_DEGRADE
+ *          The task runs on and moves to its degraded period
+ *          from its next release on, for good.
+ *
+ *  NOTES:
+ *      Caller holds the core's lock, which is also the
+ *      task's home core lock since the task is running
+ *      there or was homed there.
+ *
+ */
+
+static void handle_overrun(core_cb_t * core, task_cb_t * task)
+{
+    TRACE(TRACE_TASK_OVERRUN, TASK_HANDLE(task));
+
+    task->overrun_stats.overruns++;
+
+#ifdef SSCHED_LOG_TASK_STATS
+    task->stats.overruns++;
+#endif
+
+    switch(task->overrun_policy)
+    {
+        case SCHED_OVERRUN_SKIP:
+            task->skip_release = TRUE;
+            break;
+
+        case SCHED_OVERRUN_ABORT:
+            /* Only core 0 takes this interrupt. Past the
+             * arm the core is inside the task procedure */
+            if( core == &core_list[0] && core->abort_armed == TRUE )
+            {
+                irq_set_return(abort_task_proc);
+            }
+            break;
+
+        case SCHED_OVERRUN_DEGRADE:
+            if( task->period_us != task->degraded_period_us )
+            {
+                task->period_us = task->degraded_period_us;
+                if( task->usr_tsk->budget_us == 0 )
+                {
+                    task->budget_us = task->period_us;
+                }
+
+                task->overrun_stats.degrades++;
+            }
+            break;
+
+        default:
+        #ifdef SSCHED_SHOW_DEBUG_DATA
+            defer_work(print_task_overrun, NULL, task->usr_tsk->id);
+        #endif
+            break;
+    }
+}
+
+#ifdef SSCHED_SHOW_DEBUG_DATA
+/**********************************************************
+ *
+ *  print_task_overrun()
+ *
+ *
+ *  DESCRIPTION:
+ *      Deferred from the ISR, report an overrun of the task
+ *      with id arg.
+ *
+ */
+
+static void print_task_overrun(void * ctx, uint32_t arg)
+{
+    (void)ctx;
+
+    printf("\nTask overrun has occured on task with id=%d. Consider lengthening period_ms on task registration.", arg);
+}
+#endif
+
+/**********************************************************
+ *
+ *  abort_task_proc()
+ *
+ *
+ *  DESCRIPTION:
+ *      Where an aborted task resumes once the scheduler
+ *      ISR returns. Unwinds out of the task procedure back
+ *      into sched_core_step().
+ *
+ *  NOTES:
+ *      The simulator delivers this asynchronously, so the
+ *      task may have finished by the time it runs. Nothing
+ *      is unwound then.
+ *
+ */
+
+static void abort_task_proc(void)
+{
+    core_cb_t * core;
+
+    core = &core_list[get_core_id()];
+
+    if( core->abort_armed == TRUE )
+    {
+        cpu_longjmp(core->abort_ctx, 1);
+    }
+}
+
+#ifdef SSCHED_TICKLESS
+/**********************************************************
+ *
+ *  program_next_wakeup()
+ *
+ *
+ *  DESCRIPTION:
+ *      Set the scheduler timer to fire on the earliest of
+ *      next_us, the next release, the next wake up and the
+ *      next minor frame.
+ *
+ *  NOTES:
+ *      Caller holds release_lock.
+ *
+ */
+
+static void program_next_wakeup(uint64_t next_us)
+{
+    uint64_t now_us;
+    sint64_t delay_us;
+
+    if( release_heap_cnt > 0 && TIME_BEFORE(release_heap[0]->next_release_us, next_us) )
+    {
+        next_us = release_heap[0]->next_release_us;
+    }
+
+    if( sleep_head != NULL && TIME_BEFORE(sleep_head->wake_us, next_us) )
+    {
+        next_us = sleep_head->wake_us;
+    }
+
+#ifdef SSCHED_CYCLIC
+    if( TIME_BEFORE(cyclic_frame_us, next_us) )
+    {
+        next_us = cyclic_frame_us;
+    }
+#endif
+
+    now_us = current_us();
+    delay_us = (sint64_t)( next_us - now_us );
+
+    if( delay_us <= 0 )
+    {
+        delay_us = 1;
+    }
+    else if( delay_us > SSCHED_TICKLESS_MAX_SLEEP_US )
+    {
+        delay_us = SSCHED_TICKLESS_MAX_SLEEP_US;
+    }
+
+    timer_set_next(sched_timer_id, (uint32_t)delay_us);
+}
+#endif
+
+/**********************************************************
+ *
+ *  release_heap_push()
+ *
+ *
+ *  DESCRIPTION:
+ *      Insert a task into the release heap, keyed on its
+ *      next_release_us.
+ *
+ */
+
+static void release_heap_push(task_cb_t * task)
+{
+    uint32_t child;
+    uint32_t parent;
+
+    if( release_heap_cnt >= SSCHED_TSK_MAX_REGISTERED )
+    {
+        return;
+    }
+
+    /* Sift the new entry up until its parent releases earlier */
+    child = release_heap_cnt++;
+    while( child > 0 )
+    {
+        parent = ( child - 1 ) / 2;
+        if( TIME_BEFORE_EQ(release_heap[parent]->next_release_us, task->next_release_us) )
+        {
+            break;
+        }
+
+        release_heap[child] = release_heap[parent];
+        child = parent;
+    }
+
+    release_heap[child] = task;
+}
+
+/**********************************************************
+ *
+ *  release_heap_pop()
+ *
+ *
+ *  DESCRIPTION:
+ *      Remove and return the task with the earliest
+ *      next_release_us, or NULL if the heap is empty.
+ *
+ */
+
+static task_cb_t * release_heap_pop(void)
+{
+    task_cb_t * root;
+    task_cb_t * last;
+    uint32_t parent;
+    uint32_t child;
+
+    if( release_heap_cnt == 0 )
+    {
+        return NULL;
+    }
+
+    root = release_heap[0];
+    last = release_heap[--release_heap_cnt];
+
+    /* Sift the last entry down from the root */
+    parent = 0;
+    child = 1;
+    while( child < release_heap_cnt )
+    {
+        /* Pick the earlier releasing child */
+        if( ( child + 1 ) < release_heap_cnt
+         && TIME_BEFORE(release_heap[child + 1]->next_release_us, release_heap[child]->next_release_us) )
+        {
+            child++;
+        }
+
+        if( TIME_BEFORE_EQ(last->next_release_us, release_heap[child]->next_release_us) )
+        {
+            break;
+        }
+
+        release_heap[parent] = release_heap[child];
+        parent = child;
+        child = ( 2 * parent ) + 1;
+    }
+
+    release_heap[parent] = last;
+
+    return root;
+}
+
+/**********************************************************
+ *
+ *  ready_queue_push()
+ *
+ *
+ *  DESCRIPTION:
+ *      Append a released task to the tail of a core's
+ *      ready queue, or put it at the head if it is
+ *      boosted.
+ *
+ *  NOTES:
+ *      Caller holds the core's lock.
+ *
+ */
+
+static void ready_queue_push(core_cb_t * core, task_cb_t * task)
+{
+    TRACE(TRACE_TASK_RELEASE, TASK_HANDLE(task));
+
+    task->queued = TRUE;
+    task->next_task = NULL;
+
+    if( task->boost > 0 && core->ready_head != NULL )
+    {
+        task->next_task = core->ready_head;
+        core->ready_head = task;
+        return;
+    }
+
+    if( core->ready_tail == NULL )
+    {
+        core->ready_head = task;
+    }
+    else
+    {
+        core->ready_tail->next_task = task;
+    }
+
+    core->ready_tail = task;
+}
+
+/**********************************************************
+ *
+ *  ready_queue_pop()
+ *
+ *
+ *  DESCRIPTION:
+ *      Take the first alive task that may run on core
+ *      thief off a core's ready queue and mark it
+ *      scheduled, or return NULL if there is none.
+ *
+ *  NOTES:
+ *      Caller holds the core's lock. Dead tasks found on
+ *      the way are dropped from the queue.
+ *
+ */
+
+static task_cb_t * ready_queue_pop(core_cb_t * core, uint32_t thief)
+{
+    task_cb_t * prev;
+    task_cb_t * task;
+    task_cb_t * next;
+
+    prev = NULL;
+    task = core->ready_head;
+
+    while( task != NULL )
+    {
+        next = task->next_task;
+
+        if( task->alive == FALSE || ( task->affinity & BIT(thief) ) )
+        {
+            /* Unlink the task */
+            if( prev == NULL )
+            {
+                core->ready_head = next;
+            }
+            else
+            {
+                prev->next_task = next;
+            }
+
+            if( core->ready_tail == task )
+            {
+                core->ready_tail = prev;
+            }
+
+            task->queued = FALSE;
+            task->next_task = NULL;
+
+            if( task->alive == TRUE )
+            {
+                task->scheduled = TRUE;
+                task->active_us = current_us();
+                return task;
+            }
+
+            /* A yielded task that was killed never resumes */
+            task->started = FALSE;
+        }
+        else
+        {
+            prev = task;
+        }
+
+        task = next;
+    }
+
+    return NULL;
+}
+
+/**********************************************************
+ *
+ *  steal_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Take a ready task that may run on core thief off
+ *      another core's ready queue. Returns NULL if no
+ *      other core has one.
+ *
+ *  NOTES:
+ *      Victims are tried starting from the core after
+ *      the thief so the cores do not all gang up on
+ *      core 0.
+ *
+ */
+
+static task_cb_t * steal_task(uint32_t thief)
+{
+    irq_flags_t flags;
+    core_cb_t * victim;
+    task_cb_t * task;
+    uint32_t i;
+
+    for(i = 1; i < SSCHED_CORE_COUNT; i++)
+    {
+        victim = &core_list[( thief + i ) % SSCHED_CORE_COUNT];
+
+        flags = irq_save();
+        spin_lock(&victim->lock);
+        task = ready_queue_pop(victim, thief);
+        spin_unlock(&victim->lock);
+        irq_restore(flags);
+
+        if( task != NULL )
+        {
+            core_list[thief].steal_count++;
+            return task;
+        }
+    }
+
+    return NULL;
+}
+
+/**********************************************************
+ *
+ *  call_task_proc()
+ *
+ *
+ *  DESCRIPTION:
+ *      Call the task procedure and update control vars.
+ *
+ */
+
+static void call_task_proc(task_cb_t * task)
+{
+    irq_flags_t flags;
+#ifdef SSCHED_LOG_TASK_STATS
+    uint64_t start_us;
+    uint64_t end_us;
+
+    start_us = clock_now_us();
+#endif
+
+    if( task != NULL && task->usr_tsk->task_func )
+    { 
+    #ifdef SSCHED_SHOW_DEBUG_DATA
+        if(task->scheduled == FALSE)
+            printf("Invalid state! Only scheduled tasks should be executed!");
+    #endif
+
+        task->usr_tsk->task_func();//TODO pass in flags
+    }
+    /* Theoritially should never execute */
+    else
+    {
+    #ifdef SSCHED_SHOW_DEBUG_DATA
+        printf("Tried to execute NULL task or task with missing task_func!");
+    #endif
+    }
+
+#ifdef SSCHED_LOG_TASK_STATS
+    end_us = clock_now_us();
+#endif
+
+    /* Task has finished running */
+    flags = irq_save();
+    spin_lock(&core_list[task->home_core].lock);
+    core_list[get_core_id()].abort_armed = FALSE;
+    task->scheduled = FALSE;
+    task->cycle_end_us = current_us();
+#ifdef SSCHED_LOG_TASK_STATS
+    log_insert_task_cycle_stat_entry(task, start_us, end_us);
+#endif
+    if( take_activation(&core_list[task->home_core], task) == FALSE )
+    {
+        task->active = task->periodic;
+    }
+    spin_unlock(&core_list[task->home_core].lock);
+    irq_restore(flags);
+}
+
+
+/**********************************************************
+ *
+ *  run_server()
+ *
+ *
+ *  DESCRIPTION:
+ *      Run a server's jobs, oldest first, until it runs out
+ *      of either jobs or budget. Each job's run time comes
+ *      off the budget once it returns.
+ *
+ *  NOTES:
+ *      A server left with jobs but no budget is queued
+ *      again by its next release, a server left with budget
+ *      but no jobs by the next sched_server_post().
+ *
+ */
+
+static void run_server(task_cb_t * task)
+{
+    irq_flags_t flags;
+    core_cb_t * home;
+    server_cb_t * server;
+    spsc_work_t job;
+    uint64_t job_start_us;
+    uint64_t job_us;
+#ifdef SSCHED_LOG_TASK_STATS
+    uint64_t start_us;
+    uint64_t end_us;
+
+    start_us = clock_now_us();
+#endif
+
+    home = &core_list[task->home_core];
+    server = task->server;
+
+    flags = irq_save();
+    spin_lock(&home->lock);
+
+    while( task->alive == TRUE && server->capacity_us > 0 && spsc_ring_pop(&server->queue, &job) )
+    {
+        spin_unlock(&home->lock);
+        irq_restore(flags);
+
+        job_start_us = clock_now_us();
+        job.func(job.ctx, job.arg);
+        job_us = clock_now_us() - job_start_us;
+
+        flags = irq_save();
+        spin_lock(&home->lock);
+
+        server->capacity_us = ( job_us < server->capacity_us ) ? server->capacity_us - job_us : 0;
+    }
+
+#ifdef SSCHED_LOG_TASK_STATS
+    end_us = clock_now_us();
+#endif
+
+    /* Server has finished running */
+    core_list[get_core_id()].abort_armed = FALSE;
+    task->scheduled = FALSE;
+    task->cycle_end_us = current_us();
+#ifdef SSCHED_LOG_TASK_STATS
+    log_insert_task_cycle_stat_entry(task, start_us, end_us);
+#endif
+    spin_unlock(&home->lock);
+    irq_restore(flags);
+}
+
+/**********************************************************
+ *
+ *  run_coop_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Run a task with its own stack until it finishes or
+ *      gives up the CPU, then put it wherever it asked to
+ *      go.
+ *
+ *  NOTES:
+ *      The task is only requeued once it has switched back
+ *      here, so another core can never pick it up before
+ *      its context is saved.
+ *
+ *      Overruns are measured against the time since the
+ *      task was last dispatched, time spent suspended does
+ *      not count against its budget.
+ *
+ */
+
+static void run_coop_task(core_cb_t * core, task_cb_t * task)
+{
+    irq_flags_t flags;
+    core_cb_t * home;
+#ifdef SSCHED_LOG_TASK_STATS
+    uint64_t start_us;
+
+    start_us = clock_now_us();
+#endif
+
+    /* Fresh cycle, start the procedure from the top */
+    if( task->started == FALSE )
+    {
+        task->started = TRUE;
+    #ifdef SSCHED_LOG_TASK_STATS
+        task->job_start_us = start_us;
+        task->job_run_us = 0;
+    #endif
+        cpu_ctx_init(&task->ctx, task->stack, task->stack_size, coop_task_entry);
+    }
+
+    task->coop_state = COOP_RUNNING;
+    cpu_ctx_switch(&core->sched_ctx, &task->ctx);
+
+#ifdef SSCHED_LOG_TASK_STATS
+    task->job_run_us += clock_now_us() - start_us;
+#endif
+
+    home = &core_list[task->home_core];
+
+    flags = irq_save();
+
+    /* A sleeper goes on the sleep list, which is guarded
+     * by release_lock, taken before any core lock */
+    if( task->coop_state == COOP_SLEEP )
+    {
+        spin_lock(&release_lock);
+    }
+
+    spin_lock(&home->lock);
+    core->abort_armed = FALSE;
+
+    /* The task ran off the end of its stack, it can not be
+     * trusted to run again */
+    if( *(uint32_t *)task->stack != STACK_CANARY )
+    {
+    #ifdef SSCHED_SHOW_DEBUG_DATA
+        printf("\nStack overflow in task with id=%d, killing it. Consider a larger stack_size.", task->usr_tsk->id);
+    #endif
+        if( task->alive == TRUE )
+        {
+            task->alive = FALSE;
+            task->generation = next_generation(task->generation);
+        }
+    }
+
+    task->scheduled = FALSE;
+
+    /* A killed task is not resumed, its slot is handed back
+     * by the ISR */
+    if( task->alive == FALSE )
+    {
+        task->started = FALSE;
+    }
+    else if( task->coop_state == COOP_YIELD )
+    {
+        ready_queue_push(home, task);
+    }
+    else if( task->coop_state == COOP_SLEEP )
+    {
+        sleep_list_insert(task);
+    }
+    /* A waiter stays parked until sched_activate_task()
+     * requeues it, unless it was activated already */
+    else if( task->coop_state == COOP_WAIT )
+    {
+        if( take_activation(home, task) == FALSE )
+        {
+            task->active = FALSE;
+        }
+    }
+    else
+    {
+        task->started = FALSE;
+        task->cycle_end_us = current_us();
+    #ifdef SSCHED_LOG_TASK_STATS
+        log_insert_task_cycle_stat_entry(task, task->job_start_us, task->job_start_us + task->job_run_us);
+    #endif
+        if( take_activation(home, task) == FALSE )
+        {
+            task->active = task->periodic;
+        }
+    }
+
+    spin_unlock(&home->lock);
+
+    if( task->coop_state == COOP_SLEEP )
+    {
+    #ifdef SSCHED_TICKLESS
+        /* The timer may be asleep until long after the wake up */
+        program_next_wakeup(task->wake_us);
+    #endif
+        spin_unlock(&release_lock);
+    }
+
+    irq_restore(flags);
+}
+
+/**********************************************************
+ *
+ *  coop_task_entry()
+ *
+ *
+ *  DESCRIPTION:
+ *      Bottom of every task stack. Runs one cycle of the
+ *      task procedure and hands the CPU back for good.
+ *
+ *  NOTES:
+ *      The task may have moved cores while it was
+ *      suspended, so the core is looked up again once the
+ *      procedure returns.
+ *
+ */
+
+static void coop_task_entry(void)
+{
+    core_cb_t * core;
+    task_cb_t * task;
+
+    task = core_list[get_core_id()].task_head;
+    task->usr_tsk->task_func();
+
+    core = &core_list[get_core_id()];
+    task->coop_state = COOP_DONE;
+    cpu_ctx_switch(&task->ctx, &core->sched_ctx);
+
+    /* Never switched back to, the next cycle starts over */
+}
+
+/**********************************************************
+ *
+ *  coop_suspend()
+ *
+ *
+ *  DESCRIPTION:
+ *      Switch the calling task back to the scheduler.
+ *      Returns once the task is dispatched again.
+ *
+ */
+
+static sched_err_t coop_suspend(coop_state_t state, uint64_t wake_us)
+{
+    uint32_t core_id;
+    task_cb_t * task;
+
+    if( sched_init_key != SCHED_INIT_KEY )
+    {
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    core_id = get_core_id();
+    if( core_id >= SSCHED_CORE_COUNT )
+    {
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    /* Only a task on its own stack has anywhere to come
+     * back to */
+    task = core_list[core_id].task_head;
+    if( task == NULL || task->stack == NULL )
+    {
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    task->coop_state = state;
+    task->wake_us = wake_us;
+    cpu_ctx_switch(&task->ctx, &core_list[core_id].sched_ctx);
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sleep_list_insert()
+ *
+ *
+ *  DESCRIPTION:
+ *      Add a task to the sleep list, after any task due
+ *      at the same time.
+ *
+ *  NOTES:
+ *      Caller holds release_lock. The list is only as long
+ *      as the number of sleeping tasks.
+ *
+ */
+
+static void sleep_list_insert(task_cb_t * task)
+{
+    task_cb_t ** link;
+
+    link = &sleep_head;
+    while( *link != NULL && TIME_BEFORE_EQ((*link)->wake_us, task->wake_us) )
+    {
+        link = &(*link)->next_sleeper;
+    }
+
+    task->next_sleeper = *link;
+    *link = task;
+}
+
+/**********************************************************
+ *
+ *  sleep_list_remove()
+ *
+ *
+ *  DESCRIPTION:
+ *      Take a task off the sleep list. Returns FALSE if it
+ *      was not on it.
+ *
+ *  NOTES:
+ *      Caller holds release_lock.
+ *
+ */
+
+static boolean sleep_list_remove(task_cb_t * task)
+{
+    task_cb_t ** link;
+
+    for(link = &sleep_head; *link != NULL; link = &(*link)->next_sleeper)
+    {
+        if( *link == task )
+        {
+            *link = task->next_sleeper;
+            task->next_sleeper = NULL;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**********************************************************
+ *
+ *  find_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Look up a registered task by id, NULL if there is
+ *      no such task.
+ *
+ */
+
+static task_cb_t * find_task(sched_task_id_t task_id)
+{
+    task_cb_t * task;
+    uint32_t slot;
+
+    slot = task_id & HANDLE_SLOT_MASK;
+    if( slot >= SSCHED_TSK_MAX_REGISTERED )
+    {
+        return NULL;
+    }
+
+    /* A stale handle is a generation behind its slot */
+    task = &system_task_list[slot];
+    if( task->alive == FALSE || TASK_HANDLE(task) != task_id )
+    {
+        return NULL;
+    }
+
+    return task;
+}
+
+/**********************************************************
+ *
+ *  free_slot()
+ *
+ *
+ *  DESCRIPTION:
+ *      Put a killed task's slot back on the free list.
+ *
+ *  NOTES:
+ *      Caller holds release_lock and has checked nothing
+ *      refers to the task any more.
+ *
+ */
+
+static void free_slot(task_cb_t * task)
+{
+    /* Jobs still queued on a killed server are dropped */
+    if( task->server != NULL )
+    {
+        task->server->in_use = FALSE;
+        task->server = NULL;
+    }
+
+    task->next_task = free_head;
+    free_head = task;
+    registered_tasks--;
+}
+
+/**********************************************************
+ *
+ *  take_activation()
+ *
+ *
+ *  DESCRIPTION:
+ *      Act on an activation that came in while the task
+ *      was running, now that it has given up the CPU. The
+ *      task is put back on the ready queue, to resume if it
+ *      is waiting or for a new cycle if it finished.
+ *      Returns FALSE if there was none.
+ *
+ *  NOTES:
+ *      Caller holds the home core's lock.
+ *
+ */
+
+static boolean take_activation(core_cb_t * home, task_cb_t * task)
+{
+    if( task->activate_pending == FALSE || task->alive == FALSE )
+    {
+        return FALSE;
+    }
+
+    task->activate_pending = FALSE;
+    task->active = TRUE;
+    ready_queue_push(home, task);
+
+#ifdef SSCHED_LOG_TASK_STATS
+    task->release_us = clock_now_us();
+#endif
+
+    return TRUE;
+}
+
+/**********************************************************
+ *
+ *  boost_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Add delta to the task's boost, moving it to the
+ *      head of its ready queue if that boosted it.
+ *
+ */
+
+static sched_err_t boost_task(sched_task_id_t task_id, sint32_t delta)
+{
+    irq_flags_t flags;
+    core_cb_t * core;
+    task_cb_t * task;
+    task_cb_t * prev;
+
+    flags = irq_save();
+    spin_lock(&release_lock);
+
+    task = find_task(task_id);
+    if( task == NULL )
+    {
+        spin_unlock(&release_lock);
+        irq_restore(flags);
+        return SCHED_ERR_PARAM;
+    }
+
+    core = &core_list[task->home_core];
+    spin_lock(&core->lock);
+
+    task->boost += delta;
+
+    if( task->boost > 0 && task->queued == TRUE && core->ready_head != task )
+    {
+        /* Unlink the task and push it back on at the head */
+        for(prev = core->ready_head; prev->next_task != task; prev = prev->next_task)
+            ;
+
+        prev->next_task = task->next_task;
+        if( core->ready_tail == task )
+        {
+            core->ready_tail = prev;
+        }
+
+        task->next_task = core->ready_head;
+        core->ready_head = task;
+    }
+
+    spin_unlock(&core->lock);
+    spin_unlock(&release_lock);
+    irq_restore(flags);
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  next_generation()
+ *
+ *
+ *  DESCRIPTION:
+ *      Generation a slot moves on to when its task is
+ *      killed. Skips zero on the wrap.
+ *
+ */
+
+static uint32_t next_generation(uint32_t generation)
+{
+    generation = ( generation + 1 ) & HANDLE_GEN_MASK;
+    if( generation == 0 )
+    {
+        generation = 1;
+    }
+
+    return generation;
+}
+
+/**********************************************************
+ *
+ *  ssched_get_overrun_stats()
+ *
+ *
+ *  DESCRIPTION:
+ *      Copy out the overrun counters of a task.
+ *
+ */
+
+sched_err_t ssched_get_overrun_stats(sched_task_id_t task_id, ssched_overrun_stats_t * stats)
+{
+    irq_flags_t flags;
+    task_cb_t * task;
+
+    task = find_task(task_id);
+    if( task == NULL || stats == NULL )
+    {
+        return SCHED_ERR_PARAM;
+    }
+
+    flags = irq_save();
+    spin_lock(&core_list[task->home_core].lock);
+    *stats = task->overrun_stats;
+    spin_unlock(&core_list[task->home_core].lock);
+    irq_restore(flags);
+
+    return SCHED_ERR_NO_ERR;
+}
+
+#ifdef SSCHED_LOG_TASK_STATS
+/**********************************************************
+ *
+ *  log_insert_task_cycle_stat_entry()
+ *
+ *
+ *  DESCRIPTION:
+ *      Fold a finished task cycle into the task's stats.
+ *
+ *  NOTES:
+ *      Caller holds the task's home core lock. Costs a
+ *      handful of compares and adds, nothing is stored per
+ *      cycle.
+ *
+ */
+
+static void log_insert_task_cycle_stat_entry(task_cb_t * task, uint64_t start_us, uint64_t end_us)
+{
+    ssched_task_stats_t * stats;
+    uint64_t exec_us;
+    uint64_t latency_us;
+    uint32_t bin;
+
+    stats = &task->stats;
+    exec_us = end_us - start_us;
+    latency_us = start_us - task->release_us;
+
+    if( stats->cycles == 0 || exec_us < stats->exec_min_us )
+    {
+        stats->exec_min_us = exec_us;
+    }
+
+    if( exec_us > stats->exec_max_us )
+    {
+        stats->exec_max_us = exec_us;
+    }
+
+    if( stats->cycles == 0 || latency_us < stats->latency_min_us )
+    {
+        stats->latency_min_us = latency_us;
+    }
+
+    if( latency_us > stats->latency_max_us )
+    {
+        stats->latency_max_us = latency_us;
+    }
+
+    stats->cycles++;
+    stats->exec_total_us += exec_us;
+
+    /* Bucket is the bit length of the execution time */
+    bin = ( exec_us == 0 ) ? 0 : (uint32_t)( 64 - __builtin_clzll(exec_us) );
+    if( bin >= SSCHED_STATS_HIST_BINS )
+    {
+        bin = SSCHED_STATS_HIST_BINS - 1;
+    }
+
+    stats->exec_hist[bin]++;
+}
+
+/**********************************************************
+ *
+ *  ssched_get_task_stats()
+ *
+ *
+ *  DESCRIPTION:
+ *      Copy out the statistics of a task. The derived
+ *      figures (mean, jitter) are worked out here so the
+ *      per cycle cost stays low.
+ *
+ */
+
+sched_err_t ssched_get_task_stats(sched_task_id_t task_id, ssched_task_stats_t * stats)
+{
+    irq_flags_t flags;
+    task_cb_t * task;
+
+    task = find_task(task_id);
+    if( task == NULL || stats == NULL )
+    {
+        return SCHED_ERR_PARAM;
+    }
+
+    flags = irq_save();
+    spin_lock(&core_list[task->home_core].lock);
+    *stats = task->stats;
+    spin_unlock(&core_list[task->home_core].lock);
+    irq_restore(flags);
+
+    if( stats->cycles > 0 )
+    {
+        stats->exec_mean_us = stats->exec_total_us / stats->cycles;
+    }
+
+    stats->jitter_us = stats->latency_max_us - stats->latency_min_us;
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  ssched_get_task_wcet_us()
+ *
+ *
+ *  DESCRIPTION:
+ *      Get the longest execution time seen for a task.
+ *
+ */
+
+sched_err_t ssched_get_task_wcet_us(sched_task_id_t task_id, uint64_t * wcet_us)
+{
+    task_cb_t * task;
+
+    task = find_task(task_id);
+    if( task == NULL || wcet_us == NULL )
+    {
+        return SCHED_ERR_PARAM;
+    }
+
+    /* A single aligned load, no need for the lock */
+    *wcet_us = task->stats.exec_max_us;
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  ssched_clear_task_stats()
+ *
+ *
+ *  DESCRIPTION:
+ *      Reset the statistics of a task.
+ *
+ */
+
+sched_err_t ssched_clear_task_stats(sched_task_id_t task_id)
+{
+    irq_flags_t flags;
+    task_cb_t * task;
+
+    task = find_task(task_id);
+    if( task == NULL )
+    {
+        return SCHED_ERR_PARAM;
+    }
+
+    flags = irq_save();
+    spin_lock(&core_list[task->home_core].lock);
+    clr_mem(&task->stats, sizeof(task->stats));
+    spin_unlock(&core_list[task->home_core].lock);
+    irq_restore(flags);
+
+    return SCHED_ERR_NO_ERR;
+}
+#endif
+
+/**********************************************************
+ *
+ *  sched_kill_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function.
+ *
+ *      Kill a task. Its handle stops working straight
+ *      away, its slot is handed back to registration once
+ *      the scheduler is done with it.
+ *
+ *  NOTES:
+ *      A task may kill itself, it still finishes the
+ *      current cycle.
+ *
+ */
+
+sched_err_t sched_kill_task(sched_task_id_t task_id)
+{
+    irq_flags_t flags;
+    core_cb_t * core;
+    task_cb_t * task;
+
+    flags = irq_save();
+    spin_lock(&release_lock);
+
+    task = find_task(task_id);
+    if( task == NULL )
+    {
+        spin_unlock(&release_lock);
+        irq_restore(flags);
+        return SCHED_ERR_FAILED_UPDATE;
+    }
+
+    core = &core_list[task->home_core];
+    spin_lock(&core->lock);
+
+    task->active = FALSE;
+    task->alive = FALSE;
+    task->generation = next_generation(task->generation);
+
+    /* A sleeper would otherwise hold on to its slot until
+     * it was due to wake, a waiter for good */
+    if( sleep_list_remove(task) )
+    {
+        task->started = FALSE;
+    }
+    else if( task->coop_state == COOP_WAIT && task->queued == FALSE && task->scheduled == FALSE )
+    {
+        task->started = FALSE;
+    }
+
+    spin_unlock(&core->lock);
+    spin_unlock(&release_lock);
+    irq_restore(flags);
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_activate_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Release an idle task
+ *      or resume a waiting one right away. A task that is
+ *      running or suspended some other way keeps the
+ *      activation until it gives up the CPU.
+ *
+ *  NOTES:
+ *      Servers are run by posting jobs to them, see
+ *      sched_server_post().
+ *
+ */
+
+sched_err_t sched_activate_task(sched_task_id_t task_id)
+{
+    irq_flags_t flags;
+    core_cb_t * core;
+    task_cb_t * task;
+    boolean released;
+
+    released = FALSE;
+
+    flags = irq_save();
+    spin_lock(&release_lock);
+
+    task = find_task(task_id);
+    if( task == NULL || task->server != NULL )
+    {
+        spin_unlock(&release_lock);
+        irq_restore(flags);
+        return SCHED_ERR_PARAM;
+    }
+
+    core = &core_list[task->home_core];
+    spin_lock(&core->lock);
+
+    if( task->scheduled == TRUE || ( task->started == TRUE && task->coop_state != COOP_WAIT ) )
+    {
+        task->activate_pending = TRUE;
+    }
+    /* Idle, or parked in sched_wait_activation(). A task
+     * that is queued already just runs as queued */
+    else if( task->queued == FALSE )
+    {
+        task->active = TRUE;
+        ready_queue_push(core, task);
+        released = TRUE;
+
+    #ifdef SSCHED_LOG_TASK_STATS
+        task->release_us = clock_now_us();
+    #endif
+    }
+
+    spin_unlock(&core->lock);
+    spin_unlock(&release_lock);
+    irq_restore(flags);
+
+    /* Get an idle core looking at its queue */
+    if( released )
+    {
+        cpu_wake_cores();
+    }
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_wait_activation()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Park the calling task
+ *      until sched_activate_task() requeues it.
+ *
+ */
+
+sched_err_t sched_wait_activation(void)
+{
+    return coop_suspend(COOP_WAIT, 0);
+}
+
+/**********************************************************
+ *
+ *  sched_boost_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. A boosted task goes
+ *      to the head of its ready queue whenever it is
+ *      queued, straight away if it is queued already.
+ *
+ *  NOTES:
+ *      Tasks are not preempted, so the boost only helps a
+ *      holder that gave up the CPU, e.g., with
+ *      sched_yield(), get back to it sooner.
+ *
+ */
+
+sched_err_t sched_boost_task(sched_task_id_t task_id)
+{
+    return boost_task(task_id, 1);
+}
+
+/**********************************************************
+ *
+ *  sched_unboost_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function.
+ *
+ */
+
+sched_err_t sched_unboost_task(sched_task_id_t task_id)
+{
+    return boost_task(task_id, -1);
+}
+
+/**********************************************************
+ *
+ *  sched_get_current_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function.
+ *
+ */
+
+sched_err_t sched_get_current_task(sched_task_id_t * task_id)
+{
+    task_cb_t * task;
+    uint32_t core_id;
+
+    core_id = get_core_id();
+    if( task_id == NULL || sched_init_key != SCHED_INIT_KEY || core_id >= SSCHED_CORE_COUNT )
+    {
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    task = core_list[core_id].task_head;
+    if( task == NULL )
+    {
+        return SCHED_ERR_INVLD_STATE;
+    }
+
+    *task_id = TASK_HANDLE(task);
+
+    return SCHED_ERR_NO_ERR;
+}
+
+/**********************************************************
+ *
+ *  sched_server_post()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Queue a job on a
+ *      server and, if the server has budget left and is
+ *      not already waiting or running, put it on its home
+ *      core's ready queue straight away.
+ *
+ */
+
+sched_err_t sched_server_post(sched_task_id_t server_id, spsc_work_func_t func, void * ctx, uint32_t arg)
+{
+    irq_flags_t flags;
+    core_cb_t * core;
+    task_cb_t * task;
+    sched_err_t err;
+    boolean released;
+
+    if( func == NULL )
+    {
+        return SCHED_ERR_PARAM;
+    }
+
+    released = FALSE;
+
+    flags = irq_save();
+    spin_lock(&release_lock);
+
+    task = find_task(server_id);
+    if( task == NULL || task->server == NULL )
+    {
+        spin_unlock(&release_lock);
+        irq_restore(flags);
+        return SCHED_ERR_PARAM;
+    }
+
+    core = &core_list[task->home_core];
+    spin_lock(&core->lock);
+
+    err = SCHED_ERR_FAILED_UPDATE;
+    if( spsc_ring_push(&task->server->queue, func, ctx, arg) )
+    {
+        err = SCHED_ERR_NO_ERR;
+
+        if( task->server->capacity_us > 0 && task->queued == FALSE && task->scheduled == FALSE )
+        {
+            ready_queue_push(core, task);
+            released = TRUE;
+
+        #ifdef SSCHED_LOG_TASK_STATS
+            task->release_us = clock_now_us();
+        #endif
+        }
+    }
+
+    spin_unlock(&core->lock);
+    spin_unlock(&release_lock);
+    irq_restore(flags);
+
+    if( released )
+    {
+        cpu_wake_cores();
+    }
+
+    return err;
+}
+
+/**********************************************************
+ *
+ *  sched_yield()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Requeue the calling
+ *      task behind whatever else is ready.
+ *
+ */
+
+sched_err_t sched_yield(void)
+{
+    return coop_suspend(COOP_YIELD, 0);
+}
+
+/**********************************************************
+ *
+ *  sched_sleep_us()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Suspend the calling
+ *      task for at least us microseconds.
+ *
+ */
+
+sched_err_t sched_sleep_us(uint32_t us)
+{
+#ifdef SSCHED_TICKLESS
+    if( us == 0 )
+    {
+        us = 1;
+    }
+
+    return coop_suspend(COOP_SLEEP, current_us() + us);
+#else
+    uint64_t ticks;
+
+    /* Always sleep past the current tick, which may be
+     * nearly over */
+    ticks = US_TO_TICKS_CEIL(us);
+    if( ticks == 0 )
+    {
+        ticks = 1;
+    }
+
+    return coop_suspend(COOP_SLEEP, current_us() + ( ticks * SSCHED_SCHED_TICK_US ));
+#endif
+}
+
+/**********************************************************
+ *
+ *  sched_wait_until()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function. Suspend the calling
+ *      task until the given tick. A tick that has already
+ *      passed just yields.
+ *
+ */
+
+sched_err_t sched_wait_until(uint64_t tick)
+{
+    if( tick <= current_tick() )
+    {
+        return coop_suspend(COOP_YIELD, 0);
+    }
+
+    return coop_suspend(COOP_SLEEP, tick * SSCHED_SCHED_TICK_US);
+}
+
+/**********************************************************
+ *
+ *  sched_get_tick()
+ *
+ *
+ *  DESCRIPTION:
+ *      Contracted scheduler function.
+ *
+ */
+
+uint64_t sched_get_tick(void)
+{
+    return current_tick();
+}
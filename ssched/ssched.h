@@ -1,5 +1,187 @@
+/**********************************************************
+ *
+ *  ssched.h
+ *
+ *  DESCRIPTION:
+ *      Simple scheduler specific interface
+ *
+ */
+
 #pragma once
 
+#include "generic.h"
+#include "sched.h"
+
+/**********************************************************
+ *
+ *  ssched_overrun_stats_t
+ *
+ *      Per task overrun counters, see overrun_policy in
+ *      sched_usr_tsk_t.
+ *
+ *  overruns
+ *
+ *      Cycles that ran past the task's budget.
+ *
+ *  skipped_releases
+ *
+ *      Releases dropped by SCHED_OVERRUN_SKIP.
+ *
+ *  aborts
+ *
+ *      Cycles unwound by SCHED_OVERRUN_ABORT.
+ *
+ *  degrades
+ *
+ *      Times the task was moved to its degraded period by
+ *      SCHED_OVERRUN_DEGRADE.
+ *
+ */
+
+typedef struct
+    {
+    uint32_t overruns;
+    uint32_t skipped_releases;
+    uint32_t aborts;
+    uint32_t degrades;
+    } ssched_overrun_stats_t;
+
+/**********************************************************
+ *
+ *  ssched_get_overrun_stats()
+ *
+ *  DESCRIPTION:
+ *      Copy out the overrun counters of a task.
+ *
+ */
+
+sched_err_t ssched_get_overrun_stats(sched_task_id_t task_id, ssched_overrun_stats_t * stats);
+
+/**********************************************************
+ *
+ *  ssched_cyclic_frame_t
+ *
+ *      Minor frame of a schedule table, see SSCHED_CYCLIC.
+ *      Tables are generated offline by
+ *      tools/scripts/gen_cyclic_table.py.
+ *
+ *  first, count
+ *
+ *      Range of ssched_cyclic_slots[] released at the start
+ *      of the frame, in dispatch order. A slot is an index
+ *      into the task list given to sched_init().
+ *
+ */
+
+typedef struct
+    {
+    uint16_t first;
+    uint16_t count;
+    } ssched_cyclic_frame_t;
+
 #ifdef SSCHED_LOG_TASK_STATS
-void ssched_log_insert_task_cycle_stat_entry(void);
+
+/**
+ * $config: SSCHED_STATS_HIST_BINS. Number of log2 buckets in the per task
+ * execution time histogram. Bucket n counts cycles that took
+ * [ 2^(n-1), 2^n ) microseconds, bucket 0 counts cycles under 1uS and the
+ * last bucket also takes everything longer.
+ *
+ */
+#ifndef SSCHED_STATS_HIST_BINS
+#define SSCHED_STATS_HIST_BINS 24
+#endif
+
+/**********************************************************
+ *
+ *  ssched_task_stats_t
+ *
+ *      Per task statistics. Times are in microseconds of the
+ *      1MHz system counter (see clock_now_us()).
+ *
+ *  cycles
+ *
+ *      Number of completed task cycles.
+ *
+ *  exec_min_us, exec_max_us, exec_mean_us
+ *
+ *      Execution time of a cycle. exec_max_us is the
+ *      observed WCET.
+ *
+ *  exec_total_us
+ *
+ *      Sum of all execution times.
+ *
+ *  exec_hist
+ *
+ *      log2 histogram of execution times.
+ *
+ *  latency_min_us, latency_max_us
+ *
+ *      Time from a release to the task starting.
+ *
+ *  jitter_us
+ *
+ *      Release jitter, i.e., latency_max_us - latency_min_us.
+ *
+ *  overruns
+ *
+ *      Cycles that ran longer than the task budget.
+ *
+ *  missed_releases
+ *
+ *      Releases dropped because the task was still queued or
+ *      running from an earlier one.
+ *
+ */
+
+typedef struct
+    {
+    uint64_t cycles;
+    uint64_t exec_min_us;
+    uint64_t exec_max_us;
+    uint64_t exec_mean_us;
+    uint64_t exec_total_us;
+    uint32_t exec_hist[ SSCHED_STATS_HIST_BINS ];
+    uint64_t latency_min_us;
+    uint64_t latency_max_us;
+    uint64_t jitter_us;
+    uint32_t overruns;
+    uint32_t missed_releases;
+    } ssched_task_stats_t;
+
+/**********************************************************
+ *
+ *  ssched_get_task_stats()
+ *
+ *  DESCRIPTION:
+ *      Copy out the statistics of a task.
+ *
+ */
+
+sched_err_t ssched_get_task_stats(sched_task_id_t task_id, ssched_task_stats_t * stats);
+
+/**********************************************************
+ *
+ *  ssched_get_task_wcet_us()
+ *
+ *  DESCRIPTION:
+ *      Get the longest execution time seen for a task.
+ *
+ */
+
+sched_err_t ssched_get_task_wcet_us(sched_task_id_t task_id, uint64_t * wcet_us);
+
+/**********************************************************
+ *
+ *  ssched_clear_task_stats()
+ *
+ *  DESCRIPTION:
+ *      Reset the statistics of a task, e.g., to start a
+ *      new measurement window.
+ *
+ */
+
+sched_err_t ssched_clear_task_stats(sched_task_id_t task_id);
+
 #endif
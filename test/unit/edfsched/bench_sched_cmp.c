@@ -0,0 +1,247 @@
+// bench_sched_cmp.c
+//
+// Deadline miss comparison between ssched and edfsched.
+// Built once per scheduler (BENCH_SSCHED or BENCH_EDFSCHED)
+// and driven with a virtual clock: a job burns its execution
+// time by ticking the scheduler ISR, the same way timer
+// interrupts would keep arriving while it runs.
+#include <stdio.h>
+#include <string.h>
+#include "generic.h"
+#include "sched.h"
+#include "irq.h"
+#include "peripherals/timer.h"
+
+#if defined(BENCH_SSCHED)
+#include "../../../ssched/ssched.c"
+#define BENCH_SCHED_NAME "ssched"
+#define BENCH_DISPATCH() sched_core_step(&core_list[0])
+#elif defined(BENCH_EDFSCHED)
+#include "../../../edfsched/edfsched.c"
+#define BENCH_SCHED_NAME "edfsched"
+#define BENCH_DISPATCH()                \
+    if(scheduler_state == EXECUTE_TASK) \
+    {                                   \
+        call_task_proc(task_head);      \
+        scheduler_state = IDLE;         \
+    }
+#else
+#error Define BENCH_SSCHED or BENCH_EDFSCHED
+#endif
+
+#define NUM_TASKS       5
+#define SIM_TICKS       200000
+#define UTIL_STEP_PCT   5
+#define UTIL_START_PCT  50
+#define UTIL_END_PCT    100
+
+/* Non-harmonic periods, in ms (one tick each) */
+static const uint32_t periods_ms[NUM_TASKS] = { 50, 70, 110, 130, 170 };
+
+/* test variables */
+sched_usr_tsk_t task_list[NUM_TASKS];
+
+static uint64_t exec_ticks[NUM_TASKS];
+static uint64_t jobs_on_time[NUM_TASKS];
+
+/* functions */
+static void run_job(uint32_t task);
+static void run_load(uint32_t util_pct);
+
+#define DEFINE_TASK(n) static void task_##n(void) { run_job(n); }
+DEFINE_TASK(0)
+DEFINE_TASK(1)
+DEFINE_TASK(2)
+DEFINE_TASK(3)
+DEFINE_TASK(4)
+
+static void (* const task_funcs[NUM_TASKS])(void) = { task_0, task_1, task_2, task_3, task_4 };
+
+int main(int argc, char **argv) {
+    uint32_t util_pct;
+
+    if(argc < 2 || strcmp(argv[1], "--no-header") != 0)
+    {
+        printf("sched,utilization,releases,deadline_misses,miss_pct\n");
+    }
+
+    for(util_pct = UTIL_START_PCT; util_pct <= UTIL_END_PCT; util_pct += UTIL_STEP_PCT)
+    {
+        run_load(util_pct);
+    }
+
+    return 0;
+}
+
+/**********************************************************
+ *
+ *  run_load()
+ *
+ *
+ *  DESCRIPTION:
+ *      Run the task set for SIM_TICKS with execution times
+ *      scaled so the total utilization is util_pct, split
+ *      evenly between the tasks.
+ *
+ */
+
+static void run_load(uint32_t util_pct)
+{
+    uint32_t i;
+    uint64_t releases;
+    uint64_t on_time;
+    uint64_t misses;
+    double util;
+
+    util = 0;
+    for(i = 0; i < NUM_TASKS; i++)
+    {
+        exec_ticks[i] = ( (uint64_t)periods_ms[i] * util_pct + ( 50 * NUM_TASKS ) ) / ( 100 * NUM_TASKS );
+        util += (double)exec_ticks[i] / periods_ms[i];
+
+        jobs_on_time[i] = 0;
+        task_list[i].period_ms = periods_ms[i];
+        task_list[i].task_func = task_funcs[i];
+    }
+
+    sched_init(task_list, NUM_TASKS);
+
+    while(system_tick < SIM_TICKS)
+    {
+        schedule_isr();
+
+        /* Run dispatched jobs the same way sched_main() does */
+        BENCH_DISPATCH();
+    }
+
+    /* Only count releases whose deadline fell inside the run.
+     * Task n is released on ticks 1 + k * period */
+    releases = 0;
+    on_time = 0;
+    for(i = 0; i < NUM_TASKS; i++)
+    {
+        releases += ( SIM_TICKS - 1 ) / periods_ms[i];
+        on_time += jobs_on_time[i];
+    }
+
+    misses = ( releases > on_time ) ? ( releases - on_time ) : 0;
+
+    printf("%s,%.3f,%llu,%llu,%.2f\n", BENCH_SCHED_NAME, util, releases, misses,
+           ( 100.0 * misses ) / releases);
+}
+
+/**********************************************************
+ *
+ *  run_job()
+ *
+ *
+ *  DESCRIPTION:
+ *      Body of every benchmark task. The job belongs to the
+ *      latest release at or before its start and is on time
+ *      if it finishes by the task's next release.
+ *
+ */
+
+static void run_job(uint32_t task)
+{
+    uint64_t period;
+    uint64_t deadline;
+    uint64_t i;
+
+    period = periods_ms[task];
+    deadline = 1 + ( ( ( system_tick - 1 ) / period ) + 1 ) * period;
+
+    for(i = 0; i < exec_ticks[task]; i++)
+    {
+        schedule_isr();
+    }
+
+    if(system_tick <= deadline && deadline <= SIM_TICKS)
+    {
+        jobs_on_time[task]++;
+    }
+}
+
+/* mocked functions */
+
+timer_err_t8 timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
+{
+    (void)timer_id;
+    (void)irq_cb;
+    (void)ticks;
+
+    return TIMER_ERR_NONE;
+}
+
+void uart_init()
+{
+}
+
+boolean uart_is_init()
+{
+    return TRUE;
+}
+
+uint32_t get_core_id(void)
+{
+    return 0;
+}
+
+boolean defer_work(spsc_work_func_t func, void * ctx, uint32_t arg)
+{
+    (void)func;
+    (void)ctx;
+    (void)arg;
+
+    return TRUE;
+}
+
+uint32_t defer_run(uint32_t max_items)
+{
+    (void)max_items;
+
+    return 0;
+}
+
+irq_flags_t irq_save(void)
+{
+    return 0;
+}
+
+void irq_restore(irq_flags_t flags)
+{
+    (void)flags;
+}
+
+void irq_set_return(void_func_t func)
+{
+    (void)func;
+}
+
+void cpu_idle(void)
+{
+}
+
+void cpu_wake_cores(void)
+{
+}
+
+boolean defer_pending(void)
+{
+    return FALSE;
+}
+
+#if defined(BENCH_SSCHED)
+uint64_t clock_now_us(void)
+{
+    return 0;
+}
+
+timer_err_t8 timer_set_next(timer_id_t8 timer_id, uint32_t ticks)
+{
+    (void)timer_id;
+    (void)ticks;
+
+    return TIMER_ERR_NONE;
+}
+#endif
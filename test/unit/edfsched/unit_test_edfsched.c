@@ -0,0 +1,277 @@
+// unit_test_edfsched.c
+#include <stdio.h>
+#include "generic.h"
+#include "sched.h"
+#include "irq.h"
+#include "unity.h"
+#include "peripherals/timer.h"
+#include "../../../edfsched/edfsched.c"
+
+#define MAX_NUMBER_OF_TASKS 10
+
+/* test variables */
+sched_usr_tsk_t task_list[MAX_NUMBER_OF_TASKS];
+
+uint64_t long_task_call_count = 0;
+uint64_t short_task_call_count = 0;
+sched_task_id_t run_order[4];
+uint32_t run_order_cnt = 0;
+
+/* functions */
+static void test_rates(void);
+static void test_earliest_deadline_first(void);
+static void test_admission_control(void);
+static void test_event_driven(void);
+static void long_task_func(void);
+static void short_task_func(void);
+static void record_task_func(void);
+void tick_system(uint64_t ticks);
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main() {
+    test_rates();
+    test_earliest_deadline_first();
+    test_admission_control();
+    test_event_driven();
+
+    return 0;
+}
+
+/* unit tests */
+static void test_rates()
+{
+    // Test that every task runs once per period
+    task_list[0].period_ms = 20;
+    task_list[0].task_func = short_task_func;
+    task_list[1].period_ms = 50;
+    task_list[1].task_func = long_task_func;
+    sched_init(task_list, 2);
+
+    tick_system(1000);
+
+    TEST_ASSERT_EQUAL_UINT64(50, short_task_call_count);
+    TEST_ASSERT_EQUAL_UINT64(20, long_task_call_count);
+    TEST_ASSERT_EQUAL_UINT64(0, system_task_list[0].deadline_misses);
+    TEST_ASSERT_EQUAL_UINT64(0, system_task_list[1].deadline_misses);
+
+    printf("yay passed the rates test\n");
+}
+
+static void test_earliest_deadline_first()
+{
+    // Test that jobs released together run in deadline order, not registration order
+    task_list[0].period_ms = 30;
+    task_list[0].task_func = record_task_func;
+    task_list[1].period_ms = 10;
+    task_list[1].task_func = record_task_func;
+    sched_init(task_list, 2);
+
+    run_order_cnt = 0;
+    tick_system(2);
+
+    TEST_ASSERT_EQUAL_UINT32(2, run_order_cnt);
+    TEST_ASSERT_EQUAL_UINT32(task_list[1].id, run_order[0]);
+    TEST_ASSERT_EQUAL_UINT32(task_list[0].id, run_order[1]);
+
+    printf("yay passed the earliest deadline first test\n");
+}
+
+static void test_admission_control()
+{
+    uint32_t i;
+
+    // Test that task sets that could miss deadlines are turned away at registration
+    task_list[0].period_ms = 10;
+    task_list[0].task_func = short_task_func;
+    task_list[0].budget_us = 5000;
+    task_list[1].period_ms = 20;
+    task_list[1].task_func = long_task_func;
+    task_list[1].budget_us = 8000;
+    task_list[2].period_ms = 10;
+    task_list[2].task_func = short_task_func;
+    task_list[2].budget_us = 6000;
+    task_list[3].period_ms = 5;
+    task_list[3].task_func = short_task_func;
+    sched_init(task_list, 1);
+
+    /* 90% utilization, but an 8mS job can block the 10mS task past its deadline */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_UNSCHEDULABLE, sched_register_task(&task_list[1]));
+    TEST_ASSERT_EQUAL_UINT32(1, registered_tasks);
+
+    task_list[1].budget_us = 4000;
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_register_task(&task_list[1]));
+
+    /* over 100% utilization */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_UNSCHEDULABLE, sched_register_task(&task_list[2]));
+
+    /* tasks without a budget are not analyzed */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_register_task(&task_list[3]));
+    TEST_ASSERT_EQUAL_UINT32(3, registered_tasks);
+    TEST_ASSERT_TRUE(system_task_list[2].usr_tsk == &task_list[3]);
+
+    for(i = 0; i < 4; i++)
+    {
+        task_list[i].budget_us = 0;
+    }
+
+    printf("yay passed the admission control test\n");
+}
+
+static void test_event_driven()
+{
+    // Test that zero period tasks only run when activated, after the periodic jobs
+    task_list[0].period_ms = 10;
+    task_list[0].task_func = record_task_func;
+    task_list[1].period_ms = 0;
+    task_list[1].task_func = long_task_func;
+    task_list[1].budget_us = 50000;
+    sched_init(task_list, 2);
+
+    /* not analyzed, a periodic task with this budget would not fit */
+    TEST_ASSERT_EQUAL_UINT32(2, registered_tasks);
+
+    long_task_call_count = 0;
+    tick_system(32);
+    TEST_ASSERT_EQUAL_UINT64(0, long_task_call_count);
+
+    /* activations before the job runs are absorbed by it */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_activate_task(task_list[1].id));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_activate_task(task_list[1].id));
+    tick_system(1);
+    TEST_ASSERT_EQUAL_UINT64(1, long_task_call_count);
+
+    /* a periodic job released on the same tick goes first */
+    tick_system(7);
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_activate_task(task_list[1].id));
+    run_order_cnt = 0;
+    tick_system(1);
+    TEST_ASSERT_EQUAL_UINT32(1, run_order_cnt);
+    TEST_ASSERT_EQUAL_UINT64(1, long_task_call_count);
+    tick_system(1);
+    TEST_ASSERT_EQUAL_UINT64(2, long_task_call_count);
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_kill_task(task_list[1].id));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_FAILED_UPDATE, sched_activate_task(task_list[1].id));
+    TEST_ASSERT_EQUAL_UINT64(0, system_task_list[1].deadline_misses);
+
+    task_list[1].budget_us = 0;
+
+    printf("yay passed the event driven test\n");
+}
+
+static void long_task_func(void)
+{
+    long_task_call_count = long_task_call_count + 1;
+}
+
+static void short_task_func(void)
+{
+    short_task_call_count = short_task_call_count + 1;
+}
+
+static void record_task_func(void)
+{
+    if(run_order_cnt < list_cnt(run_order))
+    {
+        run_order[run_order_cnt] = task_head->usr_tsk->id;
+    }
+    run_order_cnt++;
+}
+
+/* helper functions */
+
+/**********************************************************
+ *
+ *  tick_system()
+ *
+ *
+ *  DESCRIPTION:
+ *      Helper function to tick the system forward in time
+ *      by simulating timer based scheduling ISR. Dispatched
+ *      jobs are run after each tick the same way
+ *      sched_main() would.
+ *
+ */
+
+void tick_system(uint64_t ticks)
+{
+    uint64_t i;
+
+    for(i = 0; i < ticks; i++)
+    {
+        schedule_isr();
+
+        if(scheduler_state == EXECUTE_TASK)
+        {
+            call_task_proc(task_head);
+            scheduler_state = IDLE;
+        }
+    }
+}
+
+/* mocked functions */
+
+timer_err_t8 timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
+{
+    (void)timer_id;
+    (void)irq_cb;
+    (void)ticks;
+
+    return TIMER_ERR_NONE;
+}
+
+void uart_init()
+{
+}
+
+boolean uart_is_init()
+{
+    return TRUE;
+}
+
+uint32_t get_core_id(void)
+{
+    return 0;
+}
+
+boolean defer_work(spsc_work_func_t func, void * ctx, uint32_t arg)
+{
+    (void)func;
+    (void)ctx;
+    (void)arg;
+
+    return TRUE;
+}
+
+uint32_t defer_run(uint32_t max_items)
+{
+    (void)max_items;
+
+    return 0;
+}
+
+irq_flags_t irq_save(void)
+{
+    return 0;
+}
+
+void irq_restore(irq_flags_t flags)
+{
+    (void)flags;
+}
+
+void cpu_idle(void)
+{
+}
+
+boolean defer_pending(void)
+{
+    return FALSE;
+}
@@ -0,0 +1,229 @@
+// unit_test_soft_timer.c
+#include <stdio.h>
+#include "generic.h"
+#include "irq.h"
+#include "unity.h"
+#include "peripherals/timer.h"
+#include "../../../common/soft_timer.c"
+
+#define T SOFT_TIMER_TICK_US
+
+/* test variables */
+uint64_t mock_counter_us = 0;
+void_func_t mock_timer_cb = NULL;
+uint32_t mock_timer_ticks = 0;
+
+soft_timer_t timers[4];
+uint32_t fire_cnt[4];
+uint64_t fire_step[4];
+
+/* functions */
+static void test_one_shot(void);
+static void test_periodic(void);
+static void test_cascade(void);
+static void test_cancel_from_callback(void);
+static void advance_us(uint64_t us, uint64_t step_us);
+static void record_fire(void * ctx);
+static void cancel_next(void * ctx);
+static void stop_after_three(void * ctx);
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main() {
+    TEST_ASSERT_EQUAL(TIMER_ERR_RESOURCE_UNAVAILABLE, soft_timer_start(&timers[0], record_fire, &fire_cnt[0], 0, 0));
+    TEST_ASSERT_EQUAL(TIMER_ERR_NONE, soft_timer_init());
+    TEST_ASSERT_EQUAL_UINT32(SOFT_TIMER_TICK_US, mock_timer_ticks);
+
+    test_one_shot();
+    test_periodic();
+    test_cascade();
+    test_cancel_from_callback();
+
+    return 0;
+}
+
+/* unit tests */
+static void test_one_shot()
+{
+    // Test that a one-shot timer fires on the first step past its delay, and not once cancelled
+    clr_mem(fire_cnt, sizeof(fire_cnt));
+    TEST_ASSERT_EQUAL(TIMER_ERR_INVALID_PRMTRS, soft_timer_start(&timers[0], NULL, NULL, 0, 0));
+
+    soft_timer_start(&timers[0], record_fire, &fire_cnt[0], 2 * T + T / 2, 0);
+    soft_timer_start(&timers[1], record_fire, &fire_cnt[1], 2 * T + T / 2, 0);
+    TEST_ASSERT_TRUE(soft_timer_pending(&timers[0]));
+
+    advance_us(3 * T - 1, T);
+    TEST_ASSERT_EQUAL_UINT32(0, fire_cnt[0]);
+    TEST_ASSERT_TRUE(soft_timer_cancel(&timers[1]));
+    TEST_ASSERT_FALSE(soft_timer_cancel(&timers[1]));
+
+    advance_us(1, 1);
+    TEST_ASSERT_EQUAL_UINT32(1, fire_cnt[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, fire_cnt[1]);
+    TEST_ASSERT_FALSE(soft_timer_pending(&timers[0]));
+
+    advance_us(10 * T, T);
+    TEST_ASSERT_EQUAL_UINT32(1, fire_cnt[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, wheel_cnt);
+
+    printf("yay passed the one-shot test\n");
+}
+
+static void test_periodic()
+{
+    // Test that a periodic timer keeps its grid through a late IRQ, and can stop itself
+    clr_mem(fire_cnt, sizeof(fire_cnt));
+    soft_timer_start(&timers[0], record_fire, &fire_cnt[0], T, T);
+
+    advance_us(10 * T, T);
+    TEST_ASSERT_EQUAL_UINT32(10, fire_cnt[0]);
+
+    /* a late IRQ catches up on every step it missed */
+    advance_us(5 * T, 5 * T);
+    TEST_ASSERT_EQUAL_UINT32(15, fire_cnt[0]);
+    TEST_ASSERT_TRUE(soft_timer_cancel(&timers[0]));
+
+    soft_timer_start(&timers[2], stop_after_three, &fire_cnt[2], 0, 2 * T);
+    advance_us(20 * T, T);
+    TEST_ASSERT_EQUAL_UINT32(3, fire_cnt[2]);
+    TEST_ASSERT_FALSE(soft_timer_pending(&timers[2]));
+
+    printf("yay passed the periodic test\n");
+}
+
+static void test_cascade()
+{
+    uint64_t start;
+    uint32_t i;
+
+    // Test that timers on every level, and past the top one, fire exactly on their step
+    clr_mem(fire_cnt, sizeof(fire_cnt));
+    start = mock_counter_us / SOFT_TIMER_TICK_US;
+
+    soft_timer_start(&timers[0], record_fire, &fire_cnt[0], 100 * T, 0);
+    soft_timer_start(&timers[1], record_fire, &fire_cnt[1], 5000 * T, 0);
+    soft_timer_start(&timers[2], record_fire, &fire_cnt[2], 300000 * T, 0);
+    soft_timer_start(&timers[3], record_fire, &fire_cnt[3], 0xFFFFFFFFUL, 0);
+
+    TEST_ASSERT_TRUE(timers[0].pprev == &wheel[1][ WHEEL_IDX(timers[0].expires, 1) ]);
+    TEST_ASSERT_TRUE(timers[1].pprev == &wheel[2][ WHEEL_IDX(timers[1].expires, 2) ]);
+    TEST_ASSERT_TRUE(timers[2].pprev == &wheel[3][ WHEEL_IDX(timers[2].expires, 3) ]);
+
+    /* big late steps, the IRQ runs every step in between */
+    while( soft_timer_pending(&timers[3]) )
+    {
+        advance_us(997 * T, 997 * T);
+    }
+
+    for(i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(1, fire_cnt[i]);
+        TEST_ASSERT_EQUAL_UINT64(timers[i].expires, fire_step[i]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(start + 100, fire_step[0]);
+    TEST_ASSERT_EQUAL_UINT64(start + 300000, fire_step[2]);
+    TEST_ASSERT_TRUE(fire_step[3] - start > WHEEL_SPAN);
+    TEST_ASSERT_EQUAL_UINT32(0, wheel_cnt);
+
+    printf("yay passed the cascade test\n");
+}
+
+static void test_cancel_from_callback()
+{
+    // Test that a callback can cancel a timer due on the same step
+    clr_mem(fire_cnt, sizeof(fire_cnt));
+    soft_timer_start(&timers[1], record_fire, &fire_cnt[1], 3 * T, 0);
+    soft_timer_start(&timers[0], cancel_next, &timers[1], 3 * T, 0);
+
+    /* the slot is run newest first */
+    advance_us(5 * T, T);
+    TEST_ASSERT_EQUAL_UINT32(0, fire_cnt[1]);
+    TEST_ASSERT_FALSE(soft_timer_pending(&timers[1]));
+    TEST_ASSERT_EQUAL_UINT32(0, wheel_cnt);
+
+    printf("yay passed the cancel from callback test\n");
+}
+
+/* helper functions */
+
+static void advance_us(uint64_t us, uint64_t step_us)
+{
+    uint64_t end = mock_counter_us + us;
+
+    while( mock_counter_us < end )
+    {
+        mock_counter_us += step_us;
+        if( mock_counter_us > end )
+        {
+            mock_counter_us = end;
+        }
+
+        mock_timer_cb();
+    }
+}
+
+static void record_fire(void * ctx)
+{
+    uint32_t i = (uint32_t)( (uint32_t *)ctx - fire_cnt );
+
+    fire_cnt[i]++;
+    fire_step[i] = wheel_step - 1;
+}
+
+static void cancel_next(void * ctx)
+{
+    soft_timer_cancel((soft_timer_t *)ctx);
+}
+
+static void stop_after_three(void * ctx)
+{
+    record_fire(ctx);
+
+    if( fire_cnt[2] == 3 )
+    {
+        soft_timer_cancel(&timers[2]);
+    }
+}
+
+/* mocked functions */
+
+timer_err_t8 timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
+{
+    *timer_id = 1;
+    mock_timer_cb = irq_cb;
+    mock_timer_ticks = ticks;
+
+    return TIMER_ERR_NONE;
+}
+
+timer_err_t8 timer_alloc_local(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
+{
+    (void)timer_id;
+    (void)irq_cb;
+    (void)ticks;
+
+    return TIMER_ERR_RESOURCE_UNAVAILABLE;
+}
+
+uint64_t clock_now_us(void)
+{
+    return mock_counter_us;
+}
+
+irq_flags_t irq_save(void)
+{
+    return 0;
+}
+
+void irq_restore(irq_flags_t flags)
+{
+    (void)flags;
+}
@@ -0,0 +1,186 @@
+// unit_test_spsc_ring.c
+#include <stdio.h>
+#include <pthread.h>
+#include "generic.h"
+#include "unity.h"
+#include "../../../common/spsc_ring.c"
+
+/* The host <sched.h> is shadowed by the kernel's sched.h, which
+ * has a sched_yield() of its own */
+int host_sched_yield(void) __asm__("sched_yield");
+
+#define RING_LEN        8
+#define STRESS_ITEMS    200000
+
+/* test variables */
+spsc_work_t items[RING_LEN];
+spsc_ring_t ring;
+
+uint32_t work_sum = 0;
+uint32_t work_last = 0;
+uint32_t work_out_of_order = 0;
+
+/* functions */
+static void test_fifo(void);
+static void test_full(void);
+static void test_threads(void);
+static void record_work(void * ctx, uint32_t arg);
+static void * producer_thread(void * arg);
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main() {
+    test_fifo();
+    test_full();
+    test_threads();
+
+    return 0;
+}
+
+/* unit tests */
+static void test_fifo()
+{
+    spsc_work_t item;
+    uint32_t i;
+
+    // Test that items come out in the order they went in, across the wrap of the ring
+    TEST_ASSERT_FALSE(spsc_ring_init(&ring, items, 6));
+    TEST_ASSERT_TRUE(spsc_ring_init(&ring, items, RING_LEN));
+    TEST_ASSERT_TRUE(spsc_ring_is_empty(&ring));
+    TEST_ASSERT_FALSE(spsc_ring_pop(&ring, &item));
+
+    for(i = 0; i < 3 * RING_LEN; i++)
+    {
+        TEST_ASSERT_TRUE(spsc_ring_push(&ring, record_work, &ring, i));
+        TEST_ASSERT_FALSE(spsc_ring_is_empty(&ring));
+
+        TEST_ASSERT_TRUE(spsc_ring_pop(&ring, &item));
+        TEST_ASSERT_TRUE(item.ctx == &ring);
+        TEST_ASSERT_EQUAL_UINT32(i, item.arg);
+        TEST_ASSERT_TRUE(spsc_ring_is_empty(&ring));
+    }
+
+    printf("yay passed the fifo test\n");
+}
+
+static void test_full()
+{
+    spsc_work_t item;
+    uint32_t i;
+
+    // Test that a full ring drops and counts pushes instead of overwriting
+    spsc_ring_init(&ring, items, RING_LEN);
+
+    for(i = 0; i < RING_LEN; i++)
+    {
+        TEST_ASSERT_TRUE(spsc_ring_push(&ring, record_work, NULL, i));
+    }
+
+    TEST_ASSERT_FALSE(spsc_ring_push(&ring, record_work, NULL, RING_LEN));
+    TEST_ASSERT_EQUAL_UINT32(1, ring.dropped);
+
+    /* Freeing one slot lets the next push in */
+    TEST_ASSERT_TRUE(spsc_ring_pop(&ring, &item));
+    TEST_ASSERT_EQUAL_UINT32(0, item.arg);
+    TEST_ASSERT_TRUE(spsc_ring_push(&ring, record_work, NULL, RING_LEN + 1));
+
+    for(i = 1; i < RING_LEN; i++)
+    {
+        TEST_ASSERT_TRUE(spsc_ring_pop(&ring, &item));
+        TEST_ASSERT_EQUAL_UINT32(i, item.arg);
+    }
+
+    TEST_ASSERT_TRUE(spsc_ring_pop(&ring, &item));
+    TEST_ASSERT_EQUAL_UINT32(RING_LEN + 1, item.arg);
+    TEST_ASSERT_TRUE(spsc_ring_is_empty(&ring));
+
+    printf("yay passed the full ring test\n");
+}
+
+static void test_threads()
+{
+    pthread_t producer;
+    spsc_work_t item;
+    uint32_t received;
+
+    // Test that nothing is lost, duplicated or reordered with the two sides on their own threads
+    spsc_ring_init(&ring, items, RING_LEN);
+    work_sum = 0;
+    work_last = 0;
+    work_out_of_order = 0;
+
+    pthread_create(&producer, NULL, producer_thread, NULL);
+
+    received = 0;
+    while(received < STRESS_ITEMS)
+    {
+        if(spsc_ring_pop(&ring, &item))
+        {
+            item.func(item.ctx, item.arg);
+            received++;
+        }
+        else
+        {
+            /* Let the producer in on a single CPU host */
+            host_sched_yield();
+        }
+    }
+
+    pthread_join(producer, NULL);
+
+    TEST_ASSERT_TRUE(spsc_ring_is_empty(&ring));
+    TEST_ASSERT_EQUAL_UINT32(0, work_out_of_order);
+    TEST_ASSERT_EQUAL_UINT32(STRESS_ITEMS, work_last);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)( ( (uint64_t)STRESS_ITEMS * ( STRESS_ITEMS + 1 ) ) / 2 ), work_sum);
+
+    printf("yay passed the producer/consumer threads test\n");
+}
+
+static void record_work(void * ctx, uint32_t arg)
+{
+    (void)ctx;
+
+    if(arg != work_last + 1)
+    {
+        work_out_of_order++;
+    }
+
+    work_last = arg;
+    work_sum += arg;
+}
+
+/* helper functions */
+
+/**********************************************************
+ *
+ *  producer_thread()
+ *
+ *
+ *  DESCRIPTION:
+ *      Push 1..STRESS_ITEMS, retrying whenever the ring is
+ *      full.
+ *
+ */
+
+static void * producer_thread(void * arg)
+{
+    uint32_t i;
+
+    (void)arg;
+
+    for(i = 1; i <= STRESS_ITEMS; i++)
+    {
+        while(!spsc_ring_push(&ring, record_work, NULL, i))
+        {
+            host_sched_yield();
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,396 @@
+// bench_ssched.c
+//
+// Scheduler micro-benchmarks. Built once per tick length
+// (SSCHED_SCHED_TICK_US) and run over a sweep of task counts
+// and period sets. Time is virtual: a job burns its execution
+// time by moving the system counter forward, and the
+// scheduler ISR fires on every tick boundary it crosses, the
+// same way timer interrupts would keep arriving while it runs.
+// Only the host time spent in the scheduler itself is measured.
+//
+// Output is CSV, one row per configuration:
+//
+//      tick_us          scheduler tick length
+//      periods          harmonic or nonharmonic period set
+//      tasks            number of registered tasks
+//      ticks            ticks measured, after warm up
+//      ns_per_tick      host ns per schedule_isr() call
+//      dispatches       jobs dispatched
+//      ns_per_dispatch  host ns sched_core_step() spends per job,
+//                       not counting the job itself
+//      latency_mean_us  virtual release to start of job
+//      latency_max_us
+//      deadline_misses  jobs that finished past their next release
+//      missed_releases  releases dropped since the job before was
+//                       still waiting or running
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "generic.h"
+#include "sched.h"
+#include "irq.h"
+#include "peripherals/timer.h"
+#include "../../../ssched/ssched.c"
+#include "../../../common/spsc_ring.c"
+
+#define BENCH_TICKS         200000
+#define BENCH_WARMUP_TICKS  10000
+
+/* Total utilization of every task set, split evenly between the tasks */
+#ifndef BENCH_UTIL_PCT
+#define BENCH_UTIL_PCT      70
+#endif
+
+typedef enum
+    {
+    PERIODS_HARMONIC,
+    PERIODS_NONHARMONIC,
+    PERIODS_CNT
+    } period_set_t;
+
+static const char * const period_set_names[PERIODS_CNT] = { "harmonic", "nonharmonic" };
+
+typedef struct
+    {
+    uint64_t ticks;
+    uint64_t isr_ns;
+    uint64_t dispatches;
+    uint64_t dispatch_ns;
+    uint64_t job_ns;
+    uint64_t latency_total_us;
+    uint64_t latency_max_us;
+    uint64_t deadline_misses;
+    } bench_result_t;
+
+/* test variables */
+sched_usr_tsk_t task_list[SSCHED_TSK_MAX_REGISTERED];
+
+static uint64_t exec_us[SSCHED_TSK_MAX_REGISTERED];
+static uint64_t mock_counter_us;
+static uint64_t next_tick_us;
+static bench_result_t result;
+
+/* functions */
+static void bench_config(period_set_t set, uint32_t num_tasks);
+static void run_ticks(uint64_t ticks);
+static void bench_task(void);
+static void burn_us(uint64_t us);
+static void fire_isr(void);
+static uint64_t now_ns(void);
+
+int main(int argc, char **argv) {
+    uint32_t num_tasks;
+    period_set_t set;
+
+    if(argc < 2 || strcmp(argv[1], "--no-header") != 0)
+    {
+        printf("tick_us,periods,tasks,ticks,ns_per_tick,dispatches,ns_per_dispatch,latency_mean_us,latency_max_us,deadline_misses,missed_releases\n");
+    }
+
+    for(set = 0; set < PERIODS_CNT; set++)
+    {
+        for(num_tasks = 1; num_tasks <= SSCHED_TSK_MAX_REGISTERED; num_tasks *= 2)
+        {
+            bench_config(set, num_tasks);
+        }
+
+        /* always report the full task table */
+        if((num_tasks / 2) != SSCHED_TSK_MAX_REGISTERED)
+        {
+            bench_config(set, SSCHED_TSK_MAX_REGISTERED);
+        }
+    }
+
+    return 0;
+}
+
+/* benchmarks */
+
+/**********************************************************
+ *
+ *  bench_config()
+ *
+ *
+ *  DESCRIPTION:
+ *      Run one task set and print its row. Harmonic
+ *      periods double from 10ms, non-harmonic ones are
+ *      spread from 10ms upwards in 7ms steps so releases
+ *      are not all on the same tick.
+ *
+ *  NOTES:
+ *      Execution times are worked out from the requested
+ *      period, so a tick too coarse for the period set
+ *      shows up as deadline misses.
+ *
+ */
+
+static void bench_config(period_set_t set, uint32_t num_tasks)
+{
+    ssched_task_stats_t stats;
+    uint64_t missed_releases;
+    uint32_t i;
+
+    for(i = 0; i < num_tasks; i++)
+    {
+        if(set == PERIODS_HARMONIC)
+        {
+            task_list[i].period_ms = 10 << ( i % 4 );
+        }
+        else
+        {
+            task_list[i].period_ms = 10 + ( 7 * i );
+        }
+
+        task_list[i].task_func = bench_task;
+        exec_us[i] = ( (uint64_t)task_list[i].period_ms * US_PER_MS * BENCH_UTIL_PCT ) / ( 100 * num_tasks );
+    }
+
+    mock_counter_us = 0;
+    next_tick_us = SSCHED_SCHED_TICK_US;
+    sched_init(task_list, num_tasks);
+
+    run_ticks(BENCH_WARMUP_TICKS);
+
+    for(i = 0; i < num_tasks; i++)
+    {
+        ssched_clear_task_stats(task_list[i].id);
+    }
+
+    run_ticks(BENCH_TICKS);
+
+    missed_releases = 0;
+    for(i = 0; i < num_tasks; i++)
+    {
+        ssched_get_task_stats(task_list[i].id, &stats);
+        missed_releases += stats.missed_releases;
+    }
+
+    printf("%u,%s,%u,%llu,%.2f,%llu,%.2f,%.2f,%llu,%llu,%llu\n",
+           SSCHED_SCHED_TICK_US,
+           period_set_names[set],
+           num_tasks,
+           (unsigned long long)result.ticks,
+           (double)result.isr_ns / result.ticks,
+           (unsigned long long)result.dispatches,
+           result.dispatches ? (double)result.dispatch_ns / result.dispatches : 0.0,
+           result.dispatches ? (double)result.latency_total_us / result.dispatches : 0.0,
+           (unsigned long long)result.latency_max_us,
+           (unsigned long long)result.deadline_misses,
+           (unsigned long long)missed_releases);
+}
+
+/* helper functions */
+
+/**********************************************************
+ *
+ *  run_ticks()
+ *
+ *
+ *  DESCRIPTION:
+ *      Run core 0's scheduler loop the way sched_main()
+ *      does until ticks more scheduler ISRs have fired.
+ *      An idle core skips straight to the next tick.
+ *
+ */
+
+static void run_ticks(uint64_t ticks)
+{
+    uint64_t start;
+    uint64_t elapsed;
+    uint64_t dispatches;
+    uint64_t job_ns;
+
+    clr_mem(&result, sizeof(result));
+
+    while(result.ticks < ticks)
+    {
+        dispatches = result.dispatches;
+        job_ns = result.job_ns;
+
+        start = now_ns();
+        sched_core_step(&core_list[0]);
+        elapsed = now_ns() - start;
+
+        if(dispatches == result.dispatches)
+        {
+            /* Nothing was ready, sleep until the next tick */
+            burn_us(next_tick_us - mock_counter_us);
+        }
+        else
+        {
+            result.dispatch_ns += elapsed - ( result.job_ns - job_ns );
+        }
+    }
+}
+
+/**********************************************************
+ *
+ *  bench_task()
+ *
+ *
+ *  DESCRIPTION:
+ *      Procedure of every benchmark task. Looks itself up
+ *      from the core it runs on, records its release
+ *      latency and burns its execution time.
+ *
+ */
+
+static void bench_task(void)
+{
+    task_cb_t * task;
+    uint64_t start;
+    uint64_t latency_us;
+    uint64_t deadline_us;
+
+    start = now_ns();
+
+    task = core_list[0].task_head;
+    latency_us = mock_counter_us - task->release_us;
+    deadline_us = task->release_us + task->period_us;
+
+    result.dispatches++;
+    result.latency_total_us += latency_us;
+    if(latency_us > result.latency_max_us)
+    {
+        result.latency_max_us = latency_us;
+    }
+
+    burn_us(exec_us[task - system_task_list]);
+
+    if(mock_counter_us > deadline_us)
+    {
+        result.deadline_misses++;
+    }
+
+    result.job_ns += now_ns() - start;
+}
+
+/**********************************************************
+ *
+ *  burn_us()
+ *
+ *
+ *  DESCRIPTION:
+ *      Move the system counter us microseconds forward,
+ *      firing the scheduler ISR on each tick boundary
+ *      crossed on the way.
+ *
+ */
+
+static void burn_us(uint64_t us)
+{
+    uint64_t target_us;
+
+    target_us = mock_counter_us + us;
+
+    while(next_tick_us <= target_us)
+    {
+        mock_counter_us = next_tick_us;
+        fire_isr();
+    }
+
+    mock_counter_us = target_us;
+}
+
+static void fire_isr(void)
+{
+    uint64_t start;
+
+    start = now_ns();
+    schedule_isr();
+    result.isr_ns += now_ns() - start;
+
+    result.ticks++;
+    next_tick_us += SSCHED_SCHED_TICK_US;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ( (uint64_t)ts.tv_sec * 1000000000ULL ) + (uint64_t)ts.tv_nsec;
+}
+
+/* mocked functions */
+
+timer_err_t8 timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
+{
+    (void)timer_id;
+    (void)irq_cb;
+    (void)ticks;
+
+    return TIMER_ERR_NONE;
+}
+
+void uart_init()
+{
+}
+
+boolean uart_is_init()
+{
+    return TRUE;
+}
+
+uint32_t get_core_id(void)
+{
+    return 0;
+}
+
+irq_flags_t irq_save(void)
+{
+    return 0;
+}
+
+void irq_restore(irq_flags_t flags)
+{
+    (void)flags;
+}
+
+void irq_set_return(void_func_t func)
+{
+    (void)func;
+}
+
+void cpu_idle(void)
+{
+}
+
+void cpu_wake_cores(void)
+{
+}
+
+uint64_t clock_now_us(void)
+{
+    return mock_counter_us;
+}
+
+timer_err_t8 timer_set_next(timer_id_t8 timer_id, uint32_t ticks)
+{
+    (void)timer_id;
+    (void)ticks;
+
+    return TIMER_ERR_NONE;
+}
+
+boolean defer_work(spsc_work_func_t func, void * ctx, uint32_t arg)
+{
+    (void)func;
+    (void)ctx;
+    (void)arg;
+
+    return TRUE;
+}
+
+uint32_t defer_run(uint32_t max_items)
+{
+    (void)max_items;
+
+    return 0;
+}
+
+boolean defer_pending(void)
+{
+    return FALSE;
+}
@@ -3,9 +3,13 @@
 #include <setjmp.h>
 #include "generic.h"
 #include "sched.h"
+#include "irq.h"
 #include "unity.h"
 #include "peripherals/timer.h"
 #include "../../../ssched/ssched.c"
+#include "../../../common/spsc_ring.c"
+#include "../../../common/sched_wait.c"
+#include "../../../common/sched_mutex.c"
 
 #define MAX_NUMBER_OF_TASKS 10
 
@@ -14,12 +18,55 @@ sched_usr_tsk_t task_list[MAX_NUMBER_OF_TASKS];
 
 uint64_t task_call_count = 0;
 uint64_t task_overrun_call_count = 0;
+uint64_t fast_task_call_count = 0;
+uint64_t stats_task_call_count = 0;
+uint64_t mock_counter_us = 0;
+uint64_t overrun_task_ticks = 0;
+void_func_t mock_irq_return = NULL;
+uint64_t coop_task_progress = 0;
+sched_err_t plain_yield_err = SCHED_ERR_NO_ERR;
+uint64_t wait_start_tick = 0;
+uint64_t server_job_count = 0;
+uint64_t event_task_call_count = 0;
+uint32_t event_task_flags = 0;
+uint64_t sem_task_progress = 0;
+sched_event_t test_event;
+sched_sem_t test_sem;
+sched_mutex_t test_mutex;
+uint32_t mutex_order[4];
+uint32_t mutex_order_cnt = 0;
 
 jmp_buf buf;
 
 /* functions */
 static void test(void);
+static void test_release_heap(void);
+static void test_core_affinity(void);
+static void test_task_stats(void);
+static void test_overrun_policies(void);
+static void test_coop_tasks(void);
+static void test_wait_until(void);
+static void test_task_handles(void);
+static void test_admission_control(void);
+static void test_servers(void);
+static void server_job(void * ctx, uint32_t arg);
+static void test_wait_objects(void);
+static void test_us_periods(void);
+static void test_phase_offsets(void);
+static void test_mutexes(void);
+static void mutex_holder_func(void);
+static void mutex_waiter_func(void);
+static void mutex_bystander_func(void);
+static void event_task_func(void);
+static void sem_task_func(void);
+static void coop_task_func(void);
+static void plain_yield_task_func(void);
+static void wait_until_task_func(void);
+static void stats_task_func(void);
+static void overrun_task_func(void);
+static void isr_and_return(void);
 static void task_func(void);
+static void fast_task_func(void);
 void run_single_cycle(u_int64_t period);
 void tick_system(uint64_t ticks);
 
@@ -33,6 +80,19 @@ void tearDown(void)
 
 int main() {
     test();
+    test_release_heap();
+    test_core_affinity();
+    test_task_stats();
+    test_overrun_policies();
+    test_coop_tasks();
+    test_wait_until();
+    test_task_handles();
+    test_admission_control();
+    test_servers();
+    test_wait_objects();
+    test_us_periods();
+    test_phase_offsets();
+    test_mutexes();
 
     return 0;
 }
@@ -61,11 +121,773 @@ static void test()
 
 }
 
+static void test_release_heap()
+{
+    int i;
+
+    // Test that tasks with different periods are each released at their own rate
+    task_list[0].period_ms = 10;
+    task_list[0].task_func = fast_task_func;
+    task_list[1].period_ms = 25;
+    task_list[1].task_func = task_func;
+    sched_init(task_list, 2);
+
+    task_call_count = 0;
+    fast_task_call_count = 0;
+
+    for(i = 0; i < 1000; i++)
+    {
+        run_single_cycle(SSCHED_SCHED_TICK_US / US_PER_MS);
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(100, fast_task_call_count);
+    TEST_ASSERT_EQUAL_UINT64(40, task_call_count);
+
+    printf("yay passed the release heap test\n");
+}
+
+static void test_core_affinity()
+{
+    // Test that a pinned task only runs on its core and an unpinned task gets stolen by an idle core
+    task_list[0].period_ms = 10;
+    task_list[0].task_func = fast_task_func;
+    task_list[0].core_affinity = BIT(1);
+    task_list[1].period_ms = 10;
+    task_list[1].task_func = task_func;
+    task_list[1].core_affinity = 0;
+    task_list[2].period_ms = 10;
+    task_list[2].task_func = task_func;
+    task_list[2].core_affinity = BIT(SSCHED_CORE_COUNT);
+    sched_init(task_list, 3);
+
+    /* affinity naming no scheduler core is rejected */
+    TEST_ASSERT_EQUAL_UINT32(2, registered_tasks);
+    TEST_ASSERT_EQUAL_UINT32(1, system_task_list[0].home_core);
+    TEST_ASSERT_EQUAL_UINT32(2, system_task_list[1].home_core);
+
+    task_call_count = 0;
+    fast_task_call_count = 0;
+
+    schedule_isr();
+
+    /* core 0 steals the unpinned task but never the pinned one */
+    sched_core_step(&core_list[0]);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, task_call_count);
+    TEST_ASSERT_EQUAL_UINT64(0, fast_task_call_count);
+    TEST_ASSERT_EQUAL_UINT64(1, core_list[0].steal_count);
+
+    sched_core_step(&core_list[1]);
+    TEST_ASSERT_EQUAL_UINT64(1, fast_task_call_count);
+    TEST_ASSERT_EQUAL_UINT64(0, core_list[1].steal_count);
+
+    task_list[0].core_affinity = 0;
+    task_list[1].core_affinity = 0;
+    task_list[2].core_affinity = 0;
+
+    printf("yay passed the core affinity test\n");
+}
+
+static void test_task_stats()
+{
+    ssched_task_stats_t stats;
+    uint64_t wcet_us;
+    int i;
+
+    // Test execution time, jitter, overrun and missed release stats of a task
+    task_list[0].period_ms = 10;
+    task_list[0].task_func = stats_task_func;
+    sched_init(task_list, 1);
+
+    stats_task_call_count = 0;
+    mock_counter_us = 0;
+
+    /* The counter follows the tick, the first cycle starts
+     * 200uS late. Releases on ticks 31 and 41 land while the
+     * third cycle runs */
+    for(i = 0; i < 100 && stats_task_call_count < 3; i++)
+    {
+        mock_counter_us = ( system_tick + 1 ) * SSCHED_SCHED_TICK_US;
+        schedule_isr();
+
+        if(system_tick == 1)
+        {
+            mock_counter_us += 200;
+        }
+
+        sched_core_step(&core_list[0]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, ssched_get_task_stats(task_list[0].id, &stats));
+    TEST_ASSERT_EQUAL_UINT64(3, stats_task_call_count);
+    TEST_ASSERT_EQUAL_UINT64(3, stats.cycles);
+    TEST_ASSERT_EQUAL_UINT64(100, stats.exec_min_us);
+    TEST_ASSERT_EQUAL_UINT64(25000, stats.exec_max_us);
+    TEST_ASSERT_EQUAL_UINT64(( 100 + 3000 + 25000 ) / 3, stats.exec_mean_us);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.exec_hist[7]);    /* 100uS   */
+    TEST_ASSERT_EQUAL_UINT32(1, stats.exec_hist[12]);   /* 3000uS  */
+    TEST_ASSERT_EQUAL_UINT32(1, stats.exec_hist[15]);   /* 25000uS */
+    TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.missed_releases);
+
+    TEST_ASSERT_EQUAL_UINT64(0, stats.latency_min_us);
+    TEST_ASSERT_EQUAL_UINT64(200, stats.latency_max_us);
+    TEST_ASSERT_EQUAL_UINT64(200, stats.jitter_us);
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, ssched_get_task_wcet_us(task_list[0].id, &wcet_us));
+    TEST_ASSERT_EQUAL_UINT64(25000, wcet_us);
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_PARAM, ssched_get_task_wcet_us(task_list[0].id + 1, &wcet_us));
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, ssched_clear_task_stats(task_list[0].id));
+    ssched_get_task_stats(task_list[0].id, &stats);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.cycles);
+
+    printf("yay passed the task stats test\n");
+}
+
+static void test_overrun_policies()
+{
+    ssched_overrun_stats_t stats;
+    task_cb_t * task;
+    int i;
+
+    // Test that an overrun drops the next release, unwinds the task or degrades its period per the task's policy
+    task_list[0].period_ms = 10;
+    task_list[0].task_func = overrun_task_func;
+    task_list[0].overrun_policy = SCHED_OVERRUN_SKIP;
+    task_list[1].period_ms = 10;
+    task_list[1].task_func = overrun_task_func;
+    task_list[1].overrun_policy = SCHED_OVERRUN_ABORT;
+    task_list[1].budget_us = 3000;
+    task_list[1].core_affinity = BIT(0) | BIT(1);
+    task_list[2].period_ms = 10;
+    task_list[2].task_func = overrun_task_func;
+    task_list[2].overrun_policy = SCHED_OVERRUN_DEGRADE;
+    task_list[2].degraded_period_ms = 30;
+
+    /* Skip: the 15 tick cycle misses the release on tick 11
+     * and gives up the one on tick 21 */
+    sched_init(&task_list[0], 1);
+    overrun_task_ticks = 0;
+    for(i = 0; i < 30; i++)
+    {
+        isr_and_return();
+        sched_core_step(&core_list[0]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, ssched_get_overrun_stats(task_list[0].id, &stats));
+    TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.skipped_releases);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.aborts);
+    TEST_ASSERT_EQUAL_UINT64(15, overrun_task_ticks);
+
+    /* Abort: pinned to core 0 out of its affinity, and
+     * unwound on the tick it uses up its 3 tick budget */
+    sched_init(&task_list[1], 1);
+    task = &system_task_list[0];
+    TEST_ASSERT_EQUAL_UINT32(BIT(0), task->affinity);
+
+    overrun_task_ticks = 0;
+    isr_and_return();
+    sched_core_step(&core_list[0]);
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, ssched_get_overrun_stats(task_list[1].id, &stats));
+    TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.aborts);
+    TEST_ASSERT_EQUAL_UINT64(4, overrun_task_ticks);
+    TEST_ASSERT_EQUAL_UINT8(IDLE, core_list[0].state);
+    TEST_ASSERT_FALSE(task->scheduled);
+    TEST_ASSERT_FALSE(core_list[0].abort_armed);
+
+    /* Degrade: moves to the 30 tick period once */
+    sched_init(&task_list[2], 1);
+    task = &system_task_list[0];
+    overrun_task_ticks = 0;
+    isr_and_return();
+    sched_core_step(&core_list[0]);
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, ssched_get_overrun_stats(task_list[2].id, &stats));
+    TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.degrades);
+    TEST_ASSERT_EQUAL_UINT64(30 * SSCHED_SCHED_TICK_US, task->period_us);
+    TEST_ASSERT_EQUAL_UINT64(30 * SSCHED_SCHED_TICK_US, task->budget_us);
+
+    for(i = 0; i < 3; i++)
+    {
+        task_list[i].overrun_policy = SCHED_OVERRUN_NONE;
+        task_list[i].budget_us = 0;
+        task_list[i].degraded_period_ms = 0;
+        task_list[i].core_affinity = 0;
+    }
+
+    printf("yay passed the overrun policies test\n");
+}
+
+static void test_coop_tasks()
+{
+    ssched_task_stats_t stats;
+    task_cb_t * task;
+    int i;
+
+    // Test that a task on its own stack picks up where it left off after yielding and sleeping
+    task_list[0].period_ms = 10;
+    task_list[0].task_func = coop_task_func;
+    task_list[0].core_affinity = BIT(0);
+    task_list[0].stack_size = 16384;
+    task_list[1].period_ms = 10;
+    task_list[1].task_func = plain_yield_task_func;
+    task_list[1].core_affinity = BIT(0);
+    task_list[2].period_ms = 10;
+    task_list[2].task_func = task_func;
+    task_list[2].stack_size = SSCHED_STACK_POOL_SIZE;
+    sched_init(task_list, 3);
+
+    /* the pool can not fit the second stack */
+    TEST_ASSERT_EQUAL_UINT32(2, registered_tasks);
+    task = &system_task_list[0];
+
+    /* only a task can give up the CPU */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_INVLD_STATE, sched_yield());
+
+    coop_task_progress = 0;
+    task_call_count = 0;
+    plain_yield_err = SCHED_ERR_NO_ERR;
+    schedule_isr();
+
+    /* yields, letting the plain task in ahead of it */
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, coop_task_progress);
+    TEST_ASSERT_TRUE(task->started);
+
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, task_call_count);
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_INVLD_STATE, plain_yield_err);
+
+    /* resumes, then sleeps 15 ticks */
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(2, coop_task_progress);
+    TEST_ASSERT_TRUE(sleep_head == task);
+    TEST_ASSERT_EQUAL_UINT64(16 * SSCHED_SCHED_TICK_US, task->wake_us);
+
+    /* misses its release on tick 11 while asleep */
+    for(i = 2; i < 16; i++)
+    {
+        schedule_isr();
+        sched_core_step(&core_list[0]);
+        sched_core_step(&core_list[0]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(2, coop_task_progress);
+    TEST_ASSERT_EQUAL_UINT64(2, task_call_count);
+
+    /* wakes on tick 16 and finishes the cycle */
+    schedule_isr();
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(3, coop_task_progress);
+    TEST_ASSERT_FALSE(task->started);
+    TEST_ASSERT_TRUE(sleep_head == NULL);
+
+    ssched_get_task_stats(task_list[0].id, &stats);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.cycles);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.missed_releases);
+
+    /* the release on tick 21 starts it over from the top */
+    for(i = 17; i <= 21; i++)
+    {
+        schedule_isr();
+    }
+
+    sched_core_step(&core_list[0]);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(4, coop_task_progress);
+
+    for(i = 0; i < 3; i++)
+    {
+        task_list[i].core_affinity = 0;
+        task_list[i].stack_size = 0;
+    }
+
+    printf("yay passed the cooperative tasks test\n");
+}
+
+static void test_wait_until()
+{
+    task_cb_t * task;
+    int i;
+
+    // Test that waiting until sched_get_tick() + N resumes the task N ticks later
+    task_list[0].period_ms = 100;
+    task_list[0].task_func = wait_until_task_func;
+    task_list[0].core_affinity = BIT(0);
+    task_list[0].stack_size = 16384;
+    sched_init(task_list, 1);
+    task = &system_task_list[0];
+
+    coop_task_progress = 0;
+    schedule_isr();
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, coop_task_progress);
+    TEST_ASSERT_TRUE(sleep_head == task);
+    TEST_ASSERT_EQUAL_UINT64(( wait_start_tick + 5 ) * SSCHED_SCHED_TICK_US, task->wake_us);
+
+    for(i = 1; i < 5; i++)
+    {
+        schedule_isr();
+        sched_core_step(&core_list[0]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(1, coop_task_progress);
+
+    /* wakes on the fifth tick */
+    schedule_isr();
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(2, coop_task_progress);
+    TEST_ASSERT_EQUAL_UINT64(wait_start_tick + 5, sched_get_tick());
+    TEST_ASSERT_TRUE(sleep_head == NULL);
+
+    task_list[0].core_affinity = 0;
+    task_list[0].stack_size = 0;
+
+    printf("yay passed the wait until test\n");
+}
+
+static void test_task_handles()
+{
+    ssched_overrun_stats_t stats;
+    sched_task_id_t stale_id;
+    core_cb_t * core;
+    int i;
+
+    // Test that killed tasks give their slot back and their old handle stops working
+    task_list[0].period_ms = 10;
+    task_list[0].task_func = task_func;
+    task_list[1].period_ms = 10;
+    task_list[1].task_func = fast_task_func;
+    sched_init(task_list, 0);
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_register_task(&task_list[0]));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_FAILED_REG, sched_register_task(NULL));
+    TEST_ASSERT_EQUAL_UINT32(1, registered_tasks);
+
+    /* ids that name no task are turned away, not looked up */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_FAILED_UPDATE, sched_kill_task(task_list[0].id + 1));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_FAILED_UPDATE, sched_kill_task(0xFFFFFFFF));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_PARAM, sched_activate_task(0xFFFFFFFF));
+
+    /* the handle dies with the task, the slot once it is off the heap */
+    stale_id = task_list[0].id;
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_kill_task(stale_id));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_FAILED_UPDATE, sched_kill_task(stale_id));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_PARAM, ssched_get_overrun_stats(stale_id, &stats));
+    TEST_ASSERT_EQUAL_UINT32(1, registered_tasks);
+
+    task_call_count = 0;
+    schedule_isr();
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(0, task_call_count);
+    TEST_ASSERT_EQUAL_UINT32(0, registered_tasks);
+
+    /* the slot is reused under a new handle */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_register_task(&task_list[1]));
+    TEST_ASSERT_TRUE(task_list[1].id != stale_id);
+    TEST_ASSERT_EQUAL_UINT32(stale_id & HANDLE_SLOT_MASK, task_list[1].id & HANDLE_SLOT_MASK);
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_FAILED_UPDATE, sched_kill_task(stale_id));
+
+    /* a task killed while it runs keeps its slot until it is done */
+    fast_task_call_count = 0;
+    core = &core_list[system_task_list[task_list[1].id & HANDLE_SLOT_MASK].home_core];
+    schedule_isr();
+    core->task_head = ready_queue_pop(core, 0);
+    core->state = EXECUTE_TASK;
+    TEST_ASSERT_TRUE(core->task_head != NULL);
+
+    sched_kill_task(task_list[1].id);
+    for(i = 0; i < 20; i++)
+    {
+        schedule_isr();
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, registered_tasks);
+
+    sched_core_step(core);
+    schedule_isr();
+    TEST_ASSERT_EQUAL_UINT64(1, fast_task_call_count);
+    TEST_ASSERT_EQUAL_UINT32(0, registered_tasks);
+
+    /* long lived systems never run out of slots */
+    for(i = 0; i < 3 * SSCHED_TSK_MAX_REGISTERED; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_register_task(&task_list[0]));
+        TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_kill_task(task_list[0].id));
+        schedule_isr();
+        schedule_isr();
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, registered_tasks);
+
+    printf("yay passed the task handles test\n");
+}
+
+static void test_admission_control()
+{
+    int i;
+
+    // Test that a task that could make a core miss deadlines is turned away at registration
+    for(i = 0; i < 4; i++)
+    {
+        task_list[i].period_ms = 10;
+        task_list[i].task_func = task_func;
+        task_list[i].core_affinity = BIT(0);
+        task_list[i].budget_us = 4000;
+    }
+    task_list[2].budget_us = 3000;
+    task_list[3].budget_us = 0;
+    sched_init(task_list, 2);
+    TEST_ASSERT_EQUAL_UINT32(2, registered_tasks);
+
+    /* 11mS of work queued up on core 0 in the worst case */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_UNSCHEDULABLE, sched_register_task(&task_list[2]));
+    TEST_ASSERT_EQUAL_UINT32(2, registered_tasks);
+
+    /* homed elsewhere it could still be stolen by core 0 */
+    task_list[2].core_affinity = 0;
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_UNSCHEDULABLE, sched_register_task(&task_list[2]));
+
+    /* kept off core 0 it fits */
+    task_list[2].core_affinity = BIT(1);
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_register_task(&task_list[2]));
+    TEST_ASSERT_EQUAL_UINT32(1, system_task_list[2].home_core);
+
+    /* tasks without a budget are not analyzed */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_register_task(&task_list[3]));
+    TEST_ASSERT_EQUAL_UINT32(4, registered_tasks);
+
+    for(i = 0; i < 4; i++)
+    {
+        task_list[i].core_affinity = 0;
+        task_list[i].budget_us = 0;
+    }
+
+    printf("yay passed the admission control test\n");
+}
+
+static void test_servers()
+{
+    task_cb_t * server;
+    int i;
+
+    // Test that a server runs posted jobs straight away, but only up to its budget each period
+    task_list[0].period_ms = 10;
+    task_list[0].task_func = NULL;
+    task_list[0].core_affinity = BIT(0);
+    task_list[0].budget_us = 3000;
+    sched_init(task_list, 0);
+    mock_counter_us = 0;
+    server_job_count = 0;
+
+    task_list[0].period_ms = 0;
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_PARAM, sched_register_server(&task_list[0]));
+    task_list[0].period_ms = 10;
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_register_server(&task_list[0]));
+    server = &system_task_list[task_list[0].id & HANDLE_SLOT_MASK];
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_PARAM, sched_server_post(0xFFFFFFFF, server_job, NULL, 1000));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_PARAM, sched_server_post(task_list[0].id, NULL, NULL, 1000));
+
+    /* a job is dispatched without waiting for a release */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_server_post(task_list[0].id, server_job, NULL, 1000));
+    TEST_ASSERT_TRUE(server->queued);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, server_job_count);
+    TEST_ASSERT_EQUAL_UINT64(2000, server->server->capacity_us);
+
+    /* the job that would go over budget waits for the next period */
+    for(i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_server_post(task_list[0].id, server_job, NULL, 1000));
+    }
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(3, server_job_count);
+    TEST_ASSERT_FALSE(server->queued);
+
+    schedule_isr();
+    TEST_ASSERT_TRUE(server->queued);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(4, server_job_count);
+    TEST_ASSERT_EQUAL_UINT64(2000, server->server->capacity_us);
+
+    /* the budget counts against the other tasks on the core */
+    task_list[1].period_ms = 10;
+    task_list[1].task_func = task_func;
+    task_list[1].core_affinity = BIT(0);
+    task_list[1].budget_us = 8000;
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_UNSCHEDULABLE, sched_register_task(&task_list[1]));
+
+    /* a full job queue turns posts away */
+    for(i = 0; i < SSCHED_SERVER_QUEUE_LEN; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_server_post(task_list[0].id, server_job, NULL, 0));
+    }
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_FAILED_UPDATE, sched_server_post(task_list[0].id, server_job, NULL, 0));
+
+    /* killing the server drops its jobs and frees it */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_kill_task(task_list[0].id));
+    sched_core_step(&core_list[0]);
+    for(i = 0; i < 10; i++)
+    {
+        schedule_isr();
+    }
+    TEST_ASSERT_EQUAL_UINT64(4, server_job_count);
+    TEST_ASSERT_EQUAL_UINT32(0, registered_tasks);
+    TEST_ASSERT_FALSE(server_list[0].in_use);
+
+    for(i = 0; i < 2; i++)
+    {
+        task_list[i].core_affinity = 0;
+        task_list[i].budget_us = 0;
+    }
+
+    printf("yay passed the servers test\n");
+}
+
+static void test_wait_objects()
+{
+    task_cb_t * sem_task;
+    sched_msg_t msg;
+    void * slots[4];
+    void * data;
+    uint32_t i;
+
+    // Test that tasks bound to wait objects are released or resumed as soon as the object is signalled
+    task_list[0].period_ms = 0;
+    task_list[0].task_func = event_task_func;
+    task_list[0].core_affinity = BIT(0);
+    task_list[1].period_ms = 0;
+    task_list[1].task_func = sem_task_func;
+    task_list[1].core_affinity = BIT(0);
+    task_list[1].stack_size = 16384;
+    sched_init(task_list, 2);
+    sched_event_init(&test_event);
+    sched_sem_init(&test_sem, 0);
+    sched_wait_bind(&test_event.wait, task_list[0].id);
+    event_task_call_count = 0;
+    sem_task_progress = 0;
+
+    /* event driven tasks have no releases of their own */
+    tick_system(50);
+    TEST_ASSERT_EQUAL_UINT64(0, event_task_call_count);
+    TEST_ASSERT_FALSE(system_task_list[0].active);
+
+    sched_event_set(&test_event, 0x3);
+    TEST_ASSERT_TRUE(system_task_list[0].queued);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, event_task_call_count);
+    TEST_ASSERT_EQUAL_UINT32(0x3, event_task_flags);
+
+    /* the task set the event again while it ran, so it runs once more */
+    TEST_ASSERT_TRUE(system_task_list[0].queued);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(2, event_task_call_count);
+    TEST_ASSERT_EQUAL_UINT32(0x4, event_task_flags);
+    TEST_ASSERT_FALSE(system_task_list[0].queued);
+
+    /* a task on its own stack blocks in sched_sem_wait() until posted */
+    sem_task = &system_task_list[task_list[1].id & HANDLE_SLOT_MASK];
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_activate_task(task_list[1].id));
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(0, sem_task_progress);
+    TEST_ASSERT_TRUE(sem_task->started);
+    TEST_ASSERT_FALSE(sem_task->queued);
+    TEST_ASSERT_FALSE(sem_task->active);
+
+    tick_system(50);
+    TEST_ASSERT_EQUAL_UINT64(0, sem_task_progress);
+
+    sched_sem_post(&test_sem);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, sem_task_progress);
+
+    /* posts that arrive before the wait are not lost */
+    sched_sem_post(&test_sem);
+    sched_sem_post(&test_sem);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT64(3, sem_task_progress);
+    TEST_ASSERT_FALSE(sem_task->started);
+
+    /* blocking is only for tasks with their own stack */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_INVLD_STATE, sched_sem_wait(&test_sem));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_PARAM, sched_activate_task(0xFFFFFFFF));
+
+    /* a task killed while it waits gives its slot back */
+    sem_task_progress = 0;
+    sched_activate_task(task_list[1].id);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_TRUE(sem_task->started);
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_kill_task(task_list[1].id));
+    TEST_ASSERT_FALSE(sem_task->started);
+    tick_system(( EVENT_TASK_SWEEP_US / SSCHED_SCHED_TICK_US ) + 1);
+    TEST_ASSERT_EQUAL_UINT32(1, registered_tasks);
+
+    /* message boxes hand messages over in order and drop on overflow */
+    TEST_ASSERT_FALSE(sched_msg_init(&msg, slots, 3));
+    TEST_ASSERT_TRUE(sched_msg_init(&msg, slots, 4));
+    for(i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_msg_send(&msg, &slots[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_FAILED_UPDATE, sched_msg_send(&msg, NULL));
+    TEST_ASSERT_EQUAL_UINT32(1, msg.dropped);
+
+    for(i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_TRUE(sched_msg_take(&msg, &data));
+        TEST_ASSERT_TRUE(data == &slots[i]);
+    }
+    TEST_ASSERT_FALSE(sched_msg_take(&msg, &data));
+
+    task_list[0].core_affinity = 0;
+    task_list[1].core_affinity = 0;
+    task_list[1].stack_size = 0;
+
+    printf("yay passed the wait objects test\n");
+}
+
+static void event_task_func(void)
+{
+    event_task_call_count++;
+    event_task_flags = sched_event_take(&test_event, 0xFFFFFFFF);
+
+    /* an event that comes in while the task runs */
+    if(event_task_call_count == 1)
+    {
+        sched_event_set(&test_event, 0x4);
+    }
+}
+
+static void sem_task_func(void)
+{
+    while(sem_task_progress < 3)
+    {
+        if(sched_sem_wait(&test_sem) != SCHED_ERR_NO_ERR)
+        {
+            return;
+        }
+
+        sem_task_progress++;
+    }
+}
+
+static void mutex_holder_func(void)
+{
+    sched_mutex_lock(&test_mutex);
+    sched_sleep_us(5 * SSCHED_SCHED_TICK_US);
+    mutex_order[mutex_order_cnt++] = 1;
+    sched_mutex_unlock(&test_mutex);
+}
+
+static void mutex_waiter_func(void)
+{
+    sched_mutex_lock(&test_mutex);
+    mutex_order[mutex_order_cnt++] = 2;
+    sched_mutex_unlock(&test_mutex);
+}
+
+static void mutex_bystander_func(void)
+{
+    mutex_order[mutex_order_cnt++] = 3;
+}
+
+static void server_job(void * ctx, uint32_t arg)
+{
+    (void)ctx;
+
+    server_job_count++;
+    mock_counter_us += arg;
+}
+
+static void stats_task_func(void)
+{
+    uint64_t i;
+
+    stats_task_call_count++;
+
+    /* Second cycle runs 3mS, third one runs 25mS and
+     * overruns, ticking the scheduler while it runs */
+    switch(stats_task_call_count)
+    {
+        case 1:
+            mock_counter_us += 100;
+            break;
+
+        case 2:
+            mock_counter_us += 3000;
+            break;
+
+        case 3:
+            for(i = 0; i < 25; i++)
+            {
+                schedule_isr();
+                mock_counter_us += 1000;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void overrun_task_func(void)
+{
+    int i;
+
+    /* First cycle runs 15 ticks, the rest return straight away */
+    if(overrun_task_ticks > 0)
+    {
+        return;
+    }
+
+    for(i = 0; i < 15; i++)
+    {
+        overrun_task_ticks++;
+        isr_and_return();
+    }
+}
+
+static void coop_task_func(void)
+{
+    coop_task_progress++;
+    sched_yield();
+
+    coop_task_progress++;
+    sched_sleep_us(15 * SSCHED_SCHED_TICK_US);
+
+    coop_task_progress++;
+}
+
+static void wait_until_task_func(void)
+{
+    wait_start_tick = sched_get_tick();
+    coop_task_progress++;
+
+    sched_wait_until(wait_start_tick + 5);
+    coop_task_progress++;
+}
+
+static void plain_yield_task_func(void)
+{
+    task_call_count = task_call_count + 1;
+    plain_yield_err = sched_yield();
+}
+
 static void task_func(void)
 {
     task_call_count = task_call_count + 1;
 }
 
+static void fast_task_func(void)
+{
+    fast_task_call_count = fast_task_call_count + 1;
+}
+
 static void task_overrun(void)
 {
     task_overrun_call_count = task_overrun_call_count + 1;
@@ -78,6 +900,164 @@ static void task_overrun(void)
     }
 }
 
+static void test_us_periods()
+{
+    ssched_task_stats_t stats;
+    int i;
+
+    // Test that periods that are not a whole number of ticks release exactly, without drifting
+    task_list[0].period_us = 1500;
+    task_list[0].task_func = task_func;
+    task_list[1].period_us = 200;
+    task_list[1].task_func = fast_task_func;
+    sched_init(task_list, 2);
+
+    task_call_count = 0;
+    fast_task_call_count = 0;
+
+    for(i = 0; i < 300; i++)
+    {
+        schedule_isr();
+        sched_core_step(&core_list[0]);
+        sched_core_step(&core_list[0]);
+    }
+
+    /* 1500uS releases go out on every tick they fall in */
+    TEST_ASSERT_EQUAL_UINT64(200, task_call_count);
+    TEST_ASSERT_EQUAL_UINT64(300 * SSCHED_SCHED_TICK_US + 1000, system_task_list[0].next_release_us);
+
+    /* 200uS is shorter than the tick, one release per tick
+     * goes out and the rest are missed */
+    TEST_ASSERT_EQUAL_UINT64(300, fast_task_call_count);
+    ssched_get_task_stats(task_list[1].id, &stats);
+    TEST_ASSERT_EQUAL_UINT32(299 * ( ( SSCHED_SCHED_TICK_US / 200 ) - 1 ), stats.missed_releases);
+
+    /* Wrapped times still order right */
+    TEST_ASSERT_TRUE(TIME_BEFORE(0xFFFFFFFFFFFFFF00ULL, 0x100ULL));
+    TEST_ASSERT_FALSE(TIME_BEFORE_EQ(0x100ULL, 0xFFFFFFFFFFFFFF00ULL));
+
+    task_list[0].period_us = 0;
+    task_list[1].period_us = 0;
+
+    printf("yay passed the microsecond periods test\n");
+}
+
+static void test_phase_offsets()
+{
+    uint32_t i;
+
+    // Test that phases keep harmonic tasks out of each other's ticks
+    clr_mem(task_list, 4 * sizeof(task_list[0]));
+    task_list[0].period_ms = 10;
+    task_list[0].budget_us = 2000;
+    task_list[1].period_ms = 20;
+    task_list[1].budget_us = 3000;
+    task_list[2].period_ms = 40;
+    task_list[2].budget_us = 5000;
+    for(i = 0; i < 3; i++)
+    {
+        task_list[i].task_func = task_func;
+        task_list[i].phase_us = SCHED_PHASE_AUTO;
+    }
+
+    /* An explicit phase is taken as given */
+    task_list[3].period_ms = 40;
+    task_list[3].phase_us = 3500;
+    task_list[3].task_func = fast_task_func;
+    sched_init(task_list, 4);
+
+    /* Each picks the first tick nothing else is released on */
+    TEST_ASSERT_EQUAL_UINT64(1 * SSCHED_SCHED_TICK_US, system_task_list[0].next_release_us);
+    TEST_ASSERT_EQUAL_UINT64(2 * SSCHED_SCHED_TICK_US, system_task_list[1].next_release_us);
+    TEST_ASSERT_EQUAL_UINT64(3 * SSCHED_SCHED_TICK_US, system_task_list[2].next_release_us);
+    TEST_ASSERT_EQUAL_UINT64(1 * SSCHED_SCHED_TICK_US + 3500, system_task_list[3].next_release_us);
+
+    /* With one release a tick, one step a tick runs them all */
+    task_call_count = 0;
+    fast_task_call_count = 0;
+
+    for(i = 0; i < ( 40 * US_PER_MS ) / SSCHED_SCHED_TICK_US; i++)
+    {
+        schedule_isr();
+        sched_core_step(&core_list[0]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(4 + 2 + 1, task_call_count);
+    TEST_ASSERT_EQUAL_UINT64(1, fast_task_call_count);
+
+    clr_mem(task_list, 4 * sizeof(task_list[0]));
+
+    printf("yay passed the phase offsets test\n");
+}
+
+static void test_mutexes()
+{
+    sched_mutex_stats_t stats;
+    task_cb_t * holder;
+    uint32_t i;
+
+    // Test that a waiter gets the mutex handed over and boosts the holder past other ready tasks
+    clr_mem(task_list, 3 * sizeof(task_list[0]));
+    task_list[0].task_func = mutex_holder_func;
+    task_list[0].stack_size = 16384;
+    task_list[1].task_func = mutex_waiter_func;
+    task_list[1].stack_size = 16384;
+    task_list[2].task_func = mutex_bystander_func;
+    for(i = 0; i < 3; i++)
+    {
+        task_list[i].core_affinity = BIT(0);
+    }
+    sched_init(task_list, 3);
+    sched_mutex_init(&test_mutex, "test");
+    holder = &system_task_list[task_list[0].id & HANDLE_SLOT_MASK];
+
+    /* uncontended, also from outside of any task */
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_INVLD_STATE, sched_mutex_unlock(&test_mutex));
+    TEST_ASSERT_TRUE(sched_mutex_trylock(&test_mutex));
+    TEST_ASSERT_FALSE(sched_mutex_trylock(&test_mutex));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERR_NO_ERR, sched_mutex_unlock(&test_mutex));
+
+    /* the holder sleeps with the mutex, the waiter blocks on it */
+    sched_activate_task(task_list[0].id);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_TRUE(test_mutex.held);
+    TEST_ASSERT_EQUAL_UINT32(task_list[0].id, test_mutex.owner);
+
+    sched_activate_task(task_list[1].id);
+    sched_core_step(&core_list[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, test_mutex.stats.contended);
+    TEST_ASSERT_EQUAL_INT(1, holder->boost);
+
+    /* woken up behind another task, the holder goes first */
+    sched_activate_task(task_list[2].id);
+    for(i = 0; i < 5; i++)
+    {
+        schedule_isr();
+    }
+
+    TEST_ASSERT_TRUE(core_list[0].ready_head == holder);
+    for(i = 0; i < 3; i++)
+    {
+        sched_core_step(&core_list[0]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(3, mutex_order_cnt);
+    TEST_ASSERT_EQUAL_UINT32(1, mutex_order[0]);
+    TEST_ASSERT_EQUAL_UINT32(3, mutex_order[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, mutex_order[2]);
+    TEST_ASSERT_EQUAL_INT(0, holder->boost);
+    TEST_ASSERT_FALSE(test_mutex.held);
+
+    sched_mutex_get_stats(&test_mutex, &stats);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.locks);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.contended);
+    sched_mutex_print_stats();
+
+    clr_mem(task_list, 3 * sizeof(task_list[0]));
+
+    printf("\nyay passed the mutexes test\n");
+}
+
 /* helper functions */
 
 /**********************************************************
@@ -94,12 +1074,39 @@ static void task_overrun(void)
 void run_single_cycle(u_int64_t period)
 {
     if (setjmp(buf) == 0) {
-        tick_system(period / MS_PER_TICKS);
+        tick_system(( period * US_PER_MS ) / SSCHED_SCHED_TICK_US);
     } else {
         return;
     }
 }
 
+/**********************************************************
+ *
+ *  isr_and_return()
+ *
+ *
+ *  DESCRIPTION:
+ *      Helper function to run the scheduling ISR and then
+ *      resume wherever irq_set_return() sent us, the way
+ *      the IRQ return would.
+ *
+ */
+
+static void isr_and_return(void)
+{
+    void_func_t func;
+
+    schedule_isr();
+
+    func = mock_irq_return;
+    mock_irq_return = NULL;
+
+    if(func != NULL)
+    {
+        func();
+    }
+}
+
 /**********************************************************
  *
  *  tick_system()
@@ -110,10 +1117,10 @@ void run_single_cycle(u_int64_t period)
  *      by simulating timer based scheduling ISR.
  *
  *  NOTES:
- *      calls sched_main() after each task period which is
- *      not representative of the real world execution,
- *      sequence but should still be sufficient to test
- *      scheduling behavior.
+ *      runs one pass of core 0's scheduler loop after each
+ *      task period which is not representative of the real
+ *      world execution, sequence but should still be
+ *      sufficient to test scheduling behavior.
  */
 
 void tick_system(uint64_t ticks)
@@ -124,13 +1131,7 @@ void tick_system(uint64_t ticks)
     {
         schedule_isr();
     }
-    sched_main();
-}
-
-/* hook to stop loop */
-void ssched_log_insert_task_cycle_stat_entry(void)
-{
-    longjmp(buf, 1);
+    sched_core_step(&core_list[0]);
 }
 
 /* mocked functions */
@@ -151,4 +1152,66 @@ void uart_init()
 boolean uart_is_init()
 {
     return TRUE;
-}
\ No newline at end of file
+}
+
+uint64_t clock_now_us(void)
+{
+    return mock_counter_us;
+}
+
+uint32_t get_core_id(void)
+{
+    return 0;
+}
+
+irq_flags_t irq_save(void)
+{
+    return 0;
+}
+
+void irq_restore(irq_flags_t flags)
+{
+    (void)flags;
+}
+
+void irq_set_return(void_func_t func)
+{
+    mock_irq_return = func;
+}
+
+void cpu_idle(void)
+{
+}
+
+void cpu_wake_cores(void)
+{
+}
+
+timer_err_t8 timer_set_next(timer_id_t8 timer_id, uint32_t ticks)
+{
+    (void)timer_id;
+    (void)ticks;
+
+    return TIMER_ERR_NONE;
+}
+
+boolean defer_work(spsc_work_func_t func, void * ctx, uint32_t arg)
+{
+    (void)func;
+    (void)ctx;
+    (void)arg;
+
+    return TRUE;
+}
+
+uint32_t defer_run(uint32_t max_items)
+{
+    (void)max_items;
+
+    return 0;
+}
+
+boolean defer_pending(void)
+{
+    return FALSE;
+}
@@ -0,0 +1,267 @@
+// unit_test_ssched_cyclic.c
+#include <stdio.h>
+#include "generic.h"
+#include "sched.h"
+#include "irq.h"
+#include "unity.h"
+#include "peripherals/timer.h"
+#include "../../../ssched/ssched.c"
+#include "../../../common/spsc_ring.c"
+#include "../../../common/sched_wait.c"
+
+#define MAX_RUNS 32
+
+/* test variables */
+sched_usr_tsk_t task_list[SSCHED_CYCLIC_TASK_CNT];
+
+uint64_t task_call_count[SSCHED_CYCLIC_TASK_CNT];
+uint64_t task_last_tick[SSCHED_CYCLIC_TASK_CNT];
+uint32_t run_order[MAX_RUNS];
+uint32_t run_cnt = 0;
+uint64_t mock_counter_us = 0;
+
+/* functions */
+#ifdef CYCLIC_UNEVEN
+static void test_uneven_periods(void);
+#else
+static void test_table_releases(void);
+static void test_registration(void);
+static void task_2_func(void);
+#endif
+static void record_run(uint32_t slot);
+static void task_0_func(void);
+static void task_1_func(void);
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main() {
+#ifdef CYCLIC_UNEVEN
+    test_uneven_periods();
+#else
+    test_table_releases();
+    test_registration();
+#endif
+
+    return 0;
+}
+
+/* unit tests */
+#ifdef CYCLIC_UNEVEN
+static void test_uneven_periods()
+{
+    uint32_t i;
+
+    // Test that releases falling inside a minor frame still get a slot
+    task_list[0].period_us = 6000;
+    task_list[0].budget_us = 1000;
+    task_list[0].task_func = task_0_func;
+    task_list[1].period_us = 4000;
+    task_list[1].budget_us = 1000;
+    task_list[1].task_func = task_1_func;
+    TEST_ASSERT_EQUAL(SCHED_ERR_NO_ERR, sched_init(task_list, SSCHED_CYCLIC_TASK_CNT));
+
+    /* 4ms frames, the 6ms release lands in the middle of one */
+    TEST_ASSERT_EQUAL_UINT32(4000, SSCHED_CYCLIC_MINOR_US);
+    TEST_ASSERT_EQUAL_UINT32(3, SSCHED_CYCLIC_FRAME_CNT);
+
+    for(i = 0; i < 24; i++)
+    {
+        schedule_isr();
+        sched_core_step(&core_list[0]);
+        sched_core_step(&core_list[0]);
+    }
+
+    /* Two major frames went by, every release ran */
+    TEST_ASSERT_EQUAL_UINT64(4, task_call_count[0]);
+    TEST_ASSERT_EQUAL_UINT64(6, task_call_count[1]);
+
+    printf("yay passed the uneven periods schedule table test\n");
+}
+#else
+static void test_table_releases()
+{
+    uint32_t i;
+
+    // Test that the table's tasks are released on their frames, in table order, regardless of period
+    task_list[0].period_us = 10000;
+    task_list[0].budget_us = 2000;
+    task_list[0].task_func = task_0_func;
+    task_list[1].period_us = 20000;
+    task_list[1].budget_us = 3000;
+    task_list[1].task_func = task_1_func;
+    task_list[2].period_us = 40000;
+    task_list[2].budget_us = 5000;
+    task_list[2].task_func = task_2_func;
+    TEST_ASSERT_EQUAL(SCHED_ERR_NO_ERR, sched_init(task_list, SSCHED_CYCLIC_TASK_CNT));
+
+    /* Table tasks are only ever released by the table */
+    TEST_ASSERT_EQUAL_UINT32(10000, SSCHED_CYCLIC_MINOR_US);
+    TEST_ASSERT_EQUAL_UINT32(4, SSCHED_CYCLIC_FRAME_CNT);
+    TEST_ASSERT_FALSE(system_task_list[0].periodic);
+    TEST_ASSERT_EQUAL_UINT32(0, system_task_list[2].home_core);
+
+    for(i = 0; i < 80; i++)
+    {
+        schedule_isr();
+        sched_core_step(&core_list[0]);
+        sched_core_step(&core_list[0]);
+        sched_core_step(&core_list[0]);
+    }
+
+    /* Two major frames went by */
+    TEST_ASSERT_EQUAL_UINT64(8, task_call_count[0]);
+    TEST_ASSERT_EQUAL_UINT64(4, task_call_count[1]);
+    TEST_ASSERT_EQUAL_UINT64(2, task_call_count[2]);
+
+    /* Each ran on the first tick of its last frame */
+    TEST_ASSERT_EQUAL_UINT64(71, task_last_tick[0]);
+    TEST_ASSERT_EQUAL_UINT64(61, task_last_tick[1]);
+    TEST_ASSERT_EQUAL_UINT64(41, task_last_tick[2]);
+
+    /* The first frame goes out in table order */
+    TEST_ASSERT_EQUAL_UINT32(0, run_order[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, run_order[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, run_order[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, run_order[3]);
+
+    printf("yay passed the schedule table test\n");
+}
+
+static void test_registration()
+{
+    sched_usr_tsk_t task;
+
+    // Test that periodic tasks can only come from the table
+    clr_mem(&task, sizeof(task));
+    task.period_ms = 10;
+    task.task_func = task_0_func;
+    TEST_ASSERT_EQUAL(SCHED_ERR_INVLD_STATE, sched_register_task(&task));
+
+    /* Event driven tasks run in the table's slack */
+    task.period_ms = 0;
+    TEST_ASSERT_EQUAL(SCHED_ERR_NO_ERR, sched_register_task(&task));
+
+    /* A task list the table was not generated from */
+    TEST_ASSERT_EQUAL(SCHED_ERR_PARAM, sched_init(task_list, SSCHED_CYCLIC_TASK_CNT - 1));
+
+    printf("yay passed the schedule table registration test\n");
+}
+#endif
+
+/* helper functions */
+
+static void record_run(uint32_t slot)
+{
+    task_call_count[slot]++;
+    task_last_tick[slot] = system_tick;
+
+    if(run_cnt < MAX_RUNS)
+    {
+        run_order[run_cnt++] = slot;
+    }
+}
+
+static void task_0_func(void)
+{
+    record_run(0);
+}
+
+static void task_1_func(void)
+{
+    record_run(1);
+}
+
+#ifndef CYCLIC_UNEVEN
+static void task_2_func(void)
+{
+    record_run(2);
+}
+#endif
+
+/* mocked functions */
+
+timer_err_t8 timer_alloc(timer_id_t8 * timer_id, void_func_t irq_cb, uint32_t ticks)
+{
+    (void)timer_id;
+    (void)irq_cb;
+    (void)ticks;
+
+    return TIMER_ERR_NONE;
+}
+
+void uart_init()
+{
+}
+
+boolean uart_is_init()
+{
+    return TRUE;
+}
+
+uint64_t clock_now_us(void)
+{
+    return mock_counter_us;
+}
+
+uint32_t get_core_id(void)
+{
+    return 0;
+}
+
+irq_flags_t irq_save(void)
+{
+    return 0;
+}
+
+void irq_restore(irq_flags_t flags)
+{
+    (void)flags;
+}
+
+void irq_set_return(void_func_t func)
+{
+    (void)func;
+}
+
+void cpu_idle(void)
+{
+}
+
+void cpu_wake_cores(void)
+{
+}
+
+timer_err_t8 timer_set_next(timer_id_t8 timer_id, uint32_t ticks)
+{
+    (void)timer_id;
+    (void)ticks;
+
+    return TIMER_ERR_NONE;
+}
+
+boolean defer_work(spsc_work_func_t func, void * ctx, uint32_t arg)
+{
+    (void)func;
+    (void)ctx;
+    (void)arg;
+
+    return TRUE;
+}
+
+uint32_t defer_run(uint32_t max_items)
+{
+    (void)max_items;
+
+    return 0;
+}
+
+boolean defer_pending(void)
+{
+    return FALSE;
+}
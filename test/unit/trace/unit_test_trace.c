@@ -0,0 +1,131 @@
+// unit_test_trace.c
+#include <stdio.h>
+#include "generic.h"
+#include "irq.h"
+#include "unity.h"
+#include "../../../common/trace.c"
+
+/* test variables */
+uint64_t mock_counter_us = 0;
+uint32_t mock_core_id = 0;
+
+/* functions */
+static void test_record(void);
+static void test_wrap(void);
+static void test_dump(void);
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main() {
+    test_record();
+    test_wrap();
+    test_dump();
+
+    return 0;
+}
+
+/* unit tests */
+static void test_record()
+{
+    trace_rec_t * rec;
+
+    // Test that events land in the recording core's ring with the counter at the time
+    mock_counter_us = 0x100000005ULL;
+    mock_core_id = 0;
+    trace_event(TRACE_TASK_START, 0x101);
+
+    mock_counter_us = 0x100000009ULL;
+    mock_core_id = CPU_CORE_COUNT - 1;
+    trace_event(TRACE_IRQ_ENTER, 3);
+
+    /* cores that do not exist are ignored */
+    mock_core_id = CPU_CORE_COUNT;
+    trace_event(TRACE_IRQ_EXIT, 3);
+
+    rec = &trace_rings[0].recs[0];
+    TEST_ASSERT_EQUAL_UINT64(0x100000005ULL, rec->ts_us);
+    TEST_ASSERT_EQUAL_UINT32(0x101, rec->id);
+    TEST_ASSERT_EQUAL_UINT8(TRACE_TASK_START, rec->evt);
+    TEST_ASSERT_EQUAL_UINT8(0, rec->core);
+
+    rec = &trace_rings[CPU_CORE_COUNT - 1].recs[0];
+    TEST_ASSERT_EQUAL_UINT64(0x100000009ULL, rec->ts_us);
+    TEST_ASSERT_EQUAL_UINT8(TRACE_IRQ_ENTER, rec->evt);
+    TEST_ASSERT_EQUAL_UINT8(CPU_CORE_COUNT - 1, rec->core);
+    TEST_ASSERT_EQUAL_UINT32(1, trace_rings[CPU_CORE_COUNT - 1].head);
+
+    TEST_ASSERT_EQUAL_UINT32(16, sizeof(trace_rec_t));
+
+    trace_dump();
+
+    printf("yay passed the record test\n");
+}
+
+static void test_wrap()
+{
+    uint32_t i;
+
+    // Test that a full ring keeps the newest events
+    mock_core_id = 0;
+
+    for(i = 0; i < TRACE_RING_LEN + 3; i++)
+    {
+        mock_counter_us = i;
+        trace_event(TRACE_TASK_RELEASE, i);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(TRACE_RING_LEN + 3, trace_rings[0].head);
+
+    /* the three oldest were overwritten by the newest */
+    TEST_ASSERT_EQUAL_UINT32(TRACE_RING_LEN, trace_rings[0].recs[0].id);
+    TEST_ASSERT_EQUAL_UINT32(TRACE_RING_LEN + 2, trace_rings[0].recs[2].id);
+    TEST_ASSERT_EQUAL_UINT32(3, trace_rings[0].recs[3].id);
+
+    printf("yay passed the wrap test\n");
+}
+
+static void test_dump()
+{
+    // Test that a dump starts the rings over and nothing is recorded while paused
+    trace_dump();
+    TEST_ASSERT_EQUAL_UINT32(0, trace_rings[0].head);
+    TEST_ASSERT_FALSE(trace_paused);
+
+    trace_paused = TRUE;
+    trace_event(TRACE_TASK_END, 1);
+    TEST_ASSERT_EQUAL_UINT32(0, trace_rings[0].head);
+    trace_paused = FALSE;
+
+    trace_event(TRACE_TASK_END, 1);
+    TEST_ASSERT_EQUAL_UINT32(1, trace_rings[0].head);
+
+    printf("yay passed the dump test\n");
+}
+
+/* mocked functions */
+
+uint32_t get_core_id(void)
+{
+    return mock_core_id;
+}
+
+irq_flags_t irq_save(void)
+{
+    return 0;
+}
+
+void irq_restore(irq_flags_t flags)
+{
+    (void)flags;
+}
+
+uint64_t clock_now_us(void)
+{
+    return mock_counter_us;
+}
@@ -0,0 +1,177 @@
+"""Generate a cyclic executive schedule table for ssched.
+
+ssched built with SSCHED_CYCLIC releases the periodic tasks given to
+sched_init() from a constant table instead of from their periods, see
+SSCHED_CYCLIC_TABLE in ssched/ssched.c. Give this script the period and
+worst case execution time of every task in the task list, in the same
+order, and the scheduler tick it is built with:
+
+    python3 gen_cyclic_table.py --tick-us 1000 10000:2000 20000:3000 -o table.h
+    make SSCHED_CYCLIC_TABLE=table.h
+
+The major frame is the hyperperiod of the tasks. It is cut into minor
+frames of the largest length that is a whole number of ticks, fits the
+longest task and still lets every job be placed between its release and
+its deadline. Jobs are handed to frames earliest deadline first. That is
+a heuristic, a task set it can not place may still have a table, in which
+case splitting the longest task usually helps.
+"""
+
+import argparse
+import math
+import sys
+
+
+def lcm(a, b):
+    return a * b // math.gcd(a, b)
+
+
+def minor_frames(tasks, tick_us, major_us):
+    """Candidate minor frame lengths, longest first."""
+    longest = max(wcet for _, wcet in tasks)
+
+    for frame_us in range(major_us, 0, -tick_us):
+        if major_us % frame_us != 0 or frame_us % tick_us != 0:
+            continue
+        if frame_us < longest:
+            break
+        # A whole frame has to fit between any release and its deadline
+        if all(2 * frame_us - math.gcd(frame_us, period) <= period for period, _ in tasks):
+            yield frame_us
+
+
+def fill(tasks, frame_us, major_us):
+    """Hand each job to a frame, returns the slots of every frame or None."""
+    # Every release in the major frame, in time order. One that falls
+    # inside a frame waits for the next frame to start
+    releases = sorted((release, slot)
+                      for slot, (period, _) in enumerate(tasks)
+                      for release in range(0, major_us, period))
+    next_release = 0
+
+    # [deadline, slot, wcet, release] of the jobs not placed yet
+    pending = []
+    frames = []
+
+    for start in range(0, major_us, frame_us):
+        while next_release < len(releases) and releases[next_release][0] <= start:
+            release, slot = releases[next_release]
+            period, wcet = tasks[slot]
+            pending.append([release + period, slot, wcet, release])
+            next_release += 1
+
+        end = start + frame_us
+        used = 0
+        placed = []
+
+        for job in sorted(pending):
+            deadline, slot, wcet, release = job
+            if release <= start and deadline >= end and used + wcet <= frame_us:
+                used += wcet
+                placed.append(job)
+
+        for job in placed:
+            pending.remove(job)
+
+        # A job that is not placed by now can not make its deadline
+        if any(job[0] <= end for job in pending):
+            return None
+
+        frames.append([job[1] for job in placed])
+
+    return frames
+
+
+def write_table(out, tasks, tick_us, major_us, frame_us, frames, argv):
+    slots = [slot for frame in frames for slot in frame]
+
+    out.write("/**********************************************************\n")
+    out.write(" *\n")
+    out.write(" *  Schedule table for SSCHED_CYCLIC, generated by\n")
+    out.write(" *  tools/scripts/gen_cyclic_table.py. Do not edit.\n")
+    out.write(" *\n")
+    out.write(" *      %s\n" % " ".join(argv))
+    out.write(" *\n")
+    out.write(" *  Major frame %d us, %d minor frames of %d us.\n" % (major_us, len(frames), frame_us))
+    out.write(" *\n")
+    out.write(" *  slot  period_us  wcet_us\n")
+    for slot, (period, wcet) in enumerate(tasks):
+        out.write(" *  %4d  %9d  %7d\n" % (slot, period, wcet))
+    out.write(" *\n")
+    out.write(" */\n\n")
+    out.write("#pragma once\n\n")
+    out.write("#include \"generic.h\"\n")
+    out.write("#include \"ssched.h\"\n\n")
+    out.write("#define SSCHED_CYCLIC_MINOR_US %d\n" % frame_us)
+    out.write("#define SSCHED_CYCLIC_FRAME_CNT %d\n" % len(frames))
+    out.write("#define SSCHED_CYCLIC_TASK_CNT %d\n\n" % len(tasks))
+    out.write("#if SSCHED_SCHED_TICK_US != %d\n" % tick_us)
+    out.write("    #error Schedule table was generated for a different scheduler tick\n")
+    out.write("#endif\n\n")
+
+    out.write("static const ssched_cyclic_frame_t ssched_cyclic_frames[ SSCHED_CYCLIC_FRAME_CNT ] =\n")
+    out.write("    {\n")
+    first = 0
+    for start, frame in enumerate(frames):
+        out.write("    { %d, %d }, /* %d us */\n" % (first, len(frame), start * frame_us))
+        first += len(frame)
+    out.write("    };\n\n")
+
+    # Keep the array non-empty for a table with nothing to release
+    out.write("static const uint8_t ssched_cyclic_slots[ %d ] =\n" % max(len(slots), 1))
+    out.write("    {\n")
+    out.write("    %s\n" % ", ".join(str(slot) for slot in slots or [0]))
+    out.write("    };\n")
+
+
+def parse_task(arg):
+    try:
+        period, wcet = (int(f) for f in arg.split(":"))
+    except ValueError:
+        raise argparse.ArgumentTypeError("expected period_us:wcet_us, got %s" % arg)
+    if period <= 0 or wcet <= 0 or wcet > period:
+        raise argparse.ArgumentTypeError("need 0 < wcet_us <= period_us, got %s" % arg)
+    return period, wcet
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("tasks", nargs="+", type=parse_task, metavar="period_us:wcet_us",
+                        help="one per task, in task list order")
+    parser.add_argument("--tick-us", type=int, default=1000, help="SSCHED_SCHED_TICK_US")
+    parser.add_argument("-o", "--output", help="header to write, stdout if left out")
+    args = parser.parse_args()
+
+    if len(args.tasks) > 256:
+        parser.error("slots are 8 bit, at most 256 tasks")
+
+    for period, _ in args.tasks:
+        if period % args.tick_us != 0:
+            parser.error("period %d us is not a whole number of %d us ticks" % (period, args.tick_us))
+
+    major_us = 1
+    for period, _ in args.tasks:
+        major_us = lcm(major_us, period)
+
+    utilization = sum(wcet / period for period, wcet in args.tasks)
+    if utilization > 1:
+        parser.error("utilization %.3f is over 1" % utilization)
+
+    for frame_us in minor_frames(args.tasks, args.tick_us, major_us):
+        frames = fill(args.tasks, frame_us, major_us)
+        if frames is not None:
+            break
+    else:
+        sys.exit("no minor frame length fits this task set")
+
+    argv = ["gen_cyclic_table.py"] + sys.argv[1:]
+
+    if args.output:
+        with open(args.output, "w") as f:
+            write_table(f, args.tasks, args.tick_us, major_us, frame_us, frames, argv)
+    else:
+        write_table(sys.stdout, args.tasks, args.tick_us, major_us, frame_us, frames, argv)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,138 @@
+"""Convert a scheduler trace dump into Chrome trace / Perfetto JSON.
+
+The kernel prints its trace rings with trace_dump() (see include/trace.h)
+between "TRACE BEGIN" and "TRACE END" lines. Feed this script the console
+log, UART capture or simulator output that contains the dump and open the
+result in chrome://tracing or https://ui.perfetto.dev.
+
+    python3 trace2chrome.py console.log -o trace.json
+    ./strat_os_sim | python3 trace2chrome.py > trace.json
+
+Each core gets a track for its tasks and one for its IRQs. Task releases
+and overruns show up as instant events on the task track. Only the last
+dump in the log is converted.
+"""
+
+import argparse
+import json
+import sys
+
+TRACE_FORMAT_VERSION = 1
+
+# Must match trace_evt_t in include/trace.h
+TRACE_TASK_RELEASE = 0
+TRACE_TASK_START = 1
+TRACE_TASK_END = 2
+TRACE_TASK_OVERRUN = 3
+TRACE_IRQ_ENTER = 4
+TRACE_IRQ_EXIT = 5
+
+# IRQ tracks sit after the task tracks of every core
+IRQ_TID_BASE = 1000
+
+
+def parse_dump(lines):
+    """Return the events of the last dump in lines, sorted on time."""
+    events = None
+    lost = 0
+
+    for line in lines:
+        fields = line.split()
+
+        if fields[:2] == ["TRACE", "BEGIN"]:
+            version = int(fields[2], 16)
+            if version != TRACE_FORMAT_VERSION:
+                raise ValueError("unsupported trace format version %d" % version)
+            events = []
+            lost = 0
+        elif events is None:
+            continue
+        elif fields[:2] == ["TRACE", "CORE"]:
+            lost += int(fields[4], 16)
+        elif fields[:2] == ["TRACE", "END"]:
+            break
+        elif len(fields) == 4:
+            try:
+                hi, lo, ident, kind = (int(f, 16) for f in fields)
+            except ValueError:
+                # Console output that landed in the middle of the dump
+                continue
+            events.append(((hi << 32) | lo, kind >> 8, kind & 0xFF, ident))
+
+    if events is None:
+        raise ValueError("no TRACE BEGIN found")
+
+    # Stable, so events on the same microsecond keep their order
+    events.sort(key=lambda e: e[0])
+
+    return events, lost
+
+
+def to_chrome(events):
+    """Build the Chrome trace event list."""
+    out = []
+    cores = sorted(set(e[1] for e in events))
+
+    for core in cores:
+        out.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": core,
+                    "args": {"name": "core %d tasks" % core}})
+        out.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": IRQ_TID_BASE + core,
+                    "args": {"name": "core %d irqs" % core}})
+
+    # Slices open on each track. The ring may have overwritten
+    # the start of the first slice, its end is dropped then
+    depth = {}
+
+    for ts_us, core, kind, ident in events:
+        task = "task 0x%x" % ident
+        tid = IRQ_TID_BASE + core if kind in (TRACE_IRQ_ENTER, TRACE_IRQ_EXIT) else core
+
+        if kind in (TRACE_TASK_START, TRACE_IRQ_ENTER):
+            depth[tid] = depth.get(tid, 0) + 1
+        elif kind in (TRACE_TASK_END, TRACE_IRQ_EXIT):
+            if depth.get(tid, 0) == 0:
+                continue
+            depth[tid] -= 1
+
+        if kind == TRACE_TASK_RELEASE:
+            out.append({"ph": "i", "s": "t", "name": "release " + task, "cat": "release",
+                        "pid": 0, "tid": core, "ts": ts_us})
+        elif kind == TRACE_TASK_OVERRUN:
+            out.append({"ph": "i", "s": "t", "name": "overrun " + task, "cat": "overrun",
+                        "pid": 0, "tid": core, "ts": ts_us})
+        elif kind in (TRACE_TASK_START, TRACE_TASK_END):
+            out.append({"ph": "B" if kind == TRACE_TASK_START else "E", "name": task, "cat": "task",
+                        "pid": 0, "tid": core, "ts": ts_us})
+        elif kind in (TRACE_IRQ_ENTER, TRACE_IRQ_EXIT):
+            out.append({"ph": "B" if kind == TRACE_IRQ_ENTER else "E", "name": "irq 0x%x" % ident,
+                        "cat": "irq", "pid": 0, "tid": tid, "ts": ts_us})
+
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", help="log holding the dump, stdin if left out")
+    parser.add_argument("-o", "--output", help="JSON file to write, stdout if left out")
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log, errors="replace") as f:
+            events, lost = parse_dump(f)
+    else:
+        events, lost = parse_dump(sys.stdin)
+
+    trace = {"traceEvents": to_chrome(events), "displayTimeUnit": "ns"}
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+    if lost:
+        sys.stderr.write("%d events were overwritten before the dump\n" % lost)
+
+
+if __name__ == "__main__":
+    main()